@@ -0,0 +1,68 @@
+"""Compare two benchmark reports and flag the stages that got slower.
+
+A stage regresses when its mean or p99 latency exceeds the baseline by more
+than the tolerance. Host timings are noisy, so compare reports taken on the
+same machine, and prefer several runs over one. See src/benchmark.
+
+Usage:
+    python scripts/compare_benchmark_reports.py <baseline.json> <current.json>
+        [--tolerance 0.2]
+
+Exits with status 1 if any stage regressed.
+"""
+
+import argparse
+import json
+import sys
+
+# The max is left out, a single preemption or page fault on the host sets it
+METRICS = ("mean_ns", "p99_ns")
+
+
+def load_stages(path):
+    with open(path) as report_file:
+        report = json.load(report_file)
+    return {stage["name"]: stage for stage in report["stages"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline", help="report to compare against")
+    parser.add_argument("current", help="report to check")
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=0.2,
+        help="allowed relative increase, e.g. 0.2 for 20%% (default)",
+    )
+    args = parser.parse_args()
+
+    baseline = load_stages(args.baseline)
+    current = load_stages(args.current)
+
+    regressed = False
+    print(f"{'stage':<24}{'metric':<10}{'baseline':>14}{'current':>14}{'change':>10}")
+    for name, stage in current.items():
+        if name not in baseline:
+            print(f"{name:<24}(new stage)")
+            continue
+        for metric in METRICS:
+            before = baseline[name][metric]
+            after = stage[metric]
+            change = (after - before) / before if before > 0 else 0.0
+            flag = ""
+            if change > args.tolerance:
+                flag = "  REGRESSED"
+                regressed = True
+            print(
+                f"{name:<24}{metric:<10}{before:>14}{after:>14}{change:>+10.1%}{flag}"
+            )
+
+    for name in baseline.keys() - current.keys():
+        print(f"{name:<24}(missing)")
+
+    sys.exit(1 if regressed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+"""Decode the binary frames written by the deferred logging mode (LOG_DEFERRED).
+
+Each frame carries the address of its printf format string rather than the
+string itself. The format strings are looked up in the firmware ELF, and the
+text is rebuilt with the recorded arguments. See src/logging/deferredLog.hpp
+for the frame layout.
+
+Usage:
+    python scripts/decode_deferred_log.py --elf <firmware.elf> --port <port>
+    python scripts/decode_deferred_log.py --elf <firmware.elf> --file <dump>
+
+Requires pyelftools (and pyserial when reading from a serial port).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+SYNC = b"\xa5\x5a"
+
+SIGNED_INTEGER = 0
+UNSIGNED_INTEGER = 1
+FLOATING_POINT = 2
+STRING = 3
+
+# printf conversion specifications, e.g. %d, %.2f, %-5s, %%
+CONVERSION = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?(?:hh|h|ll|l|z|t)?[diouxXeEfgGcsp%]")
+
+
+class FormatStrings:
+    """Reads null terminated strings out of the loadable sections of an ELF"""
+
+    def __init__(self, elf_path):
+        self.sections = []
+        with open(elf_path, "rb") as elf_file:
+            elf = ELFFile(elf_file)
+            for section in elf.iter_sections():
+                if section["sh_addr"] and section["sh_type"] == "SHT_PROGBITS":
+                    self.sections.append((section["sh_addr"], section.data()))
+        self.cache = {}
+
+    def lookup(self, address):
+        if address not in self.cache:
+            self.cache[address] = self._read(address)
+        return self.cache[address]
+
+    def _read(self, address):
+        for start, data in self.sections:
+            if start <= address < start + len(data):
+                offset = address - start
+                end = data.index(b"\0", offset)
+                return data[offset:end].decode("utf-8", errors="replace")
+        return "<unknown format string 0x%08x>" % address
+
+
+def render(format_string, arguments):
+    """Rebuild the text of a message, one conversion at a time"""
+    arguments = iter(arguments)
+
+    def substitute(match):
+        conversion = match.group(0)
+        if conversion == "%%":
+            return "%"
+        # Python has no length modifiers
+        conversion = re.sub(r"(hh|h|ll|l|z|t)(?=[a-zA-Z]$)", "", conversion)
+        try:
+            return conversion % next(arguments)
+        except (StopIteration, TypeError, ValueError):
+            return match.group(0)
+
+    return CONVERSION.sub(substitute, format_string)
+
+
+def read_exact(stream, size):
+    data = b""
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            raise EOFError
+        data += chunk
+    return data
+
+
+def read_frame(stream):
+    # Resynchronise on the sync bytes
+    previous = b""
+    while True:
+        byte = read_exact(stream, 1)
+        if previous + byte == SYNC:
+            break
+        previous = byte
+
+    address, count = struct.unpack("<IB", read_exact(stream, 5))
+    arguments = []
+    for _ in range(count):
+        (argument_type,) = struct.unpack("<B", read_exact(stream, 1))
+        if argument_type == SIGNED_INTEGER:
+            arguments.append(struct.unpack("<i", read_exact(stream, 4))[0])
+        elif argument_type == UNSIGNED_INTEGER:
+            arguments.append(struct.unpack("<I", read_exact(stream, 4))[0])
+        elif argument_type == FLOATING_POINT:
+            arguments.append(struct.unpack("<d", read_exact(stream, 8))[0])
+        elif argument_type == STRING:
+            (length,) = struct.unpack("<B", read_exact(stream, 1))
+            arguments.append(read_exact(stream, length).decode("utf-8", "replace"))
+        else:
+            # Corrupt frame, drop it and resynchronise
+            return None, []
+    return address, arguments
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--elf", required=True, help="firmware ELF file")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port to read from")
+    source.add_argument("--file", help="binary dump to read from")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    format_strings = FormatStrings(args.elf)
+
+    if args.port:
+        import serial
+
+        stream = serial.Serial(args.port, args.baud)
+    else:
+        stream = open(args.file, "rb")
+
+    try:
+        while True:
+            address, arguments = read_frame(stream)
+            if address is not None:
+                print(render(format_strings.lookup(address), arguments))
+                sys.stdout.flush()
+    except (EOFError, KeyboardInterrupt):
+        pass
+    finally:
+        stream.close()
+
+
+if __name__ == "__main__":
+    main()
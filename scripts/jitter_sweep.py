@@ -0,0 +1,117 @@
+"""Run a tracking scenario at several control period jitters and seeds.
+
+For every jitter, the simulation is run once per seed with the measured
+timestep and once with the fixed timestep (--fixed-timestep). The seed changes
+both the jitter and the sonar noise. For each jitter and timestep the table
+gives the mean and the worst, over the seeds, of the rms and the max tracking
+error, and the mean total settling time over the target steps. Compare the
+spread over the seeds with the difference between the two timesteps before
+calling either one better. See src/simulation.
+
+Usage:
+    python scripts/jitter_sweep.py <program> <scenario file>
+        [--jitter-ms 0 10 20 30 60] [--seeds 10] [-- <program options>...]
+
+The program options (e.g. --tracking-pid) are passed to every run.
+"""
+
+import argparse
+import re
+import statistics
+import subprocess
+import sys
+
+TRACKING_ERROR = re.compile(r"^Tracking error over .*: rms ([\d.]+), max ([\d.]+)")
+SETTLED = re.compile(r"^  \d+ms, .* -> .*: settled in (\d+)ms")
+NOT_SETTLED = re.compile(r"^  \d+ms, .* -> .*: not settled")
+
+
+def run(program, scenario, jitter_ms, seed, fixed_timestep, extra_options):
+    command = [
+        program,
+        scenario,
+        "--jitter-ms",
+        str(jitter_ms),
+        "--seed",
+        str(seed),
+    ] + extra_options
+    if fixed_timestep:
+        command.append("--fixed-timestep")
+    result = subprocess.run(
+        command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True
+    )
+    if result.returncode != 0:
+        sys.exit(f"{' '.join(command)} failed:\n{result.stderr}")
+
+    rms = maximum = None
+    settling_ms = 0
+    unsettled = 0
+    for line in result.stderr.splitlines():
+        match = TRACKING_ERROR.match(line)
+        if match:
+            rms, maximum = float(match.group(1)), float(match.group(2))
+        match = SETTLED.match(line)
+        if match:
+            settling_ms += int(match.group(1))
+        if NOT_SETTLED.match(line):
+            unsettled += 1
+    if rms is None:
+        sys.exit(f"{scenario} places no target in tracking mode")
+    return rms, maximum, settling_ms, unsettled
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("program", help="the native build's program")
+    parser.add_argument("scenario", help="scenario file")
+    parser.add_argument(
+        "--jitter-ms",
+        type=int,
+        nargs="+",
+        default=[0, 10, 20, 30, 60],
+        help="max jitters to run, in ms",
+    )
+    parser.add_argument(
+        "--seeds", type=int, default=10, help="runs per jitter (default 10)"
+    )
+
+    # Everything after -- is for the program
+    argv = sys.argv[1:]
+    extra_options = []
+    if "--" in argv:
+        extra_options = argv[argv.index("--") + 1 :]
+        argv = argv[: argv.index("--")]
+    args = parser.parse_args(argv)
+
+    print(
+        f"{'jitter':>6} {'timestep':>9} {'rms mean':>9} {'rms worst':>10} "
+        f"{'max mean':>9} {'max worst':>10} {'settling s':>11} "
+        f"{'unsettled':>10}"
+    )
+    for jitter_ms in args.jitter_ms:
+        for fixed_timestep in (False, True):
+            runs = [
+                run(
+                    args.program,
+                    args.scenario,
+                    jitter_ms,
+                    seed,
+                    fixed_timestep,
+                    extra_options,
+                )
+                for seed in range(args.seeds)
+            ]
+            rms = [result[0] for result in runs]
+            maximum = [result[1] for result in runs]
+            settling_s = statistics.mean(result[2] for result in runs) / 1000
+            unsettled = sum(result[3] for result in runs)
+            print(
+                f"{jitter_ms:>4}ms {'fixed' if fixed_timestep else 'measured':>9} "
+                f"{statistics.mean(rms):>9.1f} {max(rms):>10.1f} "
+                f"{statistics.mean(maximum):>9.1f} {max(maximum):>10.1f} "
+                f"{settling_s:>11.1f} {unsettled:>10}"
+            )
+
+
+if __name__ == "__main__":
+    main()
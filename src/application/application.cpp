@@ -2,45 +2,216 @@
 #include "application/danceState.hpp"
 #include "application/trackingState.hpp"
 #include "logging/log.hpp"
-#include <memory>
+#include "logging/serialManager.hpp"
+#include "profiling/profiler.hpp"
 
-Application::Application()
-    : hardware(std::make_shared<Hardware>()),
-      danceState(std::make_unique<DanceState>(this->hardware)),
-      trackingState(std::make_unique<TrackingState>(this->hardware)),
-      currentState(this->danceState.get())
+Application::Application(PidParameters trackingPidParams,
+                         bool predictiveTracking)
+    : danceState(this->hardware, this->danceMotion),
+      trackingState(this->hardware, trackingPidParams, predictiveTracking),
+      modeStateMachine(this->danceState, this->trackingState),
+      scheduler(millis), modeTask(*this),
+      sensingTask(*this), controlTask(*this), motionTask(*this),
+      eyesTask(*this)
 {
-  LOG_INFO("Starting Application in %s!", this->currentState->name());
+  // DanceState sets itself up when it is constructed
+  this->modeStateMachine.start<DanceState>();
+  LOG_INFO("Starting Application in %s!",
+           this->modeStateMachine.getCurrentName().data());
 
-  this->hardware->eyes.setColour(Eyes::Colour::light_blue);
+  this->hardware.eyes.setColour(Eyes::Colour::light_blue);
+
+  this->scheduler.addTask(this->modeTask, MODE_TASK_TIMING);
+  this->scheduler.addTask(this->sensingTask, SENSING_TASK_TIMING);
+  this->scheduler.addTask(this->controlTask, CONTROL_TASK_TIMING);
+  this->scheduler.addTask(this->motionTask, MOTION_TASK_TIMING);
+  this->scheduler.addTask(this->eyesTask, EYES_TASK_TIMING);
+  this->scheduler.addTask(this->loggingTask, LOGGING_TASK_TIMING);
 }
 
 void Application::run()
 {
   while (true)
   {
-    auto* desiredState = this->getDesiredState();
-    if (desiredState == nullptr)
-    {
-      LOG_WARN("%s", "Desired state is a nullptr");
-      return;
-    }
-
-    if (this->currentState != desiredState)
-    {
-      this->currentState = desiredState;
-      this->currentState->enter();
-    }
-    else
-    {
-      this->currentState->runOnce();
-    }
+    this->runOnce();
+  }
+}
+
+void Application::runOnce()
+{
+  this->scheduler.runOnce();
+}
+
+Switch::State Application::getMode() const
+{
+  return this->modeStateMachine.isIn<DanceState>() ? Switch::State::on
+                                                   : Switch::State::off;
+}
+
+Application::ModeStateMachine::StateId
+Application::getDesiredState(Switch::State switchState)
+{
+  return switchState == Switch::State::on
+             ? ModeStateMachine::id<DanceState>()
+             : ModeStateMachine::id<TrackingState>();
+}
+
+void Application::changeState(ModeStateMachine::StateId desiredState)
+{
+  // Whatever the dance was doing belongs to the state we are leaving
+  this->danceMotion.stop();
+  this->modeStateMachine.enter(desiredState);
+}
+
+void Application::handleCommand(int command)
+{
+  switch (command)
+  {
+    case AUTO_TUNE_COMMAND:
+      this->trackingState.requestAutoTune();
+      break;
+    case Profiler::DUMP_COMMAND:
+      PROFILE_DUMP();
+      break;
+    default:
+      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// ModeTask
+//////////////////////////////////////////////////////////////////////
+
+Application::ModeTask::ModeTask(Application& parent) : parent(parent)
+{
+}
+
+void Application::ModeTask::runOnce(uint32_t /*nowMs*/)
+{
+  Switch& modeSwitch = this->parent.hardware.modeSwitch;
+  modeSwitch.update();
+
+  // Only the latest state matters, the switch may have been flipped back
+  // already
+  Switch::Event event{};
+  bool flipped = false;
+  while (modeSwitch.popEvent(event))
+  {
+    flipped = true;
+  }
+  if (!flipped)
+  {
+    return;
   }
+
+  auto desiredState = this->parent.getDesiredState(event.state);
+  if (desiredState == this->parent.modeStateMachine.getCurrent())
+  {
+    return;
+  }
+
+  LOG_INFO("Mode switch %s, reacted in %ums",
+           Switch::toString(event.state),
+           (micros() - event.firstEdgeUs) / 1000);
+  this->parent.changeState(desiredState);
+}
+
+char const* Application::ModeTask::name()
+{
+  return "ModeTask";
+}
+
+//////////////////////////////////////////////////////////////////////
+// SensingTask
+//////////////////////////////////////////////////////////////////////
+
+Application::SensingTask::SensingTask(Application& parent) : parent(parent)
+{
+}
+
+void Application::SensingTask::runOnce(uint32_t /*nowMs*/)
+{
+  this->parent.hardware.sonarArray.update();
+}
+
+char const* Application::SensingTask::name()
+{
+  return "SensingTask";
+}
+
+//////////////////////////////////////////////////////////////////////
+// ControlTask
+//////////////////////////////////////////////////////////////////////
+
+Application::ControlTask::ControlTask(Application& parent) : parent(parent)
+{
+}
+
+void Application::ControlTask::runOnce(uint32_t /*nowMs*/)
+{
+  // The spread of the control period is the control loop jitter
+  PROFILE_PERIOD("control.period", micros() * 1000U);
+
+  // At most one command per period, so a burst can't delay the control step
+  this->parent.handleCommand(SerialManager::getInstance().read());
+
+  // The mode task enters the state the switch selects
+  this->parent.modeStateMachine.runOnce();
+}
+
+char const* Application::ControlTask::name()
+{
+  return "ControlTask";
+}
+
+//////////////////////////////////////////////////////////////////////
+// MotionTask
+//////////////////////////////////////////////////////////////////////
+
+Application::MotionTask::MotionTask(Application& parent) : parent(parent)
+{
+}
+
+void Application::MotionTask::runOnce(uint32_t nowMs)
+{
+  this->parent.danceMotion.update(
+      this->parent.hardware.joints, this->parent.hardware.eyes, nowMs);
+}
+
+char const* Application::MotionTask::name()
+{
+  return "MotionTask";
+}
+
+//////////////////////////////////////////////////////////////////////
+// EyesTask
+//////////////////////////////////////////////////////////////////////
+
+Application::EyesTask::EyesTask(Application& parent) : parent(parent)
+{
+}
+
+void Application::EyesTask::runOnce(uint32_t nowMs)
+{
+  this->parent.hardware.eyes.update(nowMs);
+}
+
+char const* Application::EyesTask::name()
+{
+  return "EyesTask";
+}
+
+//////////////////////////////////////////////////////////////////////
+// LoggingTask
+//////////////////////////////////////////////////////////////////////
+
+void Application::LoggingTask::runOnce(uint32_t /*nowMs*/)
+{
+  PROFILE_SERVICE();
+  LOG_FLUSH();
 }
 
-IState* Application::getDesiredState()
+char const* Application::LoggingTask::name()
 {
-  Switch::State currentSwitchState = this->hardware->modeSwitch.getState();
-  return currentSwitchState == Switch::State::on ? this->danceState.get()
-                                                 : this->trackingState.get();
+  return "LoggingTask";
 }
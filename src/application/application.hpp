@@ -1,29 +1,178 @@
 #pragma once
+#include "application/danceState.hpp"
+#include "application/trackingState.hpp"
 #include "hardware/hardware.hpp"
-#include "iState.hpp"
-#include <memory>
+#include "motion/bodyMotion.hpp"
+#include "scheduling/scheduler.hpp"
+#include "stateMachine.hpp"
 
 /**
  * @brief High-level Application class that manages the high-level StateMachine
  * (DanceState and TrackingState)
  *
- * The desired state is determined in the getDesiredState method. If the desired
- * state is new, the new state is entered, otherwise the state is runOnce
+ * The application is split into fixed-rate, non-blocking tasks that are
+ * time-sliced by a cooperative Scheduler:
+ *
+ * - Mode: debounces the mode switch and picks up its events. When the switch
+ *   has been flipped, the dance motion is stopped and the state the switch
+ *   selects (see getDesiredState) is entered straight away
+ * - Sensing: collects sonar echoes and pings the sonar array
+ * - Control: handles a command from the serial link, then runs the current
+ *   state once
+ * - Motion: advances the active dance motion
+ * - Eyes: advances the queued eye crossfades
+ * - Logging: flushes queued log messages to the serial link (and, in
+ *   profiling builds, logs the profile on request)
+ *
+ * Since no task blocks, a flip of the mode switch is acted on within the
+ * switch's debounce time plus one mode period
+ *
+ * Serial commands (one character each):
+ *
+ * - AUTO_TUNE_COMMAND: tune the TrackingState gains (see TrackingState)
+ * - Profiler::DUMP_COMMAND: log the profile, in profiling builds
+ *
+ * The application holds the hardware, the dance motion and the states by
+ * value, and the states refer back to them, so it can be a static object: it
+ * takes no heap, and its footprint is known at link time (see HeapGuard)
  *
  */
 class Application
 {
  public:
-  Application();
+  /**
+   * @param trackingPidParams - the TrackingState controller parameters
+   * @param predictiveTracking - see TrackingState
+   *
+   * Only the simulation changes them, to compare controllers
+   */
+  explicit Application(
+      PidParameters trackingPidParams = TrackingState::PID_PARAMS,
+      bool predictiveTracking = false);
+
+  /**
+   * @brief Run the application forever
+   *
+   */
   void run();
 
+  /**
+   * @brief Run every task that is due, once. Used by the simulation, which
+   * moves time on between calls
+   *
+   */
+  void runOnce();
+
+  /**
+   * @brief The switch state the application last acted on, i.e. on while
+   * dancing and off while tracking. Used by the simulation
+   *
+   */
+  [[nodiscard]] Switch::State getMode() const;
+
  private:
-  std::shared_ptr<Hardware> hardware{nullptr};
+  Hardware hardware;
+  BodyMotion::DanceMotion danceMotion;
+
+  // State Machine. DanceState and TrackingState each run their own internal
+  // state machine, nested in this one
+  DanceState danceState;
+  TrackingState trackingState;
+
+  using ModeStateMachine = StateMachine<DanceState, TrackingState>;
+  ModeStateMachine modeStateMachine;
+
+  ModeStateMachine::StateId getDesiredState(Switch::State switchState);
+  void changeState(ModeStateMachine::StateId desiredState);
+
+  static constexpr char AUTO_TUNE_COMMAND{'t'};
+  void handleCommand(int command);
+
+  //////////////////////////////////////////////////////////////////////
+  // Tasks
+  //////////////////////////////////////////////////////////////////////
+
+  // Tasks are listed in priority order. The mode task only debounces the
+  // switch, so it runs often to act on a flip promptly. The sensing task only
+  // collects echo edges and triggers pings (the SonarArray spaces the pings
+  // out itself) so it runs often to pick echoes up promptly. The control
+  // period matches the TrackingState PID timestep. The motion period is one
+  // 50Hz servo PWM period, the fastest rate at which a servo can act on a new
+  // setpoint
+  static constexpr Scheduler::Timing MODE_TASK_TIMING{.periodMs = 10,
+                                                      .deadlineMs = 10};
+  static constexpr Scheduler::Timing SENSING_TASK_TIMING{.periodMs = 10,
+                                                         .deadlineMs = 10};
+  static constexpr Scheduler::Timing CONTROL_TASK_TIMING{.periodMs = 50,
+                                                         .deadlineMs = 50};
+  static constexpr Scheduler::Timing MOTION_TASK_TIMING{.periodMs = 20,
+                                                        .deadlineMs = 20};
+  static constexpr Scheduler::Timing EYES_TASK_TIMING{.periodMs = 10,
+                                                      .deadlineMs = 10};
+  static constexpr Scheduler::Timing LOGGING_TASK_TIMING{.periodMs = 10,
+                                                         .deadlineMs = 20};
+
+  Scheduler scheduler;
+
+  class ModeTask : public ITask
+  {
+   public:
+    ModeTask(Application& parent);
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
+
+   private:
+    Application& parent;
+  } modeTask;
+
+  class SensingTask : public ITask
+  {
+   public:
+    SensingTask(Application& parent);
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
+
+   private:
+    Application& parent;
+  } sensingTask;
+
+  class ControlTask : public ITask
+  {
+   public:
+    ControlTask(Application& parent);
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
+
+   private:
+    Application& parent;
+  } controlTask;
+
+  class MotionTask : public ITask
+  {
+   public:
+    MotionTask(Application& parent);
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
+
+   private:
+    Application& parent;
+  } motionTask;
+
+  class EyesTask : public ITask
+  {
+   public:
+    EyesTask(Application& parent);
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
 
-  // State Machine
-  std::unique_ptr<IState> danceState{nullptr};
-  std::unique_ptr<IState> trackingState{nullptr};
+   private:
+    Application& parent;
+  } eyesTask;
 
-  IState* getDesiredState();
-  IState* currentState{nullptr};
-};
\ No newline at end of file
+  class LoggingTask : public ITask
+  {
+   public:
+    void runOnce(uint32_t nowMs) override;
+    char const* name() override;
+  } loggingTask;
+};
@@ -1,172 +1,152 @@
 #include "danceState.hpp"
 #include "logging/log.hpp"
 #include "motion/bodyMotion.hpp"
-#include <memory>
-
-DanceState::DanceState(std::shared_ptr<Hardware> hardware)
-    : hardware(hardware), distanceToSpeed(distanceToSpeedParams),
+#include "motion/routines.hpp"
+#include "profiling/profiler.hpp"
+
+DanceState::DanceState(Hardware& hardware,
+                       BodyMotion::DanceMotion& danceMotion)
+    : hardware(hardware), danceMotion(danceMotion),
+      distanceToTempo(distanceToTempoParams),
+      distanceGuard(distanceGuardParams, TransitionGuard::Zone::below),
       tooCloseState(*this), withinRangeState(*this), outOfRangeState(*this)
 {
+  this->hardware.sonarArray.setProximityAlarm(MIN_DISTANCE_CM,
+                                               this->tooCloseAlarm);
+
   // For safety reasons, we assume an object is right in front of the robot at
   // start up
-  this->tooCloseState.enter();
+  this->internalStateMachine.enter<TooCloseState>();
 }
 
 void DanceState::enter()
 {
-  LOG_INFO("Entering the %s", this->name());
+  LOG_INFO("Entering the %s", NAME.data());
+
+  // Only an object that is too close while dancing counts
+  this->tooCloseAlarm.reset();
 
   // Having a bit of fun with different eye colours
-  for (int i = 0; i < 5; i++)
-  {
-    this->hardware->eyes.setColour(Eyes::Colour::red);
-    delay(100);
-    this->hardware->eyes.setColour(Eyes::Colour::light_blue);
-    delay(100);
-  }
+  this->hardware.eyes.blink(
+      Eyes::Colour::red, Eyes::Colour::light_blue, 5, 2 * EYE_BLINK_TIME);
   this->currentEyeColour = Eyes::Colour::light_blue;
-  delay(100);
 }
 
 void DanceState::runOnce()
 {
-  auto* desiredState = this->getDesiredState();
-  if (desiredState == nullptr)
-  {
-    LOG_WARN("%s", "Desired state is a nullptr");
-    return;
-  }
-  if (this->currentState != desiredState)
-  {
-    desiredState->enter();
-  }
-  else
-  {
-    this->currentState->runOnce();
-  }
-}
-
-char const* DanceState::name()
-{
-  return "DanceState";
+  PROFILE_STAGE("dance.cycle");
+  this->internalStateMachine.step(this->getDesiredState());
 }
 
 //////////////////////////////////////////////////////////////////////
 // Desired State Selector
 //////////////////////////////////////////////////////////////////////
 
-IState* DanceState::getDesiredState()
+DanceState::InternalStateMachine::StateId DanceState::getDesiredState()
 {
-  this->objectDistance = this->hardware->sonarArray.getDistance().min;
-  if (this->objectDistance < MIN_DISTANCE_CM)
-  {
-    return &this->tooCloseState;
-  }
-  if (this->objectDistance > MAX_DISTANCE_CM)
+  SonarArray::Distance distance = this->hardware.sonarArray.getDistance();
+  this->objectDistance = distance.min;
+
+  // For safety reasons, an untrusted distance, or a proximity alarm since the
+  // last cycle, is treated as an object right in front of the robot
+  bool alarm = this->tooCloseAlarm.isCancelled();
+  this->tooCloseAlarm.reset();
+  switch (this->distanceGuard.update(
+      distance.valid && !alarm ? this->objectDistance : 0, millis()))
   {
-    return &this->outOfRangeState;
+    case TransitionGuard::Zone::below:
+      return InternalStateMachine::id<TooCloseState>();
+    case TransitionGuard::Zone::above:
+      return InternalStateMachine::id<OutOfRangeState>();
+    case TransitionGuard::Zone::within:
+      return InternalStateMachine::id<WithinRangeState>();
   }
-  return &this->withinRangeState;
+  return InternalStateMachine::id<TooCloseState>();
 }
 
 //////////////////////////////////////////////////////////////////////
 // Base State
 //////////////////////////////////////////////////////////////////////
 
-DanceState::State::State(DanceState& parent,
-                         std::string&& stateName,
-                         Eyes::Colour eyeColour,
-                         int eyeTransitionTime)
-    : parent(parent), stateName(std::move(stateName)), eyeColour(eyeColour),
-      eyeTransitionTime(eyeTransitionTime)
-{
-}
-
-void DanceState::State::enter()
-{
-  LOG_INFO("Entering %s::%s", this->parent.name(), this->name());
-  this->parent.currentState = this;
-  this->parent.hardware->eyes.crossFade(
-      this->parent.currentEyeColour, this->eyeColour, this->eyeTransitionTime);
-  this->parent.currentEyeColour = this->eyeColour;
-}
-
-char const* DanceState::State::name()
+template <typename Derived> void DanceState::State<Derived>::enter()
 {
-  return this->stateName.c_str();
+  LOG_INFO("Entering %s::%s (%u transitions in the last minute)",
+           DanceState::NAME.data(),
+           Derived::NAME.data(),
+           this->parent.distanceGuard.getTransitionsPerMinute());
+  this->parent.hardware.eyes.crossFade(this->parent.currentEyeColour,
+                                        Derived::EYE_COLOUR,
+                                        static_cast<int>(EYE_TRANSITION_TIME));
+  this->parent.currentEyeColour = Derived::EYE_COLOUR;
 }
 
 //////////////////////////////////////////////////////////////////////
 // TooCloseState
 //////////////////////////////////////////////////////////////////////
 
-DanceState::TooCloseState::TooCloseState(DanceState& parent)
-    : State(parent, "TooCloseState", Eyes::Colour::off, EYE_TRANSITION_TIME)
-{
-}
-
 void DanceState::TooCloseState::enter()
 {
-  BodyMotion::setBothArmsToAngle(this->parent.hardware->joints, -30);
+  // For safety reasons, abandon the dance before retracting the arms
+  this->parent.danceMotion.stop();
+  BodyMotion::setBothArmsToAngle(this->parent.hardware.joints,
+                                 RETRACTED_ARM_ANGLE);
   State::enter();
 }
 
 void DanceState::TooCloseState::runOnce()
 {
-  LOG_INFO("Running %s::%s", this->parent.name(), this->name());
+  PROFILE_STAGE("dance.tooClose");
+  LOG_INFO_RATE_LIMITED(
+      1, "Running %s::%s", DanceState::NAME.data(), NAME.data());
 }
 
 //////////////////////////////////////////////////////////////////////
 // WithinRangeState
 //////////////////////////////////////////////////////////////////////
 
-DanceState::WithinRangeState::WithinRangeState(DanceState& parent)
-    : State(parent, "WithinRangeState", Eyes::Colour::red, EYE_TRANSITION_TIME)
-{
-}
-
 void DanceState::WithinRangeState::enter()
 {
   State::enter();
 
   // Have more fun with changing the eye colour
-  for (int i = 0; i < 3; i++)
-  {
-    this->parent.hardware->eyes.crossFade(
-        Eyes::Colour::blue, Eyes::Colour::red, 100);
-    this->parent.hardware->eyes.crossFade(
-        Eyes::Colour::red, Eyes::Colour::red, 100);
-  }
+  this->parent.hardware.eyes.pulse(
+      Eyes::Colour::blue, Eyes::Colour::red, 3, 2 * EYE_BLINK_TIME);
 }
 
 void DanceState::WithinRangeState::runOnce()
 {
-  LOG_INFO("Running %s::%s", this->parent.name(), this->name());
-  this->danceSpeed = static_cast<int>(
-      this->parent.distanceToSpeed.getOutput(this->parent.objectDistance));
-  BodyMotion::singleDanceMotion(this->parent.hardware->joints,
-                                this->danceSpeed,
-                                this->parent.armMotionOffset);
+  PROFILE_STAGE("dance.withinRange");
+  // The motion itself is advanced by the motion task. Here we only start the
+  // next routine, at a tempo set by the current distance, once the previous
+  // one has finished
+  if (this->parent.danceMotion.isActive())
+  {
+    return;
+  }
+
+  Choreography::Routine const& routine =
+      Routines::ROUTINES.at(this->parent.nextRoutine);
+  this->parent.nextRoutine =
+      (this->parent.nextRoutine + 1) % Routines::ROUTINES.size();
+  this->beatMs = static_cast<uint32_t>(
+      this->parent.distanceToTempo.getOutput(this->parent.objectDistance));
+
+  LOG_INFO("Running %s::%s (%s, %ums per beat)",
+           DanceState::NAME.data(),
+           NAME.data(),
+           routine.name,
+           static_cast<unsigned>(this->beatMs));
+  this->parent.danceMotion.start(
+      routine, this->beatMs, &this->parent.tooCloseAlarm);
 }
 
 //////////////////////////////////////////////////////////////////////
 // OutOfRangeState
 //////////////////////////////////////////////////////////////////////
 
-DanceState::OutOfRangeState::OutOfRangeState(DanceState& parent)
-    : State(parent,
-            "OutOfRangeState",
-            Eyes::Colour::light_blue,
-            EYE_TRANSITION_TIME)
-{
-}
-
-void DanceState::OutOfRangeState::enter()
-{
-  State::enter();
-}
-
 void DanceState::OutOfRangeState::runOnce()
 {
-  LOG_INFO("Running %s::%s", this->parent.name(), this->name());
+  PROFILE_STAGE("dance.outOfRange");
+  LOG_INFO_RATE_LIMITED(
+      1, "Running %s::%s", DanceState::NAME.data(), NAME.data());
 }
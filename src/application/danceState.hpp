@@ -1,97 +1,133 @@
 #pragma once
 #include "control/linearMap.hpp"
+#include "control/transitionGuard.hpp"
 #include "hardware/hardware.hpp"
-#include "iState.hpp"
-#include <memory>
+#include "motion/bodyMotion.hpp"
+#include "stateMachine.hpp"
+#include <string_view>
 
-class DanceState : public IState
+class DanceState
 {
  public:
-  DanceState(std::shared_ptr<Hardware> hardware);
-  void enter() override;
-  void runOnce() override;
-  char const* name() override;
+  static constexpr std::string_view NAME{"DanceState"};
+
+  DanceState(Hardware& hardware, BodyMotion::DanceMotion& danceMotion);
+  void enter();
+  void runOnce();
+
+  // Closer than this, the robot stops dancing and retracts its arms to
+  // RETRACTED_ARM_ANGLE, for safety
+  static constexpr float MIN_DISTANCE_CM{25};
+  static constexpr int RETRACTED_ARM_ANGLE{-30};
+
+  // Further than this, the robot stops dancing
+  static constexpr float MAX_DISTANCE_CM{75};
+
+  // The closer the object, the faster the tempo, in milliseconds per beat
+  static constexpr LinearMap::Params distanceToTempoParams{
+      .inputMin = MIN_DISTANCE_CM,
+      .inputMax = MAX_DISTANCE_CM,
+      .outputMin = 125,
+      .outputMax = 750};
+
+  // Guards the transitions between the internal states so an object sitting
+  // near MIN_DISTANCE_CM or MAX_DISTANCE_CM can't make them flap. A state is
+  // held for at least its eye transition
+  static constexpr uint32_t EYE_TRANSITION_TIME{500};
+  static constexpr TransitionGuard::Params distanceGuardParams{
+      .lowerThreshold = MIN_DISTANCE_CM,
+      .upperThreshold = MAX_DISTANCE_CM,
+      .hysteresis = 5,
+      .minDwellMs = EYE_TRANSITION_TIME};
 
  private:
-  std::shared_ptr<Hardware> hardware;
+  Hardware& hardware;
+  BodyMotion::DanceMotion& danceMotion;
 
   float objectDistance{0};
   Eyes::Colour currentEyeColour{Eyes::Colour::light_blue};
-  static constexpr uint32_t EYE_TRANSITION_TIME{500};
+  static constexpr int EYE_BLINK_TIME{100};
 
   //////////////////////////////////////////////////////////////////////
   // Motion Params
   //////////////////////////////////////////////////////////////////////
-  int armMotionOffset{-15};
+  // The routine WithinRangeState plays next, from Routines::ROUTINES
+  size_t nextRoutine{0};
 
   //////////////////////////////////////////////////////////////////////
   // Distance Params
   //////////////////////////////////////////////////////////////////////
-  static constexpr float MIN_DISTANCE_CM{25};
-  static constexpr float MAX_DISTANCE_CM{75};
-  static constexpr LinearMap::Params distanceToSpeedParams{
-      .inputMin = MIN_DISTANCE_CM,
-      .inputMax = MAX_DISTANCE_CM,
-      .outputMin = 500,
-      .outputMax = 3000};
-  LinearMap distanceToSpeed;
+  // Raised by the SonarArray as soon as an echo comes back from closer than
+  // MIN_DISTANCE_CM. It cancels the dance motion at its next update, and
+  // takes the internal state machine to TooCloseState at its next cycle,
+  // without waiting for the distance filters to catch up
+  CancellationToken tooCloseAlarm;
+
+  LinearMap distanceToTempo;
 
   //////////////////////////////////////////////////////////////////////
   // DanceState Internal State Machine
   //////////////////////////////////////////////////////////////////////
 
-  IState* currentState{nullptr};
-  IState* getDesiredState();
+  TransitionGuard distanceGuard;
 
   /**
-   * @brief Extend IState to State enabling DanceState-specific internal
-   * State representation
+   * @brief Base of the DanceState-specific internal states: entering a state
+   * fades the eyes to its EYE_COLOUR
    *
    */
-  class State : public IState
+  template <typename Derived> class State
   {
    public:
-    State(DanceState& parent,
-          std::string&& stateName,
-          Eyes::Colour eyeColour,
-          int eyeTransitionTime);
-    void enter() override;
-    char const* name() override;
+    explicit State(DanceState& parent) : parent(parent)
+    {
+    }
+    void enter();
 
    protected:
     DanceState& parent;
-    std::string stateName;
-    Eyes::Colour eyeColour;
-    int eyeTransitionTime;
   };
 
-  class TooCloseState : public State
-
+  class TooCloseState : public State<TooCloseState>
   {
    public:
-    TooCloseState(DanceState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"TooCloseState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::off};
+
+    using State::State;
+    void enter();
+    void runOnce();
   } tooCloseState;
 
-  class WithinRangeState : public State
+  class WithinRangeState : public State<WithinRangeState>
   {
    public:
-    WithinRangeState(DanceState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"WithinRangeState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::red};
+
+    using State::State;
+    void enter();
+    void runOnce();
 
    private:
-    int danceSpeed{
-        static_cast<int>(DanceState::distanceToSpeedParams.outputMax)};
+    uint32_t beatMs{
+        static_cast<uint32_t>(DanceState::distanceToTempoParams.outputMax)};
   } withinRangeState;
 
-  class OutOfRangeState : public State
+  class OutOfRangeState : public State<OutOfRangeState>
   {
    public:
-    OutOfRangeState(DanceState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"OutOfRangeState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::light_blue};
 
+    using State::State;
+    void runOnce();
   } outOfRangeState;
-};
\ No newline at end of file
+
+  using InternalStateMachine =
+      StateMachine<TooCloseState, WithinRangeState, OutOfRangeState>;
+  InternalStateMachine internalStateMachine{
+      this->tooCloseState, this->withinRangeState, this->outOfRangeState};
+
+  InternalStateMachine::StateId getDesiredState();
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief State machine over a fixed set of states, resolved at compile time
+ *
+ * The states are plain classes, listed as the template parameters. Each must
+ * provide:
+ *
+ * - static constexpr std::string_view NAME
+ * - void enter(): called when the machine moves to the state
+ * - void runOnce(): called for each execution cycle within the state
+ *
+ * The machine holds a reference to each state (the states stay members of
+ * their owner, which they usually reach back into) and the index of the
+ * current one. A state is named by its type (id<State>(), enter<State>()),
+ * which resolves to its index at compile time, so a transition to a state the
+ * machine doesn't have doesn't build. Calls to the current state are dispatched
+ * by a fold over the state list, which compiles to a chain of comparisons the
+ * compiler can inline, rather than through a vtable.
+ *
+ * A state can own a StateMachine over its own sub-states and step it from its
+ * runOnce method, which makes the machines hierarchical (see Application).
+ *
+ * Only the set of states is part of the type, not the transitions between
+ * them. The owner picks the desired state each cycle from its inputs (e.g.
+ * DanceState::getDesiredState from the guarded sonar distance zone) and step
+ * moves there. Every machine here can go from any state to any other, so a
+ * transition table in the type would allow every pair and check nothing, and
+ * the guards are sensor readings, which are only known at run time.
+ *
+ */
+template <typename... States> class StateMachine
+{
+ public:
+  using StateId = uint8_t;
+
+  static constexpr size_t NUMBER_OF_STATES{sizeof...(States)};
+  static_assert(NUMBER_OF_STATES > 0 && NUMBER_OF_STATES < UINT8_MAX,
+                "A state machine has between 1 and 254 states");
+
+  static constexpr std::array<std::string_view, NUMBER_OF_STATES> NAMES{
+      States::NAME...};
+
+  /**
+   * @brief The machine starts outside of its states, a state must be started
+   * or entered before the machine is stepped
+   *
+   */
+  explicit StateMachine(States&... states) : states(states...)
+  {
+  }
+
+  template <typename State> static constexpr StateId id()
+  {
+    static_assert((std::is_same_v<State, States> || ...),
+                  "Not a state of this machine");
+    StateId index = 0;
+    // Counts the states before the first match
+    static_cast<void>(
+        ((std::is_same_v<State, States> ? false : (++index, true)) && ...));
+    return index;
+  }
+
+  /**
+   * @brief Make a state the current one without entering it, for a state that
+   * has already set itself up (e.g. in its constructor)
+   *
+   */
+  template <typename State> void start()
+  {
+    this->current = id<State>();
+  }
+
+  /**
+   * @brief Move to a state and enter it, even if it is the current state
+   *
+   */
+  template <typename State> void enter()
+  {
+    this->enter(id<State>());
+  }
+
+  void enter(StateId state)
+  {
+    this->current = state;
+    this->dispatch(state, [](auto& target) { target.enter(); });
+  }
+
+  /**
+   * @brief Run the current state once
+   *
+   */
+  void runOnce()
+  {
+    this->dispatch(this->current, [](auto& target) { target.runOnce(); });
+  }
+
+  /**
+   * @brief Enter the desired state if the machine isn't in it, otherwise run
+   * the current state once
+   *
+   */
+  void step(StateId desired)
+  {
+    if (desired != this->current)
+    {
+      this->enter(desired);
+    }
+    else
+    {
+      this->runOnce();
+    }
+  }
+
+  [[nodiscard]] StateId getCurrent() const
+  {
+    return this->current;
+  }
+
+  template <typename State> [[nodiscard]] bool isIn() const
+  {
+    return this->current == id<State>();
+  }
+
+  /**
+   * @brief The NAME of the current state, or an empty view before a state has
+   * been entered
+   *
+   */
+  [[nodiscard]] std::string_view getCurrentName() const
+  {
+    return this->current < NUMBER_OF_STATES ? NAMES.at(this->current)
+                                            : std::string_view{};
+  }
+
+ private:
+  static constexpr StateId NO_STATE{UINT8_MAX};
+
+  std::tuple<States&...> states;
+  StateId current{NO_STATE};
+
+  template <typename Action> void dispatch(StateId state, Action action)
+  {
+    this->dispatch(state, action, std::index_sequence_for<States...>{});
+  }
+
+  template <typename Action, size_t... Indices>
+  void dispatch(StateId state, Action action, std::index_sequence<Indices...>)
+  {
+    static_cast<void>(
+        ((state == Indices ? (action(std::get<Indices>(this->states)), true)
+                           : false) ||
+         ...));
+  }
+};
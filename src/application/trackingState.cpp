@@ -1,52 +1,57 @@
 #include "trackingState.hpp"
 #include "logging/log.hpp"
 #include "motion/bodyMotion.hpp"
+#include "profiling/profiler.hpp"
 #include <algorithm>
-#include <utility>
+#include <cmath>
 
-TrackingState::TrackingState(std::shared_ptr<Hardware> hardware)
-    : hardware(hardware), pidController(this->pidParams),
-      waistLimits(Joints::getLimits(Joints::Name::waist)), tooCloseState(*this),
-      withinRangeState(*this), outOfRangeState(*this)
+TrackingState::TrackingState(Hardware& hardware,
+                             PidParameters pidParams,
+                             bool predictive)
+    : hardware(hardware), pidController(pidParams),
+      pidTimestepMs(pidParams.timestepMs),
+      waistLimits(Joints::getLimits(Joints::Name::waist)),
+      predictive(predictive),
+      distanceGuard(distanceGuardParams, TransitionGuard::Zone::below),
+      tooCloseState(*this), withinRangeState(*this), outOfRangeState(*this),
+      autoTuneState(*this)
 {
+  TunedGains gains{};
+  if (this->hardware.storage.load(TUNED_GAINS_RECORD, gains) &&
+      gains.version == TUNED_GAINS_VERSION)
+  {
+    LOG_INFO("%s", "Loaded the tuned tracking gains");
+    this->applyGains(gains);
+  }
+
   // For safety reasons, we assume an object is right in front of the robot at
   // start up
-  this->tooCloseState.enter();
+  this->internalStateMachine.enter<TooCloseState>();
 }
 
 void TrackingState::enter()
 {
-  LOG_INFO("Entering the %s", this->name());
-  this->hardware->eyes.setColour(Eyes::Colour::green);
-  BodyMotion::setBothArmsToAngle(this->hardware->joints, ARM_ANGLE);
+  LOG_INFO("Entering the %s", NAME.data());
+  this->hardware.eyes.setColour(Eyes::Colour::green);
+  BodyMotion::setBothArmsToAngle(this->hardware.joints, ARM_ANGLE);
   this->setWaistAngle(0);
 }
 
 void TrackingState::runOnce()
 {
-  auto* desiredState = this->getDesiredState();
-  if (desiredState == nullptr)
-  {
-    LOG_WARN("%s", "Desired state is a nullptr");
-    return;
-  }
-  if (this->currentState != desiredState)
-  {
-    desiredState->enter();
-  }
-  else
-  {
-    this->currentState->runOnce();
-  }
+  PROFILE_STAGE("tracking.cycle");
+  this->internalStateMachine.step(this->getDesiredState());
 }
 
-char const* TrackingState::name()
+void TrackingState::requestAutoTune()
 {
-  return "TrackingState";
+  LOG_INFO("%s", "Auto-tuning requested");
+  this->autoTuneRequested = true;
 }
 
 void TrackingState::setWaistAngle(int angle)
 {
+  PROFILE_STAGE("tracking.waistWrite");
   if (angle < this->waistLimits.minAngle || angle > this->waistLimits.maxAngle)
   {
     LOG_WARN("Attempted to set a waist angle: %d out of bounds: [%d, %d] - "
@@ -59,130 +64,254 @@ void TrackingState::setWaistAngle(int angle)
     this->waistAngle = std::clamp(
         angle, this->waistLimits.minAngle, this->waistLimits.maxAngle);
   }
-  this->hardware->joints.setAngle(Joints::Name::waist, this->waistAngle);
+  this->hardware.joints.setAngle(Joints::Name::waist, this->waistAngle);
 }
 
 //////////////////////////////////////////////////////////////////////
 // Desired State Selector
 //////////////////////////////////////////////////////////////////////
 
-IState* TrackingState::getDesiredState()
+TrackingState::InternalStateMachine::StateId TrackingState::getDesiredState()
 {
-  this->objectDistance = this->hardware->sonarArray.getDistance().min;
-  if (this->objectDistance < MIN_DISTANCE_CM)
-  {
-    return &this->tooCloseState;
-  }
-  if (this->objectDistance > MAX_DISTANCE_CM)
+  SonarArray::Distance distance = this->hardware.sonarArray.getDistance();
+  this->objectDistance = distance.min;
+
+  // For safety reasons, an untrusted distance is treated as an object right in
+  // front of the robot
+  switch (this->distanceGuard.update(distance.valid ? this->objectDistance : 0,
+                                     millis()))
   {
-    return &this->outOfRangeState;
+    case TransitionGuard::Zone::below:
+      return InternalStateMachine::id<TooCloseState>();
+    case TransitionGuard::Zone::above:
+      return InternalStateMachine::id<OutOfRangeState>();
+    case TransitionGuard::Zone::within:
+      if (this->autoTuneRequested)
+      {
+        return InternalStateMachine::id<AutoTuneState>();
+      }
+      return InternalStateMachine::id<WithinRangeState>();
   }
-  return &this->withinRangeState;
+  return InternalStateMachine::id<TooCloseState>();
 }
 
 //////////////////////////////////////////////////////////////////////
 // Base State
 //////////////////////////////////////////////////////////////////////
 
-TrackingState::State::State(TrackingState& parent,
-                            std::string&& stateName,
-                            Eyes::Colour eyeColour,
-                            int eyeTransitionTime)
-    : parent(parent), stateName(std::move(stateName)), eyeColour(eyeColour),
-      eyeTransitionTime(eyeTransitionTime)
-{
-}
-
-void TrackingState::State::enter()
+template <typename Derived> void TrackingState::State<Derived>::enter()
 {
-  LOG_INFO("Entering %s::%s", this->parent.name(), this->name());
+  LOG_INFO("Entering %s::%s (%u transitions in the last minute)",
+           TrackingState::NAME.data(),
+           Derived::NAME.data(),
+           this->parent.distanceGuard.getTransitionsPerMinute());
   this->parent.waistAngle = 0;
-  this->parent.hardware->joints.setAngle(Joints::Name::waist,
+  this->parent.hardware.joints.setAngle(Joints::Name::waist,
                                          this->parent.waistAngle);
-  this->parent.currentState = this;
-  this->parent.hardware->eyes.crossFade(
-      this->parent.currentEyeColour, this->eyeColour, this->eyeTransitionTime);
-  this->parent.currentEyeColour = this->eyeColour;
-}
-
-char const* TrackingState::State::name()
-{
-  return this->stateName.c_str();
+  this->parent.hardware.eyes.crossFade(this->parent.currentEyeColour,
+                                        Derived::EYE_COLOUR,
+                                        static_cast<int>(EYE_TRANSITION_TIME));
+  this->parent.currentEyeColour = Derived::EYE_COLOUR;
 }
 
 //////////////////////////////////////////////////////////////////////
 // TooCloseState
 //////////////////////////////////////////////////////////////////////
 
-TrackingState::TooCloseState::TooCloseState(TrackingState& parent)
-    : State(parent, "TooCloseState", Eyes::Colour::off, EYE_TRANSITION_TIME)
-{
-}
-
-void TrackingState::TooCloseState::enter()
-{
-  State::enter();
-}
-
 void TrackingState::TooCloseState::runOnce()
 {
-  LOG_INFO("Running once %s::%s", this->parent.name(), this->name());
+  PROFILE_STAGE("tracking.tooClose");
+  LOG_INFO_RATE_LIMITED(
+      1, "Running once %s::%s", TrackingState::NAME.data(), NAME.data());
 }
 
 //////////////////////////////////////////////////////////////////////
 // WithinRangeState
 //////////////////////////////////////////////////////////////////////
 
-TrackingState::WithinRangeState::WithinRangeState(TrackingState& parent)
-    : State(parent, "WithinRangeState", Eyes::Colour::red, EYE_TRANSITION_TIME)
-{
-}
-
 void TrackingState::WithinRangeState::enter()
 {
   State::enter();
+
+  // The controller's history is from the last time the object was in range
+  this->parent.pidController.reset();
+  this->parent.resetPrediction();
 }
 
 // Here we apply the very simple control algorithm which is used to a track an
 // object in front of the robot
 void TrackingState::WithinRangeState::runOnce()
 {
+  PROFILE_STAGE("tracking.withinRange");
   SonarArray::Distance distance =
-      this->parent.hardware->sonarArray.getDistance();
+      this->parent.hardware.sonarArray.getDistance();
 
   float difference = distance.right - distance.left;
+  float feedForward = 0;
+  if (this->parent.predictive)
+  {
+    Prediction prediction = this->parent.predict(distance);
+    difference = prediction.difference;
+    feedForward = prediction.angleChange;
+  }
 
+  // The control task period jitters, so step the controller with the time
+  // that has actually passed
   int controlSignal = static_cast<int>(
-      this->parent.pidController.getControlSignal(difference, 0));
+      this->parent.pidController.getControlSignal(micros(), difference, 0));
 
   if (std::fabs(difference) > 5)
   {
     this->parent.waistAngle += controlSignal;
   }
 
+  // The waist moves in whole degrees, so a slow object's feed-forward builds
+  // up over a few cycles
+  this->parent.feedForwardRemainder += feedForward;
+  int feedForwardSteps = static_cast<int>(this->parent.feedForwardRemainder);
+  this->parent.feedForwardRemainder -= static_cast<float>(feedForwardSteps);
+  this->parent.waistAngle += feedForwardSteps;
+
   this->parent.setWaistAngle(this->parent.waistAngle);
+}
 
-  delay(this->parent.pidParams.timestepMs);
+//////////////////////////////////////////////////////////////////////
+// Prediction
+//////////////////////////////////////////////////////////////////////
+
+TrackingState::Prediction
+TrackingState::predict(SonarArray::Distance const& distance)
+{
+  PROFILE_STAGE("tracking.predict");
+
+  // The object's bearing from where the robot faced at start up, when the
+  // sonar measured it
+  SonarArray::Position position = SonarArray::getPosition(distance);
+  int& laggedWaistAngle =
+      this->waistAngleHistory.at(this->waistAngleHistoryIndex);
+  float bearing = static_cast<float>(laggedWaistAngle) + position.bearingDeg;
+  laggedWaistAngle = this->waistAngle;
+  this->waistAngleHistoryIndex =
+      (this->waistAngleHistoryIndex + 1) % SONAR_LAG_CYCLES;
+
+  // Measured timestep, bounded like the controller's
+  uint32_t nowUs = micros();
+  uint32_t timestepUs = std::clamp(nowUs - this->previousPredictionUs,
+                                   this->pidTimestepMs * 500,
+                                   this->pidTimestepMs * 2000);
+  this->previousPredictionUs = nowUs;
+  float timestepS = static_cast<float>(timestepUs) / 1e6F;
+
+  AlphaBetaFilter::Estimate estimate =
+      this->bearingFilter.update(bearing, timestepS);
+  float predictedBearing = this->bearingFilter.predict(
+      static_cast<float>(PREDICTION_LEAD_MS) / 1e3F);
+
+  // Back to the distances the controller works on, at the measured range
+  SonarArray::Distance predictedDistance = SonarArray::positionToDistance(
+      {.bearingDeg = predictedBearing - static_cast<float>(this->waistAngle),
+       .rangeCm = position.rangeCm});
+  return {.difference = predictedDistance.right - predictedDistance.left,
+          .angleChange = std::clamp(estimate.velocity * timestepS,
+                                    -MAX_ANGLE_CHANGE,
+                                    MAX_ANGLE_CHANGE)};
+}
+
+void TrackingState::resetPrediction()
+{
+  this->bearingFilter.reset();
+  this->waistAngleHistory.fill(this->waistAngle);
+  this->previousPredictionUs = micros();
+  this->feedForwardRemainder = 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 // OutOfRangeState
 //////////////////////////////////////////////////////////////////////
 
-TrackingState::OutOfRangeState::OutOfRangeState(TrackingState& parent)
-    : State(parent,
-            "OutOfRangeState",
-            Eyes::Colour::light_blue,
-            EYE_TRANSITION_TIME)
+void TrackingState::OutOfRangeState::runOnce()
+{
+  PROFILE_STAGE("tracking.outOfRange");
+  LOG_INFO_RATE_LIMITED(
+      1, "Running once %s::%s", TrackingState::NAME.data(), NAME.data());
+}
+//////////////////////////////////////////////////////////////////////
+// Auto-tuning
+//////////////////////////////////////////////////////////////////////
+
+TrackingState::TunedGains
+TrackingState::getTunedGains(RelayAutoTuner::Result result) const
+{
+  RelayAutoTuner::PiGains pi = RelayAutoTuner::zieglerNicholsPi(result);
+  float timestepS = static_cast<float>(this->pidTimestepMs) / 1000.0F;
+
+  // The control signal is added to the waist angle every cycle, so the PID is
+  // the incremental form of a positional PI controller (the relay experiment
+  // tunes the positional controller):
+  //   delta angle = Kp' * delta error + Kp' / Ti * error * dt
+  // i.e. Kp = Kp' * dt / Ti and Kd = Kp' * dt
+  return {.version = TUNED_GAINS_VERSION,
+          .Kp = pi.Kp * timestepS / pi.integralTimeS,
+          .Kd = pi.Kp * timestepS,
+          .Ki = 0};
+}
+
+void TrackingState::applyGains(TunedGains const& gains)
 {
+  LOG_INFO("Tracking gains: Kp %.3f, Kd %.3f, Ki %.3f",
+           gains.Kp,
+           gains.Kd,
+           gains.Ki);
+  this->pidController.updateKp(gains.Kp);
+  this->pidController.updateKd(gains.Kd);
+  this->pidController.updateKi(gains.Ki);
 }
 
-void TrackingState::OutOfRangeState::enter()
+//////////////////////////////////////////////////////////////////////
+// AutoTuneState
+//////////////////////////////////////////////////////////////////////
+
+void TrackingState::AutoTuneState::enter()
 {
   State::enter();
+  this->parent.autoTuner.start(millis());
 }
 
-void TrackingState::OutOfRangeState::runOnce()
+void TrackingState::AutoTuneState::runOnce()
 {
-  LOG_INFO("Running once %s::%s", this->parent.name(), this->name());
-}
\ No newline at end of file
+  PROFILE_STAGE("tracking.autoTune");
+  SonarArray::Distance distance =
+      this->parent.hardware.sonarArray.getDistance();
+
+  // Same sign as the controller's error
+  float error = distance.left - distance.right;
+  float relayOutput = this->parent.autoTuner.update(error, millis());
+
+  switch (this->parent.autoTuner.getStatus())
+  {
+    case RelayAutoTuner::Status::running:
+      this->parent.waistAngle = static_cast<int>(relayOutput);
+      this->parent.setWaistAngle(this->parent.waistAngle);
+      return;
+    case RelayAutoTuner::Status::failed:
+      LOG_WARN("%s", "Auto-tuning failed, keeping the tracking gains");
+      break;
+    case RelayAutoTuner::Status::finished:
+    {
+      RelayAutoTuner::Result result = this->parent.autoTuner.getResult();
+      LOG_INFO("Auto-tuning finished: ultimate gain %.3f, period %.3fs",
+               result.ultimateGain,
+               result.ultimatePeriodS);
+      TunedGains gains = this->parent.getTunedGains(result);
+      this->parent.applyGains(gains);
+      if (!this->parent.hardware.storage.save(TUNED_GAINS_RECORD, gains))
+      {
+        LOG_WARN("%s", "Unable to save the tuned tracking gains");
+      }
+      break;
+    }
+  }
+
+  // Back to tracking, with the new gains
+  this->parent.autoTuneRequested = false;
+}
@@ -1,25 +1,73 @@
 #pragma once
+#include "control/alphaBetaFilter.hpp"
 #include "control/pidController.hpp"
+#include "control/relayAutoTuner.hpp"
+#include "control/transitionGuard.hpp"
 #include "hardware/hardware.hpp"
-#include "iState.hpp"
-#include <memory>
+#include "stateMachine.hpp"
+#include <array>
+#include <string_view>
 
 /**
  * @brief In this state the robot attempts to "track" (or face) the object in
  * front of it. It does this by rotating left or right depending on
  * whether the object is more to the left or more to the right of the robot.
  *
+ * The tracking can be made predictive: an AlphaBetaFilter estimates the
+ * bearing of the object and its angular velocity from the sonar distances.
+ * The controller steers towards where the object will be PREDICTION_LEAD_MS
+ * from now, which makes up for the lag of the sonar filtering, and the
+ * estimated velocity is fed forward so the waist keeps pace with a moving
+ * object. It is off by default: in the simulation it follows a moving object
+ * more closely, but overshoots some target steps further and moves the waist
+ * far more often, and it hasn't been tuned on the robot.
+ *
+ * On request, the next time an object is within range the controller gains
+ * are tuned by a relay feedback experiment (AutoTuneState). The tuned gains
+ * are persisted, and loaded again at start up.
+ *
  */
-class TrackingState : public IState
+class TrackingState
 {
  public:
-  TrackingState(std::shared_ptr<Hardware> hardware);
-  void enter() override;
-  void runOnce() override;
-  char const* name() override;
+  static constexpr std::string_view NAME{"TrackingState"};
+
+  static constexpr float MAX_ANGLE_CHANGE{10};
+
+  // The waist angle change controller
+  static constexpr PidParameters PID_PARAMS{
+      .Kp = 1.5,
+      .Kd = 0.0,
+      .Ki = 0,
+      .timestepMs = 50,
+      .maxControlSignal = MAX_ANGLE_CHANGE,
+      .minControlSignal = -MAX_ANGLE_CHANGE};
+
+  // The bearing estimator and how far ahead it predicts. Tuned in the
+  // simulation (scenarios/moving.txt), not yet on the robot
+  static constexpr AlphaBetaFilter::Params BEARING_FILTER_PARAMS{.alpha = 0.6,
+                                                                 .beta = 0.2};
+  static constexpr uint32_t PREDICTION_LEAD_MS{150};
+
+  /**
+   * @param predictive - true steers on the predicted bearing, false on the
+   * measured distances alone. The simulation uses it to compare the two
+   */
+  TrackingState(Hardware& hardware,
+                PidParameters pidParams = PID_PARAMS,
+                bool predictive = false);
+  void enter();
+  void runOnce();
+
+  /**
+   * @brief Tune the controller gains the next time an object is within range.
+   * The object should stand still, straight in front of the robot
+   *
+   */
+  void requestAutoTune();
 
  private:
-  std::shared_ptr<Hardware> hardware;
+  Hardware& hardware;
 
   int waistAngle{0};
   float objectDistance{0};
@@ -36,69 +84,157 @@ class TrackingState : public IState
   // Control
   //////////////////////////////////////////////////////////////////////
 
-  static constexpr float MAX_ANGLE_CHANGE{10};
-  PidController::Parameters pidParams{.Kp = 1.5,
-                                      .Kd = 0.0,
-                                      .Ki = 0,
-                                      .timestepMs = 50,
-                                      .maxControlSignal = MAX_ANGLE_CHANGE,
-                                      .minControlSignal = -MAX_ANGLE_CHANGE};
-
-  PidController pidController;
+  PidController<float> pidController;
+  uint32_t pidTimestepMs;
   Joints::Limits waistLimits;
 
   //////////////////////////////////////////////////////////////////////
-  // TrackingState internal StateMachine
+  // Prediction
   //////////////////////////////////////////////////////////////////////
 
-  IState* currentState{nullptr};
+  struct Prediction
+  {
+    // right - left distance the object would cause at its predicted bearing
+    float difference;
+
+    // Waist angle change that keeps pace with the object this cycle
+    float angleChange;
+  };
+
+  // The filtered sonar distances lag the waist by about this many control
+  // cycles, so a measurement is paired with the waist angle from then.
+  // Pairing it with the current angle would make the waist's own motion look
+  // like the object moving
+  static constexpr size_t SONAR_LAG_CYCLES{4};
+
+  bool predictive;
+  AlphaBetaFilter bearingFilter{BEARING_FILTER_PARAMS};
+  std::array<int, SONAR_LAG_CYCLES> waistAngleHistory{};
+  size_t waistAngleHistoryIndex{0};
+  uint32_t previousPredictionUs{0};
 
-  IState* getDesiredState();
+  // Fraction of a degree of the feed-forward not yet applied to the waist
+  float feedForwardRemainder{0};
+
+  Prediction predict(SonarArray::Distance const& distance);
+  void resetPrediction();
+
+  //////////////////////////////////////////////////////////////////////
+  // Auto-tuning
+  //////////////////////////////////////////////////////////////////////
+
+  // The relay turns the waist 10 degrees either side of straight ahead
+  static constexpr RelayAutoTuner::Params AUTO_TUNE_PARAMS{
+      .relayAmplitude = 10,
+      .hysteresis = 2,
+      .settleCycles = 1,
+      .measureCycles = 3,
+      .timeoutMs = 20000};
+
+  // Record of the tuned gains in Storage. Bump the version whenever the
+  // layout changes
+  struct TunedGains
+  {
+    uint32_t version;
+    float Kp;
+    float Kd;
+    float Ki;
+  };
+  static constexpr uint32_t TUNED_GAINS_VERSION{1};
+  static constexpr char const* TUNED_GAINS_RECORD{"/tracking_gains"};
+
+  bool autoTuneRequested{false};
+  RelayAutoTuner autoTuner{AUTO_TUNE_PARAMS};
+
+  [[nodiscard]] TunedGains getTunedGains(RelayAutoTuner::Result result) const;
+  void applyGains(TunedGains const& gains);
+
+  //////////////////////////////////////////////////////////////////////
+  // TrackingState internal StateMachine
+  //////////////////////////////////////////////////////////////////////
+
+  // Guards the transitions between the internal states so an object sitting
+  // near MIN_DISTANCE_CM or MAX_DISTANCE_CM can't make them flap
+  static constexpr TransitionGuard::Params distanceGuardParams{
+      .lowerThreshold = MIN_DISTANCE_CM,
+      .upperThreshold = MAX_DISTANCE_CM,
+      .hysteresis = 5,
+      .minDwellMs = EYE_TRANSITION_TIME};
+  TransitionGuard distanceGuard;
 
   /**
-   * @brief Extend IState to State enabling TrackingState specific internal
-   * State representation
+   * @brief Base of the TrackingState-specific internal states: entering a
+   * state centres the waist and fades the eyes to its EYE_COLOUR
    *
    */
-  class State : public IState
+  template <typename Derived> class State
   {
    public:
-    State(TrackingState& parent,
-          std::string&& stateName,
-          Eyes::Colour eyeColour,
-          int eyeTransitionTime);
-    void enter() override;
-    char const* name() override;
+    explicit State(TrackingState& parent) : parent(parent)
+    {
+    }
+    void enter();
 
    protected:
     TrackingState& parent;
-    std::string stateName;
-    Eyes::Colour eyeColour;
-    int eyeTransitionTime;
   };
 
-  class TooCloseState : public State
+  class TooCloseState : public State<TooCloseState>
   {
    public:
-    TooCloseState(TrackingState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"TooCloseState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::off};
+
+    using State::State;
+    void runOnce();
   } tooCloseState;
 
-  class WithinRangeState : public State
+  class WithinRangeState : public State<WithinRangeState>
   {
    public:
-    WithinRangeState(TrackingState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"WithinRangeState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::red};
+
+    using State::State;
+    void enter();
+    void runOnce();
   } withinRangeState;
 
-  class OutOfRangeState : public State
+  class OutOfRangeState : public State<OutOfRangeState>
   {
    public:
-    OutOfRangeState(TrackingState& parent);
-    void enter() override;
-    void runOnce() override;
+    static constexpr std::string_view NAME{"OutOfRangeState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::light_blue};
 
+    using State::State;
+    void runOnce();
   } outOfRangeState;
-};
\ No newline at end of file
+
+  /**
+   * @brief Replaces the controller with a relay that turns the waist either
+   * side of straight ahead, measures the oscillation this causes and derives
+   * the controller gains from it
+   *
+   */
+  class AutoTuneState : public State<AutoTuneState>
+  {
+   public:
+    static constexpr std::string_view NAME{"AutoTuneState"};
+    static constexpr Eyes::Colour EYE_COLOUR{Eyes::Colour::blue};
+
+    using State::State;
+    void enter();
+    void runOnce();
+  } autoTuneState;
+
+  using InternalStateMachine = StateMachine<TooCloseState,
+                                            WithinRangeState,
+                                            OutOfRangeState,
+                                            AutoTuneState>;
+  InternalStateMachine internalStateMachine{this->tooCloseState,
+                                            this->withinRangeState,
+                                            this->outOfRangeState,
+                                            this->autoTuneState};
+
+  InternalStateMachine::StateId getDesiredState();
+};
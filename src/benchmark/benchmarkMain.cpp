@@ -0,0 +1,183 @@
+#include "application/application.hpp"
+#include "profiling/profiler.hpp"
+#include "simulation/simulator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Entry point of the benchmark build. Runs the Application against the
+// Simulator, with the control path instrumented by the PROFILE_* macros, and
+// writes a JSON report of the latency histogram of every stage:
+//
+//   program <scenario file> [--report <json file>] [--cpu-slowdown <factor>]
+//
+// The stage latencies are timed with the host clock (the CycleCounter
+// fallback). Virtual time moves on by one tick per scheduler run and, with
+// --cpu-slowdown, by the host execution time of the run multiplied by the
+// factor. That approximates a slower target and makes the control period
+// jitter reflect the execution time of the tasks.
+// Use scripts/compare_benchmark_reports.py to compare two reports
+
+namespace
+{
+
+constexpr uint64_t TICK_US{1000};
+
+// Percentile reported for every stage
+constexpr float REPORT_PERCENTILE{0.99F};
+
+struct Options
+{
+  std::string scenarioPath;
+  std::string reportPath;
+  double cpuSlowdown{0};
+};
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--report") == 0 && hasValue)
+    {
+      options.reportPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--cpu-slowdown") == 0 && hasValue)
+    {
+      options.cpuSlowdown = std::strtod(argv[++i], nullptr);
+    }
+    else if (options.scenarioPath.empty() && argv[i][0] != '-')
+    {
+      options.scenarioPath = argv[i];
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return !options.scenarioPath.empty() && options.cpuSlowdown >= 0;
+}
+
+void writeReport(std::ostream& report,
+                 Options const& options,
+                 uint64_t simulatedUs,
+                 double wallTimeS)
+{
+  Profiler const& profiler = Profiler::getInstance();
+
+  report << "{\n";
+  report << "  \"scenario\": \"" << options.scenarioPath << "\",\n";
+  report << "  \"simulated_ms\": " << simulatedUs / 1000 << ",\n";
+  report << "  \"wall_time_s\": " << wallTimeS << ",\n";
+  report << "  \"cpu_slowdown\": " << options.cpuSlowdown << ",\n";
+  report << "  \"stages\": [";
+
+  for (size_t i = 0; i < profiler.getNumberOfStages(); i++)
+  {
+    Profiler::Stage const& stage = profiler.getStage(i);
+    LatencyHistogram const& histogram = stage.samples;
+
+    report << (i == 0 ? "\n" : ",\n");
+    report << "    {\n";
+    report << "      \"name\": \"" << stage.name << "\",\n";
+    report << "      \"count\": " << histogram.getCount() << ",\n";
+    report << "      \"min_ns\": " << histogram.getMin() << ",\n";
+    report << "      \"mean_ns\": " << histogram.getMean() << ",\n";
+    report << "      \"p99_ns\": "
+           << histogram.getPercentile(REPORT_PERCENTILE) << ",\n";
+    report << "      \"max_ns\": " << histogram.getMax() << ",\n";
+    report << "      \"jitter_ns\": "
+           << histogram.getMax() - histogram.getMin() << ",\n";
+
+    // Only the buckets that hold samples, as [lower bound, upper bound, count]
+    report << "      \"buckets\": [";
+    bool first = true;
+    for (size_t bucket = 0; bucket < LatencyHistogram::NUMBER_OF_BUCKETS;
+         bucket++)
+    {
+      uint32_t count = histogram.getBucketCount(bucket);
+      if (count == 0)
+      {
+        continue;
+      }
+      report << (first ? "" : ", ") << "["
+             << LatencyHistogram::bucketLowerBound(bucket) << ", "
+             << LatencyHistogram::bucketUpperBound(bucket) << ", " << count
+             << "]";
+      first = false;
+    }
+    report << "]\n";
+    report << "    }";
+  }
+
+  report << "\n  ]\n";
+  report << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr,
+                 "Usage: %s <scenario file> [--report <json file>] "
+                 "[--cpu-slowdown <factor>]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Scenario scenario;
+  std::string error;
+  if (!scenario.load(options.scenarioPath, error))
+  {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  uint64_t endUs = static_cast<uint64_t>(scenario.endMs()) * 1000;
+
+  // The log is not part of the report
+  Simulator& simulator = Simulator::getInstance();
+  simulator.setScenario(std::move(scenario));
+  simulator.setUartOutput(nullptr);
+
+  auto wallStart = std::chrono::steady_clock::now();
+
+  Application application;
+  while (simulator.nowUs() < endUs)
+  {
+    auto runStart = std::chrono::steady_clock::now();
+    application.runOnce();
+    std::chrono::duration<double, std::micro> runTime =
+        std::chrono::steady_clock::now() - runStart;
+
+    simulator.advance(
+        TICK_US + static_cast<uint64_t>(runTime.count() * options.cpuSlowdown));
+  }
+
+  std::chrono::duration<double> wallTime =
+      std::chrono::steady_clock::now() - wallStart;
+
+  if (options.reportPath.empty())
+  {
+    writeReport(std::cout, options, simulator.nowUs(), wallTime.count());
+    return EXIT_SUCCESS;
+  }
+
+  std::ofstream report(options.reportPath);
+  if (!report)
+  {
+    std::fprintf(stderr,
+                 "Unable to write the report to %s\n",
+                 options.reportPath.c_str());
+    return EXIT_FAILURE;
+  }
+  writeReport(report, options, simulator.nowUs(), wallTime.count());
+  return EXIT_SUCCESS;
+}
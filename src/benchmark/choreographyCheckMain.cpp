@@ -0,0 +1,275 @@
+#include "Arduino.h"
+#include "application/danceState.hpp"
+#include "hardware/eyes.hpp"
+#include "hardware/joints.hpp"
+#include "motion/bodyMotion.hpp"
+#include "motion/routines.hpp"
+#include "simulation/simulator.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Entry point of the choreography check build. Plays every routine in
+// Routines::ROUTINES on the simulated joints and eyes, at the slowest and the
+// fastest DanceState tempo, updating at the motion task period, and checks
+// that:
+//
+// - the routine is valid (see Choreography::isValid)
+// - the motion ends within one update of the routine's length
+// - every joint ends on its last keyframe
+// - no joint is ever commanded outside the angles its keyframes (and its
+//   starting angle) span, i.e. the profiles don't overshoot
+// - the eye cues have all played by the end of the routine
+//
+// It also reports, for information, the flash each routine takes, the fastest
+// joint speed it commands and how far the (speed limited) simulated servos
+// fall behind the commanded angles, and the host time per update
+//
+// Exits with a failure if any check fails
+
+namespace
+{
+
+using Choreography::Keyframe;
+using Choreography::Routine;
+using Choreography::Track;
+
+// Application::MOTION_TASK_TIMING
+constexpr uint32_t MOTION_PERIOD_MS{20};
+
+constexpr std::array<uint32_t, 2> TEMPOS{
+    static_cast<uint32_t>(DanceState::distanceToTempoParams.outputMax),
+    static_cast<uint32_t>(DanceState::distanceToTempoParams.outputMin)};
+
+constexpr std::array<Track, 3> JOINT_TRACKS{
+    Track::waist, Track::leftShoulder, Track::rightShoulder};
+
+constexpr std::array<Simulator::Joint, 3> SIMULATED_JOINTS{
+    Simulator::Joint::waist,
+    Simulator::Joint::leftShoulder,
+    Simulator::Joint::rightShoulder};
+
+// Playbacks timed per routine and tempo
+constexpr int TIMING_REPEATS{200};
+
+int jointAngle(Joints::Angles const& angles, Track track)
+{
+  switch (track)
+  {
+    case Track::waist:
+      return angles.waist;
+    case Track::leftShoulder:
+      return angles.leftShoulder;
+    case Track::rightShoulder:
+      return angles.rightShoulder;
+    case Track::eyes:
+      break;
+  }
+  return 0;
+}
+
+size_t flashBytes(Routine const& routine)
+{
+  return sizeof(Routine) + std::strlen(routine.name) + 1 +
+         routine.numberOfKeyframes * sizeof(Keyframe);
+}
+
+struct Playback
+{
+  uint32_t durationMs;
+  Joints::Angles endAngles;
+  bool overshoot;
+  bool eyesFading;
+  float peakSpeedDegPerS;
+  float peakLagDeg;
+};
+
+// Play the routine in virtual time, from the zero position
+Playback play(Routine const& routine,
+              uint32_t beatMs,
+              Joints& joints,
+              Eyes& eyes,
+              BodyMotion::DanceMotion& motion)
+{
+  Simulator& simulator = Simulator::getInstance();
+  BodyMotion::allJointsToZero(joints);
+  eyes.setColour(Eyes::Colour::off);
+  simulator.advance(1000000);
+
+  // The angles each joint may be commanded to
+  std::array<int, 3> lowest{};
+  std::array<int, 3> highest{};
+  for (size_t i = 0; i < routine.numberOfKeyframes; i++)
+  {
+    Keyframe const& keyframe = routine.keyframes[i];
+    if (keyframe.getTrack() == Track::eyes)
+    {
+      continue;
+    }
+    auto joint = static_cast<size_t>(keyframe.getTrack());
+    lowest.at(joint) = std::min<int>(lowest.at(joint), keyframe.value);
+    highest.at(joint) = std::max<int>(highest.at(joint), keyframe.value);
+  }
+
+  Playback playback{};
+  Joints::Angles previous = joints.getAngles();
+  uint32_t startMs = millis();
+  motion.start(routine, beatMs);
+  while (motion.isActive())
+  {
+    motion.update(joints, eyes, millis());
+    eyes.update(millis());
+
+    Joints::Angles angles = joints.getAngles();
+    for (size_t i = 0; i < JOINT_TRACKS.size(); i++)
+    {
+      int angle = jointAngle(angles, JOINT_TRACKS.at(i));
+      if (angle < lowest.at(i) || angle > highest.at(i))
+      {
+        playback.overshoot = true;
+      }
+      int step = angle - jointAngle(previous, JOINT_TRACKS.at(i));
+      float speed =
+          static_cast<float>(std::abs(step)) * 1000.0F / MOTION_PERIOD_MS;
+      playback.peakSpeedDegPerS = std::max(playback.peakSpeedDegPerS, speed);
+      float lag = std::fabs(static_cast<float>(angle) -
+                            simulator.getJointAngle(SIMULATED_JOINTS.at(i)));
+      playback.peakLagDeg = std::max(playback.peakLagDeg, lag);
+    }
+    previous = angles;
+
+    if (motion.isActive())
+    {
+      simulator.advance(MOTION_PERIOD_MS * 1000U);
+    }
+  }
+  playback.durationMs = millis() - startMs;
+  playback.endAngles = joints.getAngles();
+  playback.eyesFading = eyes.isFading();
+  return playback;
+}
+
+// Host time per update, in nanoseconds, over whole playbacks updated every
+// millisecond. Only the updates are timed
+double timeUpdate(Routine const& routine,
+                  uint32_t beatMs,
+                  Joints& joints,
+                  Eyes& eyes,
+                  BodyMotion::DanceMotion& motion)
+{
+  std::chrono::duration<double, std::nano> elapsed{0};
+  uint64_t updates = 0;
+  for (int i = 0; i < TIMING_REPEATS; i++)
+  {
+    // Clears the eye cues queued by the previous playback
+    eyes.setColour(Eyes::Colour::off);
+    motion.start(routine, beatMs);
+    uint32_t nowMs = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (motion.isActive())
+    {
+      motion.update(joints, eyes, nowMs++);
+      updates++;
+    }
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+  return elapsed.count() / static_cast<double>(updates);
+}
+
+// The angle a joint ends on: its last keyframe, or where it started
+int expectedEndAngle(Routine const& routine, Track track)
+{
+  int angle = 0;
+  for (size_t i = 0; i < routine.numberOfKeyframes; i++)
+  {
+    if (routine.keyframes[i].getTrack() == track)
+    {
+      angle = routine.keyframes[i].value;
+    }
+  }
+  return angle;
+}
+
+} // namespace
+
+int main()
+{
+  Joints joints;
+  Eyes eyes;
+  BodyMotion::DanceMotion motion;
+
+  int cases = 0;
+  int failures = 0;
+  for (Routine const& routine : Routines::ROUTINES)
+  {
+    std::printf("%s: %u beats, %u keyframes, %zu bytes of flash\n",
+                routine.name,
+                routine.lengthSteps / Choreography::STEPS_PER_BEAT,
+                routine.numberOfKeyframes,
+                flashBytes(routine));
+
+    for (uint32_t beatMs : TEMPOS)
+    {
+      cases++;
+      char const* failure = nullptr;
+      Playback playback{};
+      if (!Choreography::isValid(routine))
+      {
+        failure = "invalid routine";
+      }
+      else
+      {
+        playback = play(routine, beatMs, joints, eyes, motion);
+        uint32_t expectedMs = static_cast<uint32_t>(
+            static_cast<uint64_t>(routine.lengthSteps) * beatMs /
+            Choreography::STEPS_PER_BEAT);
+        if (playback.durationMs < expectedMs ||
+            playback.durationMs >= expectedMs + MOTION_PERIOD_MS)
+        {
+          failure = "duration";
+        }
+        for (Track track : JOINT_TRACKS)
+        {
+          if (jointAngle(playback.endAngles, track) !=
+              expectedEndAngle(routine, track))
+          {
+            failure = "end pose";
+          }
+        }
+        if (playback.overshoot)
+        {
+          failure = "overshoot";
+        }
+        if (playback.eyesFading)
+        {
+          failure = "eye cues late";
+        }
+      }
+
+      if (failure != nullptr)
+      {
+        failures++;
+        std::printf("  FAIL %s: %s at %ums per beat\n",
+                    failure,
+                    routine.name,
+                    beatMs);
+        continue;
+      }
+
+      std::printf("  %4ums per beat: %ums, peak speed %.0f deg/s, servos up "
+                  "to %.0f degrees behind, %.0fns per update\n",
+                  beatMs,
+                  playback.durationMs,
+                  playback.peakSpeedDegPerS,
+                  playback.peakLagDeg,
+                  timeUpdate(routine, beatMs, joints, eyes, motion));
+    }
+  }
+
+  std::printf("%d cases, %d failures\n", cases, failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,165 @@
+#include "Arduino.h"
+#include "hardware/eyes.hpp"
+#include "hardware/joints.hpp"
+#include "motion/bodyMotion.hpp"
+#include "motion/routines.hpp"
+#include "simulation/simulator.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Entry point of the dance cycle check build. Plays one dance cycle, the
+// waist sweeping 0 -> 45 -> -45 -> 0 with the arms following, for a range of
+// commanded periods on the simulated joints, two ways:
+//
+// - old: the per-degree loop BodyMotion::singleDanceMotion used to run, which
+//   waited period / waist range / 2 (in whole milliseconds) between degrees
+//   and wrote the three joints every degree
+// - new: Routines::SWEEP played by DanceMotion at a quarter of the period per
+//   beat, updated at the motion task period
+//
+// and reports the achieved period and the servo writes (I2C transactions) per
+// cycle. It checks that the new cycle lasts the commanded period to within one
+// motion task period, and that it takes fewer servo writes than the old loop.
+// Exits with a failure if any check fails
+
+namespace
+{
+
+// Application::MOTION_TASK_TIMING
+constexpr uint32_t MOTION_PERIOD_MS{20};
+
+// The old danceSpeed range, 500 to 3000ms, including periods that aren't a
+// whole number of motion periods or of degrees
+constexpr std::array<uint32_t, 6> PERIODS_MS{500, 777, 1010, 1500, 2170, 3000};
+
+// Routines::SWEEP is four beats long
+constexpr uint32_t SWEEP_BEATS{4};
+
+// DanceState::armMotionOffset, as the old loop used it
+constexpr int ARM_OFFSET{-15};
+
+struct Cycle
+{
+  uint32_t periodMs;
+  uint32_t writes;
+};
+
+// The old BodyMotion::singleDanceMotion, blocking in delay
+void singleDanceMotion(Joints& joints, int milliSeconds, int armOffset)
+{
+  Joints::Limits waistLimits = Joints::getLimits(Joints::Name::waist);
+  int waistRange = Joints::getLimitsRange(Joints::Name::waist);
+  auto delayFor = static_cast<uint32_t>(milliSeconds / waistRange) / 2;
+  auto setPose = [&joints, armOffset](int waist)
+  {
+    joints.setAngle(Joints::Name::waist, waist);
+    joints.setAngle(Joints::Name::left_shoulder, waist + armOffset);
+    joints.setAngle(Joints::Name::right_shoulder, -waist + armOffset);
+  };
+
+  for (int i = 0; i < waistLimits.maxAngle; i++)
+  {
+    setPose(i);
+    delay(delayFor);
+  }
+  for (int i = waistLimits.maxAngle; i > waistLimits.minAngle; i--)
+  {
+    setPose(i);
+    delay(delayFor);
+  }
+  for (int i = waistLimits.minAngle; i < 0; i++)
+  {
+    setPose(i);
+    delay(delayFor);
+  }
+}
+
+// Start each cycle from the arms' resting pose, and let the servos get there
+void rest(Joints& joints)
+{
+  joints.setAngle(Joints::Name::waist, 0);
+  joints.setAngle(Joints::Name::left_shoulder, ARM_OFFSET);
+  joints.setAngle(Joints::Name::right_shoulder, ARM_OFFSET);
+  delay(1000);
+}
+
+Cycle playOld(Joints& joints, uint32_t periodMs)
+{
+  Simulator& simulator = Simulator::getInstance();
+  rest(joints);
+  uint32_t transactions = simulator.getI2cStatistics().transactions;
+  uint32_t startMs = millis();
+  singleDanceMotion(joints, static_cast<int>(periodMs), ARM_OFFSET);
+  return {.periodMs = millis() - startMs,
+          .writes = simulator.getI2cStatistics().transactions - transactions};
+}
+
+Cycle playNew(Joints& joints, Eyes& eyes, uint32_t periodMs)
+{
+  Simulator& simulator = Simulator::getInstance();
+  rest(joints);
+  uint32_t transactions = simulator.getI2cStatistics().transactions;
+  uint32_t startMs = millis();
+  BodyMotion::DanceMotion motion;
+  motion.start(Routines::SWEEP, periodMs / SWEEP_BEATS);
+  while (true)
+  {
+    motion.update(joints, eyes, millis());
+    if (!motion.isActive())
+    {
+      break;
+    }
+    delay(MOTION_PERIOD_MS);
+  }
+  return {.periodMs = millis() - startMs,
+          .writes = simulator.getI2cStatistics().transactions - transactions};
+}
+
+} // namespace
+
+int main()
+{
+  Simulator::getInstance().setUartOutput(nullptr);
+  Joints joints;
+  Eyes eyes;
+
+  int failures = 0;
+  std::printf("%10s %10s %10s %10s %10s\n",
+              "period ms",
+              "old ms",
+              "old writes",
+              "new ms",
+              "new writes");
+  for (uint32_t periodMs : PERIODS_MS)
+  {
+    Cycle old = playOld(joints, periodMs);
+    Cycle current = playNew(joints, eyes, periodMs);
+    std::printf("%10u %10u %10u %10u %10u\n",
+                periodMs,
+                old.periodMs,
+                old.writes,
+                current.periodMs,
+                current.writes);
+
+    // Routines::SWEEP plays for a whole number of beats
+    uint32_t commandedMs = periodMs / SWEEP_BEATS * SWEEP_BEATS;
+    uint32_t errorMs = current.periodMs > commandedMs
+                           ? current.periodMs - commandedMs
+                           : commandedMs - current.periodMs;
+    if (errorMs >= MOTION_PERIOD_MS)
+    {
+      failures++;
+      std::printf("  FAIL period off by %ums\n", errorMs);
+    }
+    if (current.writes >= old.writes)
+    {
+      failures++;
+      std::printf("  FAIL no fewer servo writes\n");
+    }
+  }
+
+  std::printf("%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
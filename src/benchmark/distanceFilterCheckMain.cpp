@@ -0,0 +1,257 @@
+#include "application/danceState.hpp"
+#include "control/transitionGuard.hpp"
+#include "hardware/sonarArray.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Entry point of the distance filter check build. Generates a noisy sonar
+// trace of a visitor walking up to the robot and away again, with the HC-SR04's
+// jitter, dropouts and multipath spikes, and replays it through the DanceState
+// zone decision:
+//
+// - raw: the minimum of the latest raw measurements, split into zones at
+//   MIN_DISTANCE_CM and MAX_DISTANCE_CM, as the states decided before the
+//   filters and the guard
+// - guard only, filter only, and filter and guard: with each sensor's
+//   SonarArray::Filter and/or the DanceState TransitionGuard
+//
+// It reports the zone transitions over the trace and per minute (from
+// TransitionGuard::getTransitionsPerMinute), against the transitions the
+// noise-free trace makes, and checks that with the filter and the guard:
+//
+// - no transition the visitor makes is missed
+// - at most one more transition per real one is made
+// - there are at least 4 times fewer transitions than with the raw decision
+//
+// Exits with a failure if any check fails
+
+namespace
+{
+
+// Each sensor is pinged every 60ms, alternately, and the control task decides
+// on the zone every 50ms
+constexpr uint32_t PING_PERIOD_MS{30};
+constexpr uint32_t CONTROL_PERIOD_MS{50};
+constexpr uint32_t TRACE_MS{180000};
+
+// The visitor's distance from the robot, linearly between the waypoints.
+// They walk up, stand within range, step right up to the robot, back off to
+// stand near the far threshold, and leave
+struct Waypoint
+{
+  uint32_t timeMs;
+  float distanceCm;
+};
+
+constexpr std::array<Waypoint, 10> VISITOR{{{0, 120},
+                                            {20000, 120},
+                                            {40000, 50},
+                                            {80000, 50},
+                                            {90000, 18},
+                                            {110000, 18},
+                                            {125000, 70},
+                                            {155000, 70},
+                                            {165000, 130},
+                                            {TRACE_MS, 130}}};
+
+// HC-SR04 noise: jitter, missing echoes (read as 0, nothing in range) and
+// multipath echoes that come back from further away
+constexpr float JITTER_CM{1.5F};
+constexpr double DROPOUT_PROBABILITY{0.05};
+constexpr double SPIKE_PROBABILITY{0.03};
+constexpr float MIN_SPIKE_CM{40};
+constexpr float MAX_SPIKE_CM{150};
+
+// Unguarded zones, as the states decided before the TransitionGuard
+constexpr TransitionGuard::Params UNGUARDED_PARAMS{
+    .lowerThreshold = DanceState::MIN_DISTANCE_CM,
+    .upperThreshold = DanceState::MAX_DISTANCE_CM,
+    .hysteresis = 0,
+    .minDwellMs = 0};
+
+constexpr uint32_t MAX_EXTRA_TRANSITIONS_PER_REAL_ONE{1};
+constexpr uint32_t MIN_REDUCTION{4};
+
+float visitorDistance(uint32_t timeMs)
+{
+  for (size_t i = 1; i < VISITOR.size(); i++)
+  {
+    Waypoint const& from = VISITOR.at(i - 1);
+    Waypoint const& to = VISITOR.at(i);
+    if (timeMs <= to.timeMs)
+    {
+      float progress = static_cast<float>(timeMs - from.timeMs) /
+                       static_cast<float>(to.timeMs - from.timeMs);
+      return from.distanceCm + progress * (to.distanceCm - from.distanceCm);
+    }
+  }
+  return VISITOR.back().distanceCm;
+}
+
+struct Measurement
+{
+  uint32_t timeMs;
+  bool right;
+  float distanceCm;
+};
+
+// The noisy trace, one measurement per ping, with a fixed seed so every run
+// replays the same trace
+std::array<Measurement, TRACE_MS / PING_PERIOD_MS> makeTrace()
+{
+  std::mt19937 generator{1};
+  std::normal_distribution<float> jitter(0, JITTER_CM);
+  std::uniform_real_distribution<double> chance(0, 1);
+  std::uniform_real_distribution<float> spike(MIN_SPIKE_CM, MAX_SPIKE_CM);
+
+  std::array<Measurement, TRACE_MS / PING_PERIOD_MS> trace{};
+  for (size_t i = 0; i < trace.size(); i++)
+  {
+    auto timeMs = static_cast<uint32_t>(i * PING_PERIOD_MS);
+    float distanceCm = visitorDistance(timeMs) + jitter(generator);
+    double draw = chance(generator);
+    if (draw < DROPOUT_PROBABILITY)
+    {
+      distanceCm = 0;
+    }
+    else if (draw < DROPOUT_PROBABILITY + SPIKE_PROBABILITY)
+    {
+      distanceCm += spike(generator);
+    }
+    trace.at(i) = {
+        .timeMs = timeMs, .right = i % 2 == 0, .distanceCm = distanceCm};
+  }
+  return trace;
+}
+
+struct Result
+{
+  uint32_t transitions;
+  uint32_t worstPerMinute;
+};
+
+// Replay the trace through the zone decision
+template <typename Trace>
+Result replay(Trace const& trace, bool filtered, bool guarded)
+{
+  SonarArray::Filter rightFilter{SonarArray::FILTER_PARAMS};
+  SonarArray::Filter leftFilter{SonarArray::FILTER_PARAMS};
+  SonarArray::Filter::Output right{.distance = 0, .valid = false};
+  SonarArray::Filter::Output left{.distance = 0, .valid = false};
+  TransitionGuard guard(guarded ? DanceState::distanceGuardParams
+                                : UNGUARDED_PARAMS,
+                        TransitionGuard::Zone::below);
+  TransitionGuard::Zone zone = TransitionGuard::Zone::below;
+
+  Result result{};
+  size_t next = 0;
+  // One more decision than the trace, to close its last minute
+  for (uint32_t nowMs = 0; nowMs <= TRACE_MS; nowMs += CONTROL_PERIOD_MS)
+  {
+    for (; next < trace.size() && trace.at(next).timeMs <= nowMs; next++)
+    {
+      Measurement const& measurement = trace.at(next);
+      SonarArray::Filter::Output& output = measurement.right ? right : left;
+      SonarArray::Filter& filter = measurement.right ? rightFilter : leftFilter;
+      output = filtered ? filter.update(measurement.distanceCm)
+                        : SonarArray::Filter::Output{
+                              .distance = measurement.distanceCm,
+                              .valid = true};
+    }
+
+    // As DanceState: an untrusted distance is an object right in front
+    bool valid = right.valid && left.valid;
+    float distance = valid ? std::min(right.distance, left.distance) : 0;
+    TransitionGuard::Zone newZone = guard.update(distance, nowMs);
+    result.transitions += newZone != zone ? 1 : 0;
+    zone = newZone;
+    result.worstPerMinute =
+        std::max(result.worstPerMinute, guard.getTransitionsPerMinute());
+  }
+  return result;
+}
+
+// The transitions the visitor makes, without noise
+uint32_t realTransitions()
+{
+  TransitionGuard guard(UNGUARDED_PARAMS, TransitionGuard::Zone::below);
+  TransitionGuard::Zone zone = TransitionGuard::Zone::below;
+  uint32_t transitions = 0;
+  for (uint32_t nowMs = 0; nowMs <= TRACE_MS; nowMs += CONTROL_PERIOD_MS)
+  {
+    TransitionGuard::Zone newZone = guard.update(visitorDistance(nowMs), nowMs);
+    transitions += newZone != zone ? 1 : 0;
+    zone = newZone;
+  }
+  return transitions;
+}
+
+} // namespace
+
+int main()
+{
+  auto trace = makeTrace();
+  uint32_t real = realTransitions();
+
+  struct Configuration
+  {
+    char const* name;
+    bool filtered;
+    bool guarded;
+  };
+  constexpr std::array<Configuration, 4> CONFIGURATIONS{
+      {{"raw", false, false},
+       {"guard only", false, true},
+       {"filter only", true, false},
+       {"filter and guard", true, true}}};
+
+  std::printf("%u minutes, %zu measurements, %u real transitions\n\n",
+              TRACE_MS / 60000,
+              trace.size(),
+              real);
+  std::printf("%-18s %12s %12s %16s\n",
+              "decision",
+              "transitions",
+              "per minute",
+              "worst minute");
+  std::array<Result, CONFIGURATIONS.size()> results{};
+  for (size_t i = 0; i < CONFIGURATIONS.size(); i++)
+  {
+    Configuration const& configuration = CONFIGURATIONS.at(i);
+    results.at(i) =
+        replay(trace, configuration.filtered, configuration.guarded);
+    std::printf("%-18s %12u %12.1f %16u\n",
+                configuration.name,
+                results.at(i).transitions,
+                results.at(i).transitions * 60000.0 / TRACE_MS,
+                results.at(i).worstPerMinute);
+  }
+
+  Result const& raw = results.front();
+  Result const& filteredAndGuarded = results.back();
+  int failures = 0;
+  if (filteredAndGuarded.transitions < real)
+  {
+    failures++;
+    std::printf("FAIL: real transitions missed\n");
+  }
+  if (filteredAndGuarded.transitions >
+      real * (1 + MAX_EXTRA_TRANSITIONS_PER_REAL_ONE))
+  {
+    failures++;
+    std::printf("FAIL: more than %u extra transition per real one\n",
+                MAX_EXTRA_TRANSITIONS_PER_REAL_ONE);
+  }
+  if (filteredAndGuarded.transitions * MIN_REDUCTION > raw.transitions)
+  {
+    failures++;
+    std::printf("FAIL: less than %u times fewer transitions than raw\n",
+                MIN_REDUCTION);
+  }
+  std::printf("\n%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
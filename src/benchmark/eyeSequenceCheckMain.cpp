@@ -0,0 +1,237 @@
+#include "hardware/eyeSequence.hpp"
+#include "hardware/eyes.hpp"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+
+// Entry point of the eye sequence check build. Generates the PWM sequence of
+// every kind of eye keyframe, between every pair of eye colours, for both LED
+// polarities and a range of timings, and checks that:
+//
+// - the first and last steps, and a held colour, are the duty cycles the
+//   RGBLed library wrote for the colours the keyframe starts and ends on,
+//   before the eyes were driven by PWM sequences
+// - every compare value carries the polarity bit of the LED
+// - the sequence fits in MAX_STEPS and plays for the keyframe's duration, to
+//   within the rounding of each step to a whole number of PWM periods
+// - a single fade moves every channel in one direction only
+//
+//   program
+//
+// Exits with a failure if any check fails
+
+namespace
+{
+
+using EyeAnimation::Keyframe;
+using EyeAnimation::Rgb;
+
+constexpr std::array<Eyes::Colour, 5> COLOURS{Eyes::Colour::off,
+                                              Eyes::Colour::red,
+                                              Eyes::Colour::green,
+                                              Eyes::Colour::blue,
+                                              Eyes::Colour::light_blue};
+
+// The duty cycles the RGBLed library wrote for each of COLOURS. Kept apart from
+// Eyes::EyeColourRgbValues, so a change to those shows up here
+constexpr std::array<Rgb, COLOURS.size()> BASELINE_DUTY_CYCLES{
+    {{0, 0, 0}, {255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {173, 216, 255}}};
+
+constexpr std::array<Keyframe::Type, 3> TYPES{
+    Keyframe::Type::fade, Keyframe::Type::blink, Keyframe::Type::pulse};
+
+constexpr std::array<char const*, 3> TYPE_NAMES{"fade", "blink", "pulse"};
+
+struct Timing
+{
+  uint16_t repeats;
+  uint32_t periodMs;
+};
+
+// Shorter than a step, the timings the states use, and longer than MAX_STEPS
+// steps
+constexpr std::array<Timing, 6> TIMINGS{{{1, 1},
+                                         {1, 100},
+                                         {3, 200},
+                                         {5, 200},
+                                         {1, 500},
+                                         {40, 1000}}};
+
+// The duty cycles a keyframe starts and ends on
+void getEndpoints(Keyframe::Type type,
+                  size_t from,
+                  size_t to,
+                  Rgb& first,
+                  Rgb& last)
+{
+  Rgb fromRgb = BASELINE_DUTY_CYCLES.at(from);
+  Rgb toRgb = BASELINE_DUTY_CYCLES.at(to);
+  switch (type)
+  {
+    case Keyframe::Type::fade:
+      first = fromRgb;
+      last = toRgb;
+      return;
+    case Keyframe::Type::blink:
+      first = toRgb;
+      last = fromRgb;
+      return;
+    case Keyframe::Type::pulse:
+      first = fromRgb;
+      last = fromRgb;
+      return;
+  }
+}
+
+bool isMonotonic(EyeSequence const& sequence)
+{
+  for (size_t channel = 0; channel < 3; channel++)
+  {
+    bool rising = false;
+    bool falling = false;
+    for (size_t step = 1; step < sequence.getLength(); step++)
+    {
+      int previous = sequence.getDutyCycles(step - 1).at(channel);
+      int current = sequence.getDutyCycles(step).at(channel);
+      rising = rising || current > previous;
+      falling = falling || current < previous;
+    }
+    if (rising && falling)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a description of the first failed check, or nullptr
+char const* check(EyeSequence const& sequence,
+                  Keyframe const& keyframe,
+                  EyeSequence::Polarity polarity,
+                  Rgb first,
+                  Rgb last)
+{
+  size_t length = sequence.getLength();
+  if (length == 0 || length > EyeSequence::MAX_STEPS)
+  {
+    return "length";
+  }
+  // A keyframe shorter than two steps jumps straight to its end colour
+  if (length > 1 && sequence.getDutyCycles(0) != first)
+  {
+    return "first step";
+  }
+  if (sequence.getDutyCycles(length - 1) != last)
+  {
+    return "last step";
+  }
+
+  uint16_t polarityBit =
+      polarity == EyeSequence::Polarity::activeHigh ? 0x8000 : 0;
+  for (size_t step = 0; step < length; step++)
+  {
+    for (uint16_t value : sequence.getSteps()[step])
+    {
+      if ((value & 0x8000) != polarityBit)
+      {
+        return "polarity";
+      }
+    }
+  }
+
+  // Each step is at most half a PWM period off (or a whole one, if it is
+  // shorter than a PWM period)
+  uint64_t expectedUs = uint64_t{EyeAnimation::getDurationMs(keyframe)} * 1000;
+  uint64_t durationUs = sequence.getDurationUs();
+  uint64_t errorUs = durationUs > expectedUs ? durationUs - expectedUs
+                                             : expectedUs - durationUs;
+  if (errorUs > length * EyeSequence::PWM_PERIOD_US)
+  {
+    return "duration";
+  }
+  if (errorUs > length * (EyeSequence::PWM_PERIOD_US / 2 + 1) &&
+      expectedUs >= length * EyeSequence::PWM_PERIOD_US)
+  {
+    return "duration";
+  }
+
+  if (keyframe.type == Keyframe::Type::fade && keyframe.repeats == 1 &&
+      !isMonotonic(sequence))
+  {
+    return "monotonic";
+  }
+  return nullptr;
+}
+
+} // namespace
+
+int main()
+{
+  EyeSequence sequence;
+  int cases = 0;
+  int failures = 0;
+
+  for (size_t type = 0; type < TYPES.size(); type++)
+  {
+    for (size_t from = 0; from < COLOURS.size(); from++)
+    {
+      for (size_t to = 0; to < COLOURS.size(); to++)
+      {
+        for (Timing timing : TIMINGS)
+        {
+          for (EyeSequence::Polarity polarity :
+               {EyeSequence::Polarity::activeHigh,
+                EyeSequence::Polarity::activeLow})
+          {
+            Keyframe keyframe{.type = TYPES.at(type),
+                              .from = Eyes::rgbValueFromEyeColour(
+                                  COLOURS.at(from)),
+                              .to = Eyes::rgbValueFromEyeColour(
+                                  COLOURS.at(to)),
+                              .repeats = timing.repeats,
+                              .periodMs = timing.periodMs};
+            Rgb first{};
+            Rgb last{};
+            getEndpoints(TYPES.at(type), from, to, first, last);
+
+            sequence.generate(keyframe, polarity);
+            char const* failure =
+                check(sequence, keyframe, polarity, first, last);
+            cases++;
+            if (failure != nullptr)
+            {
+              failures++;
+              std::printf("FAIL %s: %s, colours %zu -> %zu, %u x %ums, %s\n",
+                          failure,
+                          TYPE_NAMES.at(type),
+                          from,
+                          to,
+                          timing.repeats,
+                          timing.periodMs,
+                          polarity == EyeSequence::Polarity::activeHigh
+                              ? "active high"
+                              : "active low");
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // A held colour is a single step
+  for (size_t colour = 0; colour < COLOURS.size(); colour++)
+  {
+    sequence.generate(Eyes::rgbValueFromEyeColour(COLOURS.at(colour)),
+                      EyeSequence::Polarity::activeLow);
+    cases++;
+    if (sequence.getLength() != 1 ||
+        sequence.getDutyCycles(0) != BASELINE_DUTY_CYCLES.at(colour))
+    {
+      failures++;
+      std::printf("FAIL colour %zu\n", colour);
+    }
+  }
+
+  std::printf("%d cases, %d failures\n", cases, failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,89 @@
+#include "application/application.hpp"
+#include "simulation/scenario.hpp"
+#include "simulation/simulator.hpp"
+#include "utilities/heapGuard.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#ifndef NO_HEAP
+#error "The heap check needs a NO_HEAP build, see platformio.ini"
+#endif
+
+// Entry point of the heap check build. Runs the Application against a
+// scenario, as the simulation does, with the HeapGuard locked before the
+// Application is constructed, and checks that neither constructing nor
+// running it allocates:
+//
+//   program <scenario file>
+//
+// The robot locks the guard once the Application has been constructed (see
+// main.cpp), so this is the stricter check. The serial output is discarded.
+// The simulator records what the hardware did on the heap, so its recording is
+// exempt (see Simulator), as are the Storage calls. Exits with a failure if
+// the application allocated
+
+namespace
+{
+
+// One millisecond, as in the simulation
+constexpr uint64_t TICK_US{1000};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc != 2)
+  {
+    std::fprintf(stderr, "Usage: %s <scenario file>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Scenario scenario;
+  std::string error;
+  if (!scenario.load(argv[1], error))
+  {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  uint64_t endUs = static_cast<uint64_t>(scenario.endMs()) * 1000;
+
+  Simulator& simulator = Simulator::getInstance();
+  simulator.setScenario(scenario);
+  simulator.setUartOutput(nullptr);
+
+  // Loading the scenario allocates, the application mustn't
+  HeapGuard::lock(HeapGuard::Action::count);
+
+  // Static, as on the robot (see main.cpp)
+  static Application application;
+  HeapGuard::Counts constructed = HeapGuard::getCounts();
+
+  while (simulator.nowUs() < endUs)
+  {
+    application.runOnce();
+    simulator.advance(TICK_US);
+  }
+
+  HeapGuard::Counts counts = HeapGuard::getCounts();
+  std::printf("Simulated %.1fs of %s\n"
+              "Application: %zu bytes, static\n"
+              "Allocations while constructing: %u (%u exempt)\n"
+              "Allocations while running: %u (%u exempt)\n",
+              static_cast<double>(simulator.nowUs()) / 1e6,
+              argv[1],
+              sizeof(Application),
+              constructed.afterLock,
+              constructed.exempted,
+              counts.afterLock - constructed.afterLock,
+              counts.exempted - constructed.exempted);
+
+  if (counts.afterLock > 0)
+  {
+    std::printf("FAIL: the application allocated, first %zu bytes\n",
+                counts.firstSizeAfterLock);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
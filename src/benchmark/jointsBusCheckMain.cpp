@@ -0,0 +1,191 @@
+#include "hardware/joints.hpp"
+#include "simulation/simulator.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Entry point of the joints bus check build. Drives the joints through the
+// same poses twice, once joint by joint with setAngle, as the motion code did
+// before setAngles, and once with setAngles, and counts the I2C transactions
+// and bytes on the simulated bus (see Simulator::getI2cStatistics). For each
+// kind of motion it checks that:
+//
+// - Joints::getBusStatistics agrees with what went over the bus
+// - setAngles never takes more transactions, or more bus time, than setAngle
+//   on each joint, and takes one transaction per update at most
+// - when every joint moves, setAngles takes at least twice fewer transactions
+// - both leave the servo driver board with the same duty cycles
+//
+// The bus time is counted in bytes: each transaction also sends the device
+// address, once. Exits with a failure if any check fails
+
+namespace
+{
+
+// One 50Hz servo PWM period, the motion task period
+constexpr uint32_t MOTION_PERIOD_MS{20};
+constexpr uint32_t UPDATES{500};
+constexpr float PI{3.14159265F};
+constexpr uint32_t MIN_DANCE_REDUCTION{2};
+
+enum class Motion
+{
+  // Every joint moves, as in a dance routine
+  dance,
+  // Only the waist moves, as while tracking
+  tracking,
+  // Nothing moves, as while a state holds still
+  hold
+};
+
+constexpr std::array<Motion, 3> MOTIONS{
+    Motion::dance, Motion::tracking, Motion::hold};
+constexpr std::array<char const*, 3> MOTION_NAMES{"dance", "tracking", "hold"};
+
+Joints::Angles pose(Motion motion, uint32_t update)
+{
+  float timeS = static_cast<float>(update * MOTION_PERIOD_MS) / 1000;
+  switch (motion)
+  {
+    case Motion::dance:
+      return {.waist = static_cast<int>(std::lround(
+                  45 * std::sin(2 * PI * 0.5F * timeS))),
+              .leftShoulder = static_cast<int>(std::lround(
+                  30 + 80 * std::sin(2 * PI * 0.75F * timeS))),
+              .rightShoulder = static_cast<int>(std::lround(
+                  30 - 80 * std::sin(2 * PI * 0.75F * timeS)))};
+    case Motion::tracking:
+      return {.waist = static_cast<int>(std::lround(
+                  40 * std::sin(2 * PI * 0.2F * timeS))),
+              .leftShoulder = 0,
+              .rightShoulder = 0};
+    case Motion::hold:
+      return {.waist = 10, .leftShoulder = 20, .rightShoulder = -20};
+  }
+  return {};
+}
+
+struct Usage
+{
+  uint32_t transactions;
+  uint64_t bytes;
+  bool statisticsAgree;
+  std::array<uint16_t, 3> dutyCycles;
+
+  [[nodiscard]] uint64_t busBytes() const
+  {
+    return this->transactions + this->bytes;
+  }
+};
+
+// The duty cycle last written to each servo channel
+std::array<uint16_t, 3> lastDutyCycles()
+{
+  std::array<uint16_t, 3> dutyCycles{};
+  for (Simulator::TimelineEntry const& entry :
+       Simulator::getInstance().getTimeline())
+  {
+    if (entry.device == Simulator::Device::servo &&
+        entry.channel < dutyCycles.size())
+    {
+      dutyCycles.at(entry.channel) = entry.value;
+    }
+  }
+  return dutyCycles;
+}
+
+Usage run(Motion motion, bool batched)
+{
+  Simulator& simulator = Simulator::getInstance();
+  Joints joints;
+  Simulator::I2cStatistics busBefore = simulator.getI2cStatistics();
+  Joints::BusStatistics jointsBefore = joints.getBusStatistics();
+
+  for (uint32_t update = 0; update < UPDATES; update++)
+  {
+    Joints::Angles angles = pose(motion, update);
+    if (batched)
+    {
+      joints.setAngles(angles);
+    }
+    else
+    {
+      joints.setAngle(Joints::Name::waist, angles.waist);
+      joints.setAngle(Joints::Name::left_shoulder, angles.leftShoulder);
+      joints.setAngle(Joints::Name::right_shoulder, angles.rightShoulder);
+    }
+    simulator.advance(uint64_t{MOTION_PERIOD_MS} * 1000);
+  }
+
+  Simulator::I2cStatistics bus = simulator.getI2cStatistics();
+  Joints::BusStatistics statistics = joints.getBusStatistics();
+  Usage usage{.transactions = bus.transactions - busBefore.transactions,
+              .bytes = bus.bytes - busBefore.bytes,
+              .statisticsAgree = false,
+              .dutyCycles = lastDutyCycles()};
+  usage.statisticsAgree =
+      statistics.transactions - jointsBefore.transactions ==
+          usage.transactions &&
+      statistics.bytes - jointsBefore.bytes == usage.bytes;
+  return usage;
+}
+
+} // namespace
+
+int main()
+{
+  Simulator::getInstance().setUartOutput(nullptr);
+
+  int failures = 0;
+  std::printf("%u updates of each motion\n", UPDATES);
+  std::printf("%-9s %-10s %13s %8s %10s\n",
+              "motion",
+              "writes",
+              "transactions",
+              "bytes",
+              "bus bytes");
+  for (size_t i = 0; i < MOTIONS.size(); i++)
+  {
+    Usage single = run(MOTIONS.at(i), false);
+    Usage batched = run(MOTIONS.at(i), true);
+    for (Usage const* usage : {&single, &batched})
+    {
+      std::printf("%-9s %-10s %13u %8llu %10llu\n",
+                  MOTION_NAMES.at(i),
+                  usage == &single ? "setAngle" : "setAngles",
+                  usage->transactions,
+                  static_cast<unsigned long long>(usage->bytes),
+                  static_cast<unsigned long long>(usage->busBytes()));
+    }
+
+    if (!single.statisticsAgree || !batched.statisticsAgree)
+    {
+      failures++;
+      std::printf("  FAIL bus statistics differ from the bus\n");
+    }
+    if (batched.transactions > single.transactions ||
+        batched.busBytes() > single.busBytes() ||
+        batched.transactions > UPDATES)
+    {
+      failures++;
+      std::printf("  FAIL setAngles used the bus more\n");
+    }
+    if (MOTIONS.at(i) == Motion::dance &&
+        batched.transactions * MIN_DANCE_REDUCTION > single.transactions)
+    {
+      failures++;
+      std::printf("  FAIL less than %u times fewer transactions\n",
+                  MIN_DANCE_REDUCTION);
+    }
+    if (batched.dutyCycles != single.dutyCycles)
+    {
+      failures++;
+      std::printf("  FAIL different duty cycles\n");
+    }
+  }
+
+  std::printf("%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,212 @@
+#include "control/linearMap.hpp"
+#include "hardware/joints.hpp"
+#include "simulation/simulator.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Entry point of the joints duty cycle benchmark build. Converts the same
+// sequence of joint angles to servo duty cycles with the lookup tables
+// (Joints::getDutyCycle) and with the float path Joints::setAngle used to take
+// (a clamp, a switch for the zero offset, a switch for the servo channel and
+// a LinearMap), and reports the host time per conversion:
+//
+//   program [--repeat <n>]
+//
+// It also checks that both give the same duty cycle for every angle of every
+// joint, and exits with a failure if they don't
+
+namespace
+{
+
+struct Options
+{
+  int repeat{20000};
+};
+
+//////////////////////////////////////////////////////////////////////
+// The float path, as Joints::setAngle computed it
+//////////////////////////////////////////////////////////////////////
+
+constexpr LinearMap::Params ANGLE_TO_DUTY_CYCLE_PARAMS{
+    .inputMin = 0, .inputMax = 180, .outputMin = 60, .outputMax = 450};
+constexpr int WAIST_ZERO_OFFSET{85};
+constexpr int RIGHT_SHOULDER_ZERO_OFFSET{120};
+constexpr int LEFT_SHOULDER_ZERO_OFFSET{60};
+
+int accountForZeroOffset(Joints::Name name, int angle)
+{
+  switch (name)
+  {
+    case Joints::Name::waist:
+      return WAIST_ZERO_OFFSET + angle;
+    case Joints::Name::left_shoulder:
+      return LEFT_SHOULDER_ZERO_OFFSET + angle;
+    case Joints::Name::right_shoulder:
+      return RIGHT_SHOULDER_ZERO_OFFSET - angle;
+  }
+  return angle;
+}
+
+uint8_t servoNumber(Joints::Name name)
+{
+  switch (name)
+  {
+    case Joints::Name::left_shoulder:
+      return 0;
+    case Joints::Name::right_shoulder:
+      return 1;
+    case Joints::Name::waist:
+      return 2;
+  }
+  return 0;
+}
+
+struct Write
+{
+  uint8_t channel;
+  uint32_t dutyCycle;
+};
+
+// Noinline, as it was a member of Joints compiled in its own translation unit
+__attribute__((noinline)) Write floatDutyCycle(LinearMap const& map,
+                                               Joints::Name name,
+                                               int angle)
+{
+  Joints::Limits limits = Joints::getLimits(name);
+  if (angle < limits.minAngle || angle > limits.maxAngle)
+  {
+    angle = std::clamp(angle, limits.minAngle, limits.maxAngle);
+    std::printf("Clamping angle at: %d\n", angle);
+  }
+  int offsetAngle = accountForZeroOffset(name, angle);
+  return {.channel = servoNumber(name),
+          .dutyCycle = static_cast<uint32_t>(
+              map.getOutput(static_cast<float>(offsetAngle)))};
+}
+
+//////////////////////////////////////////////////////////////////////
+// Benchmark
+//////////////////////////////////////////////////////////////////////
+
+struct Call
+{
+  Joints::Name name;
+  int angle;
+};
+
+constexpr std::array<Joints::Name, 3> NAMES{Joints::Name::waist,
+                                            Joints::Name::left_shoulder,
+                                            Joints::Name::right_shoulder};
+
+// Random joints and angles within their limits, from a fixed seed
+std::vector<Call> makeCalls(size_t size)
+{
+  std::vector<Call> calls(size);
+  uint32_t seed = 1;
+  for (Call& call : calls)
+  {
+    seed = seed * 1664525U + 1013904223U;
+    call.name = NAMES.at((seed >> 16U) % NAMES.size());
+    Joints::Limits limits = Joints::getLimits(call.name);
+    seed = seed * 1664525U + 1013904223U;
+    call.angle = limits.minAngle +
+                 static_cast<int>((seed >> 16U) %
+                                  (limits.maxAngle - limits.minAngle + 1));
+  }
+  return calls;
+}
+
+// Host time per conversion, in nanoseconds
+template <typename Convert>
+double timeCalls(std::vector<Call> const& calls, int repeat, Convert convert)
+{
+  uint32_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; i++)
+  {
+    for (Call const& call : calls)
+    {
+      sum += convert(call);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  // Keep the conversions
+  asm volatile("" : : "r"(sum) : "memory");
+  return elapsed.count() / (static_cast<double>(repeat) * calls.size());
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+    {
+      options.repeat = std::atoi(argv[++i]);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return options.repeat > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr, "Usage: %s [--repeat <n>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  Simulator::getInstance().setUartOutput(nullptr);
+  LinearMap map(ANGLE_TO_DUTY_CYCLE_PARAMS);
+
+  int failures = 0;
+  for (Joints::Name name : NAMES)
+  {
+    Joints::Limits limits = Joints::getLimits(name);
+    for (int angle = limits.minAngle; angle <= limits.maxAngle; angle++)
+    {
+      if (Joints::getDutyCycle(name, angle) !=
+          floatDutyCycle(map, name, angle).dutyCycle)
+      {
+        failures++;
+        std::printf("FAIL %s at %d degrees\n",
+                    Joints::toString(name).data(),
+                    angle);
+      }
+    }
+  }
+
+  std::vector<Call> calls = makeCalls(1024);
+  double tableNs =
+      timeCalls(calls,
+                options.repeat,
+                [](Call const& call)
+                { return Joints::getDutyCycle(call.name, call.angle); });
+  double floatNs = timeCalls(calls,
+                             options.repeat,
+                             [&map](Call const& call)
+                             {
+                               Write write =
+                                   floatDutyCycle(map, call.name, call.angle);
+                               return write.dutyCycle + write.channel;
+                             });
+
+  std::printf("%-12s %10s\n", "path", "ns/call");
+  std::printf("%-12s %10.2f\n", "table", tableNs);
+  std::printf("%-12s %10.2f\n", "float", floatNs);
+  std::printf("%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
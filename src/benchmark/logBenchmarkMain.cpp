@@ -0,0 +1,182 @@
+#include "logging/deferredLog.hpp"
+#include "logging/log.hpp"
+#include "logging/serialManager.hpp"
+#include "simulation/simulator.hpp"
+#include "utilities/heapGuard.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#ifndef NO_HEAP
+#error "The log benchmark needs a NO_HEAP build, see platformio.ini"
+#endif
+
+// Entry point of the log benchmark build. Logs the message DanceState logs on
+// every cycle within range through three paths:
+//
+// - old: the format() + std::string path the LOG_* macros used to take, then
+//   queued on the serial link
+// - immediate: formatted into a stack buffer and queued on the serial link
+//   (writeLine, the LOG_* macros without LOG_DEFERRED)
+// - deferred: recorded in the DeferredLog ring (the LOG_* macros with
+//   LOG_DEFERRED)
+//
+// and reports the host time and the heap allocations (counted by the
+// HeapGuard) per call:
+//
+//   program [--repeat <n>]
+//
+// Calls are timed in batches that fit in the serial and deferred rings, which
+// are drained between batches, outside of the timing. Exits with a failure if
+// the immediate or the deferred path allocates
+
+namespace
+{
+
+struct Options
+{
+  int repeat{20000};
+};
+
+// The DanceState::WithinRangeState message
+#define MESSAGE_FORMAT                                                         \
+  " \e[38;5;220m[INFO]\e[0m Running %s::%s (%s, %ums per beat)"
+constexpr char const* STATE{"DanceState"};
+constexpr char const* INTERNAL_STATE{"WithinRangeState"};
+constexpr char const* ROUTINE{"sweep"};
+constexpr unsigned BEAT_MS{437};
+
+// Fits in the deferred ring, which keeps one slot free, and in the serial ring
+constexpr int BATCH_SIZE{8};
+
+// The old format(): measure, allocate, format, copy into a std::string
+template <typename... Args>
+std::string formatToString(char const* format, Args... args)
+{
+  // +1 for '\0'
+  int size_s = snprintf(nullptr, 0, format, args...) + 1;
+  auto size = static_cast<size_t>(size_s);
+  auto buf = std::make_unique<char[]>(size);
+  snprintf(buf.get(), size, format, args...);
+  return {buf.get()};
+}
+
+void logOld()
+{
+  SerialManager::getInstance().write(
+      formatToString(MESSAGE_FORMAT, STATE, INTERNAL_STATE, ROUTINE, BEAT_MS));
+}
+
+void logImmediate()
+{
+  writeLine(MESSAGE_FORMAT, STATE, INTERNAL_STATE, ROUTINE, BEAT_MS);
+}
+
+void logDeferred()
+{
+  DeferredLog::getInstance().push(
+      MESSAGE_FORMAT, STATE, INTERNAL_STATE, ROUTINE, BEAT_MS);
+}
+
+// Empty both rings, handing everything to the (discarded) simulated UART
+void drain()
+{
+  SerialManager& serial = SerialManager::getInstance();
+  DeferredLog::getInstance().drain(BATCH_SIZE);
+  while (serial.availableForWrite() < SerialManager::TX_BUFFER_SIZE)
+  {
+    serial.flush();
+  }
+}
+
+struct Path
+{
+  char const* name;
+  void (*log)();
+  double elapsedNs;
+  uint32_t allocations;
+};
+
+// The paths take turns, a batch each, so a change of clock speed affects them
+// all alike
+template <size_t N> void run(int repeat, std::array<Path, N>& paths)
+{
+  for (int i = 0; i < repeat; i++)
+  {
+    for (Path& path : paths)
+    {
+      uint32_t before = HeapGuard::getCounts().afterLock;
+      auto start = std::chrono::steady_clock::now();
+      for (int call = 0; call < BATCH_SIZE; call++)
+      {
+        path.log();
+      }
+      std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+      path.elapsedNs += elapsed.count();
+      path.allocations += HeapGuard::getCounts().afterLock - before;
+      drain();
+    }
+  }
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+    {
+      options.repeat = std::atoi(argv[++i]);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return options.repeat > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr, "Usage: %s [--repeat <n>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  Simulator::getInstance().setUartOutput(nullptr);
+  // Set the singletons up before counting
+  drain();
+  HeapGuard::lock(HeapGuard::Action::count);
+
+  std::array<Path, 3> paths{{{"old", logOld, 0, 0},
+                              {"immediate", logImmediate, 0, 0},
+                              {"deferred", logDeferred, 0, 0}}};
+  run(options.repeat, paths);
+
+  double calls = static_cast<double>(options.repeat) * BATCH_SIZE;
+  std::printf("%-10s %10s %14s\n", "path", "ns/call", "allocations");
+  for (Path const& path : paths)
+  {
+    std::printf("%-10s %10.1f %14.2f\n",
+                path.name,
+                path.elapsedNs / calls,
+                path.allocations / calls);
+  }
+
+  // The immediate and deferred paths
+  if (paths.at(1).allocations > 0 || paths.at(2).allocations > 0)
+  {
+    std::printf("FAIL: the new paths allocated\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include "logging/log.hpp"
+#include "simulation/simulator.hpp"
+#include "utilities/heapGuard.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#ifndef NO_HEAP
+#error "The log level check needs a NO_HEAP build, see platformio.ini"
+#endif
+
+#if LOG_MIN_LEVEL != LOG_LEVEL_WARN
+#error "The log level check needs a LOG_LEVEL_WARN build, see platformio.ini"
+#endif
+
+// Entry point of the log level check build, built with LOG_MIN_LEVEL set to
+// LOG_LEVEL_WARN. Logs info messages, which are below the minimum level, and
+// checks that:
+//
+// - their arguments are never evaluated
+// - they don't allocate (counted by the HeapGuard)
+// - they produce no code: their format strings, which only the calls use,
+//   aren't in the program file at all
+//
+// A warning, which is at the minimum level, is logged alongside them to show
+// that the checks would catch a call that is compiled in:
+//
+//   program
+//
+// Exits with a failure if any check fails
+
+namespace
+{
+
+constexpr int CALLS{1000};
+
+int evaluations = 0;
+
+int countEvaluation()
+{
+  return ++evaluations;
+}
+
+// Marks the format strings, so they can be found in the program file
+#define SUPPRESSED_MARKER "log-level-check-suppressed"
+#define KEPT_MARKER "log-level-check-kept"
+
+// Not inlined, so the calls can't be moved out of the loop
+__attribute__((noinline)) void logSuppressed()
+{
+  LOG_INFO(SUPPRESSED_MARKER " %d", countEvaluation());
+  LOG_RAW(SUPPRESSED_MARKER " raw %d", countEvaluation());
+  LOG_INFO_RATE_LIMITED(1, SUPPRESSED_MARKER " limited %d", countEvaluation());
+}
+
+__attribute__((noinline)) void logKept()
+{
+  LOG_WARN(KEPT_MARKER " %d", countEvaluation());
+}
+
+// The marker, built at run time so the search itself doesn't put it in the
+// program file
+std::string reveal(std::string hidden)
+{
+  for (char& character : hidden)
+  {
+    character = static_cast<char>(character - 1);
+  }
+  return hidden;
+}
+
+bool programContains(std::vector<char> const& program, std::string const& text)
+{
+  auto found =
+      std::search(program.begin(), program.end(), text.begin(), text.end());
+  return found != program.end();
+}
+
+} // namespace
+
+int main(int /*argc*/, char** argv)
+{
+  std::ifstream file(argv[0], std::ios::binary);
+  std::vector<char> program{std::istreambuf_iterator<char>(file),
+                            std::istreambuf_iterator<char>()};
+  if (program.empty())
+  {
+    std::fprintf(stderr, "Unable to read %s\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Simulator::getInstance().setUartOutput(nullptr);
+  HeapGuard::lock(HeapGuard::Action::count);
+  for (int i = 0; i < CALLS; i++)
+  {
+    logSuppressed();
+  }
+  int suppressedEvaluations = evaluations;
+  uint32_t suppressedAllocations = HeapGuard::getCounts().afterLock;
+
+  logKept();
+  int keptEvaluations = evaluations - suppressedEvaluations;
+
+  // "log-level-check-suppressed" and "log-level-check-kept", shifted by one
+  bool suppressedInProgram =
+      programContains(program, reveal("mph.mfwfm.difdl.tvqqsfttfe"));
+  bool keptInProgram = programContains(program, reveal("mph.mfwfm.difdl.lfqu"));
+
+  std::printf("Suppressed calls: %d, arguments evaluated %d times, %u "
+              "allocations, format strings %s the program\n",
+              CALLS * 3,
+              suppressedEvaluations,
+              suppressedAllocations,
+              suppressedInProgram ? "in" : "not in");
+  std::printf("Warning: arguments evaluated %d times, format string %s the "
+              "program\n",
+              keptEvaluations,
+              keptInProgram ? "in" : "not in");
+
+  int failures = 0;
+  if (suppressedEvaluations > 0)
+  {
+    failures++;
+    std::printf("FAIL: suppressed arguments evaluated\n");
+  }
+  if (suppressedAllocations > 0)
+  {
+    failures++;
+    std::printf("FAIL: suppressed calls allocated\n");
+  }
+  if (suppressedInProgram)
+  {
+    failures++;
+    std::printf("FAIL: suppressed calls compiled in\n");
+  }
+  if (keptEvaluations != 1 || !keptInProgram)
+  {
+    failures++;
+    std::printf("FAIL: the warning was not logged\n");
+  }
+  std::printf("%d failures\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
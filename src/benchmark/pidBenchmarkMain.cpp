@@ -0,0 +1,265 @@
+#include "application/trackingState.hpp"
+#include "control/fixedPoint.hpp"
+#include "control/pidController.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Entry point of the PID benchmark build. Replays recorded error traces (see
+// traces/) through the float and the FixedPoint PidController, and reports
+// the largest difference between their outputs and the host time per step.
+// The "jittered" configuration steps the controllers with timestamps that
+// jitter either side of the timestep bounds, so it also compares the
+// reciprocals of the measured timesteps:
+//
+//   program <trace file>... [--tolerance <max difference>] [--repeat <n>]
+//
+// Exits with a failure if the outputs differ by more than the tolerance, so it
+// doubles as a check of the fixed-point controller
+
+namespace
+{
+
+// Keeps the timed steps from being optimised away
+volatile float timingSink;
+
+struct Options
+{
+  std::vector<std::string> tracePaths;
+  float tolerance{0.01F};
+  int repeat{1000};
+};
+
+struct Configuration
+{
+  char const* name;
+  PidParameters params;
+  bool measuredTimestep{false};
+};
+
+constexpr PidParameters ALL_TERMS_PARAMS{.Kp = 1.5,
+                                         .Kd = 0.05,
+                                         .Ki = 0.5,
+                                         .timestepMs = 50,
+                                         .maxControlSignal = 10,
+                                         .minControlSignal = -10};
+
+// The TrackingState controller, the same with every term enabled, with the
+// derivative filter and setpoint weights as well, and with every term enabled
+// and measured timesteps
+constexpr std::array<Configuration, 4> CONFIGURATIONS{{
+    {"tracking", TrackingState::PID_PARAMS},
+    {"pid", ALL_TERMS_PARAMS},
+    {"filtered",
+     {.Kp = 1.5,
+      .Kd = 0.05,
+      .Ki = 0.5,
+      .timestepMs = 50,
+      .maxControlSignal = 10,
+      .minControlSignal = -10,
+      .derivativeSmoothingFactor = 0.3,
+      .proportionalSetpointWeight = 0.5,
+      .derivativeSetpointWeight = 0}},
+    {"jittered", ALL_TERMS_PARAMS, true},
+}};
+
+// Step times 20 to 110ms apart, from a fixed seed, so some fall outside the
+// 25 to 100ms the timestep is clamped to
+std::vector<uint32_t> makeTimestamps(size_t size)
+{
+  std::vector<uint32_t> timestamps(size);
+  uint32_t seed = 1;
+  uint32_t nowUs = 0;
+  for (uint32_t& timestamp : timestamps)
+  {
+    seed = seed * 1664525U + 1013904223U;
+    nowUs += 20000 + (seed >> 8U) % 90000;
+    timestamp = nowUs;
+  }
+  return timestamps;
+}
+
+template <typename T>
+T step(PidController<T>& controller,
+       Configuration const& configuration,
+       uint32_t nowUs,
+       T error)
+{
+  if (configuration.measuredTimestep)
+  {
+    return controller.getControlSignal(nowUs, error, T{});
+  }
+  return controller.getControlSignal(error, T{});
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue)
+    {
+      options.tolerance = std::strtof(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+    {
+      options.repeat = std::atoi(argv[++i]);
+    }
+    else if (argv[i][0] != '-')
+    {
+      options.tracePaths.emplace_back(argv[i]);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return !options.tracePaths.empty() && options.tolerance >= 0 &&
+         options.repeat > 0;
+}
+
+// One error per line, lines starting with # are comments
+bool loadTrace(std::string const& path, std::vector<float>& trace)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    trace.push_back(std::strtof(line.c_str(), nullptr));
+  }
+  return !trace.empty();
+}
+
+// Largest difference between the float and FixedPoint outputs over the trace
+float compare(Configuration const& configuration,
+              std::vector<float> const& trace)
+{
+  PidController<float> floatController(configuration.params);
+  PidController<FixedPoint> fixedController(configuration.params);
+  std::vector<uint32_t> timestamps = makeTimestamps(trace.size());
+
+  float maxDifference = 0;
+  for (size_t i = 0; i < trace.size(); i++)
+  {
+    float floatOutput =
+        step(floatController, configuration, timestamps.at(i), trace.at(i));
+    float fixedOutput = static_cast<float>(step(fixedController,
+                                                configuration,
+                                                timestamps.at(i),
+                                                FixedPoint(trace.at(i))));
+    maxDifference =
+        std::max(maxDifference, std::fabs(floatOutput - fixedOutput));
+  }
+  return maxDifference;
+}
+
+// Host time per step, in nanoseconds. The trace is converted to T up front so
+// only the steps are timed
+template <typename T>
+double timeStep(Configuration const& configuration,
+                std::vector<float> const& trace,
+                int repeat)
+{
+  std::vector<uint32_t> timestamps = makeTimestamps(trace.size());
+  std::vector<T> input;
+  input.reserve(trace.size());
+  for (float error : trace)
+  {
+    input.push_back(T(error));
+  }
+
+  PidController<T> controller(configuration.params);
+  T sum{};
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; i++)
+  {
+    for (size_t j = 0; j < input.size(); j++)
+    {
+      sum += step(controller, configuration, timestamps[j], input[j]);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  timingSink = static_cast<float>(sum);
+
+  return elapsed.count() / (static_cast<double>(repeat) * input.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr,
+                 "Usage: %s <trace file>... [--tolerance <max difference>] "
+                 "[--repeat <n>]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  bool withinTolerance = true;
+  std::printf("%-40s %-10s %8s %12s %12s %12s\n",
+              "trace",
+              "config",
+              "steps",
+              "max diff",
+              "float ns",
+              "fixed ns");
+
+  for (std::string const& path : options.tracePaths)
+  {
+    std::vector<float> trace;
+    if (!loadTrace(path, trace))
+    {
+      std::fprintf(stderr, "Unable to load the trace %s\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    for (Configuration const& configuration : CONFIGURATIONS)
+    {
+      float maxDifference = compare(configuration, trace);
+      double floatNs = timeStep<float>(configuration, trace, options.repeat);
+      double fixedNs =
+          timeStep<FixedPoint>(configuration, trace, options.repeat);
+
+      std::printf("%-40s %-10s %8zu %12.6f %12.2f %12.2f\n",
+                  path.c_str(),
+                  configuration.name,
+                  trace.size(),
+                  maxDifference,
+                  floatNs,
+                  fixedNs);
+
+      withinTolerance = withinTolerance && maxDifference <= options.tolerance;
+    }
+  }
+
+  if (!withinTolerance)
+  {
+    std::fprintf(stderr,
+                 "The FixedPoint controller differs from the float controller "
+                 "by more than %f\n",
+                 options.tolerance);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
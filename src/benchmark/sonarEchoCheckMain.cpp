@@ -0,0 +1,145 @@
+#include "hardware/sonarArray.hpp"
+#include "simulation/simulator.hpp"
+#include "utilities/cancellationToken.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Entry point of the sonar echo check build. The simulator answers every
+// sonar trigger with an echo pulse of a known width (see
+// Simulator::setEchoWidth), so the echo edges reach the SonarArray interrupt
+// handlers, and go through its edge buffers, at known times. For each width it
+// checks that:
+//
+// - both sensors' (filtered) distances settle on the width converted with the
+//   speed of sound the robot has always used, 343 m/s
+// - the proximity alarm, which works on the raw echoes, is raised for a
+//   distance just above that and not for one just below it
+//
+// It also checks that no call to update blocks for longer than the trigger
+// pulse, and reports the longest. Exits with a failure if any check fails
+
+namespace
+{
+
+// Speed of sound, as in the original pulseIn conversion
+constexpr double SPEED_OF_SOUND_M_PER_S{343.0};
+
+// Echo widths for objects at about 2, 10, 25, 50, 100, 200 and 400cm
+constexpr std::array<uint32_t, 7> ECHO_WIDTHS_US{
+    117, 583, 1458, 2915, 5831, 11662, 23324};
+
+// Long enough for the filters to settle after a change of distance
+constexpr uint32_t SETTLE_MS{2000};
+constexpr uint32_t ALARM_MS{200};
+
+// The sensing task period is 10ms, stepping every millisecond collects the
+// echoes at least as promptly
+constexpr uint64_t STEP_US{1000};
+
+constexpr double DISTANCE_TOLERANCE_CM{0.01};
+constexpr double ALARM_MARGIN{1e-3};
+
+// delayMicroseconds(2) + delayMicroseconds(10) while pulsing the trigger
+constexpr uint64_t MAX_BLOCKING_US{12};
+
+double expectedDistanceCm(uint32_t echoWidthUs)
+{
+  return static_cast<double>(echoWidthUs) / 2 / 1e6 * SPEED_OF_SOUND_M_PER_S *
+         100;
+}
+
+// Run the sonar array, returning the longest time a call to update took
+uint64_t run(SonarArray& sonarArray, uint32_t durationMs)
+{
+  Simulator& simulator = Simulator::getInstance();
+  uint64_t endUs = simulator.nowUs() + uint64_t{durationMs} * 1000;
+  uint64_t longestUpdateUs = 0;
+  while (simulator.nowUs() < endUs)
+  {
+    uint64_t startUs = simulator.nowUs();
+    sonarArray.update();
+    longestUpdateUs = std::max(longestUpdateUs, simulator.nowUs() - startUs);
+    simulator.advance(STEP_US);
+  }
+  return longestUpdateUs;
+}
+
+// Whether the proximity alarm is raised for objects closer than distanceCm
+bool alarmRaised(SonarArray& sonarArray,
+                 CancellationToken& alarm,
+                 double distanceCm)
+{
+  sonarArray.setProximityAlarm(static_cast<float>(distanceCm), alarm);
+  alarm.reset();
+  run(sonarArray, ALARM_MS);
+  return alarm.isCancelled();
+}
+
+} // namespace
+
+int main()
+{
+  Simulator& simulator = Simulator::getInstance();
+  simulator.setUartOutput(nullptr);
+  SonarArray sonarArray;
+  CancellationToken alarm;
+
+  int failures = 0;
+  uint64_t longestUpdateUs = 0;
+  std::printf("%9s %12s %10s %10s %6s\n",
+              "width us",
+              "expected cm",
+              "right cm",
+              "left cm",
+              "alarm");
+  for (uint32_t widthUs : ECHO_WIDTHS_US)
+  {
+    simulator.setEchoWidth(widthUs);
+    longestUpdateUs =
+        std::max(longestUpdateUs, run(sonarArray, SETTLE_MS));
+
+    double expectedCm = expectedDistanceCm(widthUs);
+    SonarArray::Distance distance = sonarArray.getDistance();
+    bool distanceOk =
+        distance.valid &&
+        std::fabs(distance.right - expectedCm) <= DISTANCE_TOLERANCE_CM &&
+        std::fabs(distance.left - expectedCm) <= DISTANCE_TOLERANCE_CM;
+
+    bool alarmOk =
+        alarmRaised(sonarArray, alarm, expectedCm * (1 + ALARM_MARGIN)) &&
+        !alarmRaised(sonarArray, alarm, expectedCm * (1 - ALARM_MARGIN));
+
+    std::printf("%9u %12.3f %10.3f %10.3f %6s\n",
+                widthUs,
+                expectedCm,
+                distance.right,
+                distance.left,
+                alarmOk ? "ok" : "FAIL");
+    if (!distanceOk)
+    {
+      failures++;
+      std::printf("  FAIL distance for a %uus echo\n", widthUs);
+    }
+    if (!alarmOk)
+    {
+      failures++;
+      std::printf("  FAIL proximity alarm for a %uus echo\n", widthUs);
+    }
+  }
+
+  std::printf("Longest update: %lluus\n",
+              static_cast<unsigned long long>(longestUpdateUs));
+  if (longestUpdateUs > MAX_BLOCKING_US)
+  {
+    failures++;
+    std::printf("  FAIL update blocked for more than %lluus\n",
+                static_cast<unsigned long long>(MAX_BLOCKING_US));
+  }
+
+  std::printf("%zu widths, %d failures\n", ECHO_WIDTHS_US.size(), failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,271 @@
+#include "application/application.hpp"
+#include "application/danceState.hpp"
+#include "application/stateMachine.hpp"
+#include "application/trackingState.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Entry point of the state machine benchmark build. Steps a four state machine
+// (the shape of TrackingState's) with the StateMachine template and with the
+// virtual IState dispatch it replaced, over the same sequences of desired
+// states, and reports the host time per step and the size of each:
+//
+//   program [--repeat <n>]
+//
+// The states do the same trivial work in both, so the difference is the cost
+// of the dispatch itself
+
+namespace
+{
+
+struct Options
+{
+  int repeat{1000};
+};
+
+// What the states work on
+struct Context
+{
+  uint32_t entries{0};
+  uint32_t cycles{0};
+};
+
+//////////////////////////////////////////////////////////////////////
+// StateMachine template
+//////////////////////////////////////////////////////////////////////
+
+template <int N> class TemplateState
+{
+ public:
+  static constexpr std::string_view NAME{"State"};
+
+  explicit TemplateState(Context& context) : context(context)
+  {
+  }
+
+  void enter()
+  {
+    this->context.entries += N;
+  }
+
+  void runOnce()
+  {
+    this->context.cycles += N;
+  }
+
+ private:
+  Context& context;
+};
+
+using TemplateMachine = StateMachine<TemplateState<1>,
+                                     TemplateState<2>,
+                                     TemplateState<3>,
+                                     TemplateState<4>>;
+
+//////////////////////////////////////////////////////////////////////
+// Virtual dispatch, as the application had it: each state implements the
+// IState interface and holds its name in a std::string
+//////////////////////////////////////////////////////////////////////
+
+class IState
+{
+ public:
+  virtual ~IState() = default;
+  virtual void enter() = 0;
+  virtual void runOnce() = 0;
+  virtual char const* name() = 0;
+};
+
+template <int N> class VirtualState : public IState
+{
+ public:
+  explicit VirtualState(Context& context)
+      : context(context), stateName("State")
+  {
+  }
+
+  void enter() override
+  {
+    this->context.entries += N;
+  }
+
+  void runOnce() override
+  {
+    this->context.cycles += N;
+  }
+
+  char const* name() override
+  {
+    return this->stateName.c_str();
+  }
+
+ private:
+  Context& context;
+  std::string stateName;
+};
+
+struct VirtualMachine
+{
+  std::array<IState*, 4> states;
+  IState* currentState{nullptr};
+
+  void step(uint8_t desired)
+  {
+    IState* desiredState = this->states.at(desired);
+    if (this->currentState != desiredState)
+    {
+      this->currentState = desiredState;
+      desiredState->enter();
+    }
+    else
+    {
+      this->currentState->runOnce();
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Desired state sequences
+//////////////////////////////////////////////////////////////////////
+
+constexpr size_t SEQUENCE_LENGTH{4096};
+
+// A new desired state every holdSteps steps, chosen pseudo-randomly
+std::vector<uint8_t> makeSequence(size_t holdSteps)
+{
+  std::vector<uint8_t> sequence(SEQUENCE_LENGTH);
+  uint32_t seed = 12345;
+  uint8_t desired = 0;
+  for (size_t i = 0; i < sequence.size(); i++)
+  {
+    if (i % holdSteps == 0)
+    {
+      seed = seed * 1664525U + 1013904223U;
+      desired = static_cast<uint8_t>(seed >> 30U);
+    }
+    sequence.at(i) = desired;
+  }
+  return sequence;
+}
+
+struct Pattern
+{
+  char const* name;
+  size_t holdSteps;
+};
+
+// A robot spends most cycles in the same state, the other pattern is the
+// worst case
+constexpr std::array<Pattern, 2> PATTERNS{{{"steady", 20}, {"switching", 1}}};
+
+// Host time per step, in nanoseconds
+template <typename Step>
+double timeSteps(std::vector<uint8_t> const& sequence, int repeat, Step step)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; i++)
+  {
+    for (uint8_t desired : sequence)
+    {
+      step(desired);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(repeat) * sequence.size());
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--repeat") == 0 && hasValue)
+    {
+      options.repeat = std::atoi(argv[++i]);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return options.repeat > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr, "Usage: %s [--repeat <n>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Context templateContext;
+  TemplateState<1> templateState1(templateContext);
+  TemplateState<2> templateState2(templateContext);
+  TemplateState<3> templateState3(templateContext);
+  TemplateState<4> templateState4(templateContext);
+  TemplateMachine templateMachine(
+      templateState1, templateState2, templateState3, templateState4);
+  templateMachine.start<TemplateState<1>>();
+
+  Context virtualContext;
+  VirtualState<1> virtualState1(virtualContext);
+  VirtualState<2> virtualState2(virtualContext);
+  VirtualState<3> virtualState3(virtualContext);
+  VirtualState<4> virtualState4(virtualContext);
+  VirtualMachine virtualMachine{
+      .states = {&virtualState1,
+                 &virtualState2,
+                 &virtualState3,
+                 &virtualState4},
+      .currentState = &virtualState1};
+  // Hide the states' types from the optimiser, as they were hidden behind
+  // std::unique_ptr<IState> in the application, so the calls stay virtual
+  asm volatile("" : : "r"(&virtualMachine) : "memory");
+
+  std::printf("%-10s %12s %12s\n", "pattern", "template ns", "virtual ns");
+  for (Pattern const& pattern : PATTERNS)
+  {
+    std::vector<uint8_t> sequence = makeSequence(pattern.holdSteps);
+    double templateNs =
+        timeSteps(sequence, options.repeat, [&](uint8_t desired) {
+          templateMachine.step(desired);
+        });
+    double virtualNs = timeSteps(sequence,
+                                 options.repeat,
+                                 [&](uint8_t desired) {
+                                   virtualMachine.step(desired);
+                                 });
+    std::printf(
+        "%-10s %12.2f %12.2f\n", pattern.name, templateNs, virtualNs);
+  }
+
+  // Both machines did the same work
+  if (templateContext.entries != virtualContext.entries ||
+      templateContext.cycles != virtualContext.cycles)
+  {
+    std::fprintf(stderr, "The state machines disagree\n");
+    return EXIT_FAILURE;
+  }
+
+  std::printf("\nsize (bytes)\n");
+  std::printf("%-24s %6zu\n", "template state", sizeof(TemplateState<1>));
+  std::printf("%-24s %6zu\n", "virtual state", sizeof(VirtualState<1>));
+  std::printf("%-24s %6zu\n", "template machine", sizeof(TemplateMachine));
+  std::printf("%-24s %6zu\n", "virtual machine", sizeof(VirtualMachine));
+  std::printf("%-24s %6zu\n", "DanceState", sizeof(DanceState));
+  std::printf("%-24s %6zu\n", "TrackingState", sizeof(TrackingState));
+  std::printf("%-24s %6zu\n", "Application", sizeof(Application));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#include "alphaBetaFilter.hpp"
+#include <cmath>
+
+AlphaBetaFilter::AlphaBetaFilter(Params params) : params(params)
+{
+}
+
+AlphaBetaFilter::Params AlphaBetaFilter::fromTrackingIndex(float trackingIndex)
+{
+  float lambda = trackingIndex;
+  float root = std::sqrt(lambda * lambda + 8 * lambda);
+  return {.alpha = -(lambda * lambda + 8 * lambda - (lambda + 4) * root) / 8,
+          .beta = (lambda * lambda + 4 * lambda - lambda * root) / 4};
+}
+
+AlphaBetaFilter::Estimate AlphaBetaFilter::update(float measurement,
+                                                  float timestepS)
+{
+  if (!this->initialised)
+  {
+    this->initialised = true;
+    this->estimate = {.position = measurement, .velocity = 0};
+    return this->estimate;
+  }
+
+  float predicted =
+      this->estimate.position + this->estimate.velocity * timestepS;
+  float residual = measurement - predicted;
+  this->estimate.position = predicted + this->params.alpha * residual;
+  this->estimate.velocity += this->params.beta / timestepS * residual;
+  return this->estimate;
+}
+
+float AlphaBetaFilter::predict(float leadS) const
+{
+  return this->estimate.position + this->estimate.velocity * leadS;
+}
+
+AlphaBetaFilter::Estimate AlphaBetaFilter::getEstimate() const
+{
+  return this->estimate;
+}
+
+void AlphaBetaFilter::reset()
+{
+  this->initialised = false;
+  this->estimate = {};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * @brief Alpha-beta filter: estimates the position and velocity of a target
+ * from noisy position measurements, assuming it moves at a constant velocity
+ * between measurements
+ *
+ *   predicted = position + velocity * dt
+ *   residual  = measurement - predicted
+ *   position  = predicted + alpha * residual
+ *   velocity  = velocity + beta / dt * residual
+ *
+ * This is the steady state of a constant velocity Kalman filter. Its gains
+ * follow from the tracking index (see fromTrackingIndex): larger alpha and
+ * beta follow manoeuvres more quickly, smaller values reject more noise. The
+ * first measurement initialises the position, with zero velocity.
+ *
+ */
+class AlphaBetaFilter
+{
+ public:
+  struct Params
+  {
+    float alpha;
+    float beta;
+  };
+
+  struct Estimate
+  {
+    float position{0.0F};
+    float velocity{0.0F};
+  };
+
+  AlphaBetaFilter(Params params);
+
+  /**
+   * @brief Steady state Kalman gains (Kalata) for a target whose acceleration
+   * is white noise
+   *
+   * @param trackingIndex - accelerationNoise * dt^2 / measurementNoise, the
+   * standard deviations of the target's acceleration and of a measurement
+   */
+  static Params fromTrackingIndex(float trackingIndex);
+
+  /**
+   * @brief Correct the estimate with the newest measurement
+   *
+   * @param timestepS - time since the previous measurement, must be > 0
+   */
+  Estimate update(float measurement, float timestepS);
+
+  /**
+   * @brief Extrapolate the estimate
+   *
+   * @return float - the position leadS seconds after the newest measurement
+   */
+  [[nodiscard]] float predict(float leadS) const;
+
+  [[nodiscard]] Estimate getEstimate() const;
+
+  /**
+   * @brief Forget the target, the next measurement initialises the estimate
+   *
+   */
+  void reset();
+
+ private:
+  Params params;
+  bool initialised{false};
+  Estimate estimate;
+};
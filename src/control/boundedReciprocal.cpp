@@ -0,0 +1,38 @@
+#include "boundedReciprocal.hpp"
+#include <algorithm>
+
+BoundedReciprocal::BoundedReciprocal(uint32_t min, uint32_t max, float scale)
+    : min(std::max(min, uint32_t{1})), max(std::max(max, this->min)),
+      normaliser(((uint64_t{1} << 48) + this->max / 2) / this->max),
+      outputScale(scale / static_cast<float>(this->max))
+{
+  // The linear guess that keeps the relative error |1 - d * x| smallest over
+  // d in [a, 1], and that error, which each step squares
+  float a = static_cast<float>(this->min) / static_cast<float>(this->max);
+  float slope = 8 / (4 * a + (1 + a) * (1 + a));
+  this->guessSlope = FixedPoint(slope);
+  this->guessOffset = FixedPoint(slope * (1 + a));
+
+  float error = (1 - a) * (1 - a) / ((1 + a) * (1 + a) + 4 * a);
+  constexpr float PRECISION{1.0F / (2 * FixedPoint::ONE)};
+  while (error > PRECISION && this->steps < MAX_STEPS)
+  {
+    error *= error;
+    this->steps++;
+  }
+}
+
+FixedPoint BoundedReciprocal::get(uint32_t value) const
+{
+  constexpr FixedPoint TWO{2.0F};
+  uint64_t clamped = std::clamp(value, this->min, this->max);
+  FixedPoint d = FixedPoint::fromRaw(
+      static_cast<int32_t>((clamped * this->normaliser) >> 32));
+
+  FixedPoint x = this->guessOffset - this->guessSlope * d;
+  for (uint8_t step = 0; step < this->steps; step++)
+  {
+    x *= TWO - d * x;
+  }
+  return this->outputScale * x;
+}
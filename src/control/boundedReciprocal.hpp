@@ -0,0 +1,52 @@
+#pragma once
+#include "fixedPoint.hpp"
+#include <cstdint>
+
+/**
+ * @brief FixedPoint reciprocal of an integer known to lie within [min, max],
+ * scaled by a constant: scale / value
+ *
+ * FixedPoint has no division, and a divide doesn't take the same time for
+ * every input. Instead the value is normalised to max with a multiply, and
+ * max / value is refined from a linear first guess (the best over the range)
+ * by Newton-Raphson steps, x = x * (2 - d * x). The first guess and the number
+ * of steps only depend on the range, so get takes the same number of cycles
+ * whatever the value. As long as max is at most MAX_RANGE_RATIO times min, the
+ * result is within 3 parts in 10^4 of scale / value (the precision of
+ * value / max as a FixedPoint).
+ *
+ * The constants are computed with floats and a 64-bit divide, once, by the
+ * constructor.
+ *
+ */
+class BoundedReciprocal
+{
+ public:
+  static constexpr uint32_t MAX_RANGE_RATIO{16};
+
+  BoundedReciprocal(uint32_t min, uint32_t max, float scale);
+
+  /**
+   * @brief Get scale / value
+   *
+   * @param value - clamped to [min, max]
+   */
+  [[nodiscard]] FixedPoint get(uint32_t value) const;
+
+ private:
+  static constexpr uint8_t MAX_STEPS{5};
+
+  uint32_t min;
+  uint32_t max;
+
+  // value / max as a FixedPoint is value * normaliser >> 32
+  uint64_t normaliser;
+
+  // First guess of max / value: guessOffset - guessSlope * (value / max)
+  FixedPoint guessOffset;
+  FixedPoint guessSlope;
+  uint8_t steps{0};
+
+  // scale / max
+  FixedPoint outputScale;
+};
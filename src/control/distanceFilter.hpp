@@ -0,0 +1,59 @@
+#pragma once
+#include "exponentialFilter.hpp"
+#include "medianFilter.hpp"
+#include "outlierGate.hpp"
+#include <cstddef>
+
+/**
+ * @brief Filter chain for a stream of distance measurements:
+ *
+ * median (removes dropouts and single-sample spikes) -> outlier gate (rejects
+ * implausible jumps) -> exponential smoothing (removes jitter)
+ *
+ * Every stage is fixed-size, so the chain never allocates and costs the same
+ * for every sample. The output is flagged as invalid until the median window
+ * has been filled. While the outlier gate is rejecting samples the output holds
+ * the last accepted distance, which remains valid.
+ *
+ */
+template <size_t MedianWindowSize> class DistanceFilter
+{
+ public:
+  struct Params
+  {
+    OutlierGate::Params outlierGate;
+    float smoothingFactor;
+  };
+
+  struct Output
+  {
+    float distance;
+    bool valid;
+  };
+
+  DistanceFilter(Params params)
+      : outlierGate(params.outlierGate),
+        exponentialFilter(params.smoothingFactor)
+  {
+  }
+
+  /**
+   * @brief Pass the newest distance measurement through the filter chain
+   *
+   * @param distance The newest (raw) distance measurement
+   * @return Output The filtered distance and whether it can be trusted
+   */
+  Output update(float distance)
+  {
+    float median = this->medianFilter.update(distance);
+    float gated = this->outlierGate.update(median);
+    float smoothed = this->exponentialFilter.update(gated);
+    return {.distance = smoothed,
+            .valid = this->medianFilter.isFull()};
+  }
+
+ private:
+  MedianFilter<MedianWindowSize> medianFilter;
+  OutlierGate outlierGate;
+  ExponentialFilter exponentialFilter;
+};
@@ -0,0 +1,20 @@
+#include "exponentialFilter.hpp"
+#include <algorithm>
+
+ExponentialFilter::ExponentialFilter(float smoothingFactor)
+    : smoothingFactor(std::clamp(smoothingFactor, 0.0F, 1.0F))
+{
+}
+
+float ExponentialFilter::update(float sample)
+{
+  if (!this->initialised)
+  {
+    this->initialised = true;
+    this->output = sample;
+    return this->output;
+  }
+
+  this->output += this->smoothingFactor * (sample - this->output);
+  return this->output;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * @brief First-order low-pass (exponential moving average) filter
+ *
+ * y[n] = y[n-1] + smoothingFactor * (x[n] - y[n-1])
+ *
+ * A smoothing factor of 1 passes the input straight through, smaller values
+ * smooth more heavily. The first sample initialises the output.
+ *
+ */
+class ExponentialFilter
+{
+ public:
+  ExponentialFilter(float smoothingFactor);
+
+  /**
+   * @brief Get the filtered output for the newest sample
+   *
+   * @param sample The newest sample
+   * @return float The filtered output
+   */
+  float update(float sample);
+
+ private:
+  float smoothingFactor;
+  bool initialised{false};
+  float output{0.0F};
+};
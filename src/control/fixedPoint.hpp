@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+/**
+ * @brief Signed Q16.16 fixed-point number
+ *
+ * 16 integer bits and 16 fractional bits, so it covers roughly +-32768 with a
+ * resolution of 1/65536. Arithmetic saturates at the ends of the range instead
+ * of wrapping, and only uses integer adds, multiplies and shifts, so a step
+ * takes the same number of cycles whatever the values and gives the same
+ * result on every target.
+ *
+ * There is deliberately no division operator: divide by a constant by
+ * multiplying by its reciprocal, computed once.
+ *
+ */
+class FixedPoint
+{
+ public:
+  static constexpr int FRACTIONAL_BITS{16};
+  static constexpr int32_t ONE{int32_t{1} << FRACTIONAL_BITS};
+
+  constexpr FixedPoint() = default;
+
+  // Rounds to the nearest representable value, saturating out of range values
+  constexpr explicit FixedPoint(float value) : raw(fromFloat(value))
+  {
+  }
+
+  constexpr explicit operator float() const
+  {
+    return static_cast<float>(this->raw) * (1.0F / static_cast<float>(ONE));
+  }
+
+  static constexpr FixedPoint fromRaw(int32_t raw)
+  {
+    FixedPoint value;
+    value.raw = raw;
+    return value;
+  }
+
+  [[nodiscard]] constexpr int32_t getRaw() const
+  {
+    return this->raw;
+  }
+
+  constexpr FixedPoint operator-() const
+  {
+    return fromRaw(saturate(-static_cast<int64_t>(this->raw)));
+  }
+
+  friend constexpr FixedPoint operator+(FixedPoint a, FixedPoint b)
+  {
+    return fromRaw(saturate(static_cast<int64_t>(a.raw) + b.raw));
+  }
+
+  friend constexpr FixedPoint operator-(FixedPoint a, FixedPoint b)
+  {
+    return fromRaw(saturate(static_cast<int64_t>(a.raw) - b.raw));
+  }
+
+  // Rounds the product to the nearest representable value
+  friend constexpr FixedPoint operator*(FixedPoint a, FixedPoint b)
+  {
+    int64_t product = static_cast<int64_t>(a.raw) * b.raw;
+    return fromRaw(
+        saturate((product + (int64_t{1} << (FRACTIONAL_BITS - 1))) >>
+                 FRACTIONAL_BITS));
+  }
+
+  constexpr FixedPoint& operator+=(FixedPoint other)
+  {
+    return *this = *this + other;
+  }
+
+  constexpr FixedPoint& operator-=(FixedPoint other)
+  {
+    return *this = *this - other;
+  }
+
+  constexpr FixedPoint& operator*=(FixedPoint other)
+  {
+    return *this = *this * other;
+  }
+
+  friend constexpr bool operator==(FixedPoint a, FixedPoint b)
+  {
+    return a.raw == b.raw;
+  }
+
+  friend constexpr bool operator!=(FixedPoint a, FixedPoint b)
+  {
+    return a.raw != b.raw;
+  }
+
+  friend constexpr bool operator<(FixedPoint a, FixedPoint b)
+  {
+    return a.raw < b.raw;
+  }
+
+  friend constexpr bool operator>(FixedPoint a, FixedPoint b)
+  {
+    return a.raw > b.raw;
+  }
+
+  friend constexpr bool operator<=(FixedPoint a, FixedPoint b)
+  {
+    return a.raw <= b.raw;
+  }
+
+  friend constexpr bool operator>=(FixedPoint a, FixedPoint b)
+  {
+    return a.raw >= b.raw;
+  }
+
+ private:
+  int32_t raw{0};
+
+  static constexpr int32_t saturate(int64_t value)
+  {
+    if (value > std::numeric_limits<int32_t>::max())
+    {
+      return std::numeric_limits<int32_t>::max();
+    }
+    if (value < std::numeric_limits<int32_t>::min())
+    {
+      return std::numeric_limits<int32_t>::min();
+    }
+    return static_cast<int32_t>(value);
+  }
+
+  static constexpr int32_t fromFloat(float value)
+  {
+    float scaled = value * static_cast<float>(ONE);
+    if (scaled >= static_cast<float>(std::numeric_limits<int32_t>::max()))
+    {
+      return std::numeric_limits<int32_t>::max();
+    }
+    if (scaled <= static_cast<float>(std::numeric_limits<int32_t>::min()))
+    {
+      return std::numeric_limits<int32_t>::min();
+    }
+    return static_cast<int32_t>(scaled + (scaled >= 0 ? 0.5F : -0.5F));
+  }
+};
@@ -1,8 +1,12 @@
 #pragma once
+#include <algorithm>
 
 /**
  * @brief Class to map a linear range to another linear range
  *
+ * The class is constexpr so maps can also be evaluated at compile time (e.g.
+ * to generate lookup tables)
+ *
  */
 class LinearMap
 {
@@ -15,7 +19,16 @@ class LinearMap
     float outputMax;
   };
 
-  LinearMap(Params params);
+  constexpr LinearMap(Params params)
+      : params(params),
+        // Calculating the linear constants
+        // m = outputRange / inputRange
+        // c = outputMax - m * inputMax
+        m((params.outputMax - params.outputMin) /
+          (params.inputMax - params.inputMin)),
+        c(params.outputMax - this->m * params.inputMax)
+  {
+  }
 
   /**
    * @brief Get the output value for a given input value
@@ -23,10 +36,21 @@ class LinearMap
    * @param input The input value
    * @return float The output value
    */
-  [[nodiscard]] float getOutput(float input) const;
+  [[nodiscard]] constexpr float getOutput(float input) const
+  {
+    // Linear equation:
+    // Y = m * X + c, where:
+    // -> Y is the output value
+    // -> X is the input value
+    // -> m is the slope
+    // -> c is the y-intercept
+    return std::clamp(this->m * input + this->c,
+                      this->params.outputMin,
+                      this->params.outputMax);
+  }
 
  private:
   Params params;
   float m;
   float c;
-};
\ No newline at end of file
+};
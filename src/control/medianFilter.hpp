@@ -0,0 +1,55 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Streaming median filter over a fixed-size window of the most recent
+ * samples
+ *
+ * The window is a ring buffer, so no memory is allocated and every update
+ * costs the same (a copy and partial sort of WindowSize floats). Single-sample
+ * spikes and dropouts are removed entirely as long as they make up less than
+ * half of the window.
+ *
+ */
+template <size_t WindowSize> class MedianFilter
+{
+  static_assert(WindowSize % 2 == 1, "Median window size must be odd");
+
+ public:
+  /**
+   * @brief Add a sample to the window and get the median of the window
+   *
+   * @param sample The newest sample
+   * @return float The median of the samples in the window. Until the window is
+   * full, only the samples seen so far are considered
+   */
+  float update(float sample)
+  {
+    this->window.at(this->next) = sample;
+    this->next = (this->next + 1) % WindowSize;
+    this->count = std::min(this->count + 1, WindowSize);
+
+    std::array<float, WindowSize> sorted = this->window;
+    auto middle = sorted.begin() + static_cast<std::ptrdiff_t>(this->count / 2);
+    std::nth_element(sorted.begin(),
+                     middle,
+                     sorted.begin() + static_cast<std::ptrdiff_t>(this->count));
+    return *middle;
+  }
+
+  /**
+   * @brief Whether the window has been filled with samples
+   *
+   */
+  [[nodiscard]] bool isFull() const
+  {
+    return this->count == WindowSize;
+  }
+
+ private:
+  std::array<float, WindowSize> window{};
+  size_t next{0};
+  size_t count{0};
+};
@@ -0,0 +1,25 @@
+#include "outlierGate.hpp"
+#include <cmath>
+
+OutlierGate::OutlierGate(Params params) : params(params)
+{
+}
+
+float OutlierGate::update(float sample)
+{
+  bool isOutlier =
+      this->hasAcceptedSample &&
+      std::fabs(sample - this->lastAcceptedSample) > this->params.maxDelta &&
+      this->consecutiveRejections < this->params.maxConsecutiveRejections;
+
+  if (isOutlier)
+  {
+    this->consecutiveRejections++;
+    return this->lastAcceptedSample;
+  }
+
+  this->hasAcceptedSample = true;
+  this->lastAcceptedSample = sample;
+  this->consecutiveRejections = 0;
+  return sample;
+}
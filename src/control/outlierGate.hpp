@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Rejects samples that jump too far from the last accepted sample
+ *
+ * A real change in the signal (e.g. a new object stepping in front of the
+ * sensor) looks like an outlier at first. So after a number of consecutive
+ * rejections the gate gives in and accepts the new level.
+ *
+ */
+class OutlierGate
+{
+ public:
+  struct Params
+  {
+    float maxDelta;
+    uint32_t maxConsecutiveRejections;
+  };
+
+  OutlierGate(Params params);
+
+  /**
+   * @brief Pass a sample through the gate
+   *
+   * @param sample The newest sample
+   * @return float The sample if it was accepted, otherwise the last accepted
+   * sample
+   */
+  float update(float sample);
+
+ private:
+  Params params;
+  bool hasAcceptedSample{false};
+  float lastAcceptedSample{0.0F};
+  uint32_t consecutiveRejections{0};
+};
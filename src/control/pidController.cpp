@@ -1,87 +1,248 @@
-
 #include "pidController.hpp"
 #include "logging/log.hpp"
+#include "profiling/profiler.hpp"
 #include <algorithm>
+#include <utility>
+
+namespace
+{
+
+// Length of a timestep given in microseconds, in seconds and in 1 / seconds,
+// in the controller's type
+
+template <typename T> T secondsOf(uint32_t timestepUs);
+template <typename T>
+T inverseSecondsOf(uint32_t timestepUs, BoundedReciprocal const& reciprocal);
+
+template <> float secondsOf<float>(uint32_t timestepUs)
+{
+  return static_cast<float>(timestepUs) * 1e-6F;
+}
+
+template <>
+float inverseSecondsOf<float>(uint32_t timestepUs,
+                              BoundedReciprocal const& /*reciprocal*/)
+{
+  return 1e6F / static_cast<float>(timestepUs);
+}
 
-PidController::PidController(Parameters params)
+template <> FixedPoint secondsOf<FixedPoint>(uint32_t timestepUs)
+{
+  // timestepUs * 2^16 / 10^6, as a multiply by round(2^48 / 10^6) and a shift
+  constexpr uint64_t SCALE{281474977};
+  return FixedPoint::fromRaw(
+      static_cast<int32_t>((uint64_t{timestepUs} * SCALE) >> 32));
+}
+
+// Without a divide, which on the robot would be a 64-bit library call
+template <>
+FixedPoint inverseSecondsOf<FixedPoint>(uint32_t timestepUs,
+                                        BoundedReciprocal const& reciprocal)
+{
+  return reciprocal.get(timestepUs);
+}
+
+} // namespace
+
+template <typename T>
+PidController<T>::PidController(Parameters params)
     : params(params),
-      timestepSeconds(static_cast<float>(params.timestepMs) / 1000.0F)
+      Kp(params.Kp),
+      Kd(params.Kd),
+      Ki(params.Ki),
+      timestepSeconds(static_cast<float>(params.timestepMs) / 1000.0F),
+      inverseTimestepSeconds(1000.0F / static_cast<float>(params.timestepMs)),
+      maxControlSignal(params.maxControlSignal),
+      minControlSignal(params.minControlSignal),
+      derivativeSmoothingFactor(
+          std::clamp(params.derivativeSmoothingFactor, 0.0F, 1.0F)),
+      proportionalSetpointWeight(params.proportionalSetpointWeight),
+      derivativeSetpointWeight(params.derivativeSetpointWeight),
+      minTimestepUs(std::max(static_cast<uint32_t>(params.minTimestepFactor *
+                                                   params.timestepMs * 1000),
+                             uint32_t{1})),
+      maxTimestepUs(std::max(static_cast<uint32_t>(params.maxTimestepFactor *
+                                                   params.timestepMs * 1000),
+                             this->minTimestepUs)),
+      inverseSecondsOfTimestep(this->minTimestepUs, this->maxTimestepUs, 1e6F)
 {
+  this->updateIntegralLimits();
 }
 
-void PidController::updateKp(float Kp)
+template <typename T> void PidController<T>::updateKp(float Kp)
 {
   this->params.Kp = Kp;
+  this->Kp = T(Kp);
 }
 
-void PidController::updateKd(float Kd)
+template <typename T> void PidController<T>::updateKd(float Kd)
 {
   this->params.Kd = Kd;
+  this->Kd = T(Kd);
 }
 
-void PidController::updateKi(float Ki)
+template <typename T> void PidController<T>::updateKi(float Ki)
 {
   // Adjust the integral term if necessary
-  if (Ki > this->params.Ki && this->errorIntegral != 0.0)
+  if (Ki > this->params.Ki && this->errorIntegral != T(0.0F))
   {
     // Adjust the integral term so the next control effort is unaffected and we
     // don't see a jump in the output
-    float increaseRatio = Ki / this->params.Ki;
-    this->errorIntegral /= increaseRatio;
+    this->errorIntegral *= T(this->params.Ki / Ki);
   }
-  else if (Ki == 0.0)
+  else if (Ki == 0.0F)
   {
-    this->errorIntegral = 0.0;
+    this->errorIntegral = T(0.0F);
   }
 
   this->params.Ki = Ki;
+  this->Ki = T(Ki);
+  this->updateIntegralLimits();
 }
 
-float PidController::getControlSignal(float currentState, float targetState)
+template <typename T> void PidController<T>::reset()
 {
-  float currentError = targetState - currentState;
+  this->errorIntegral = T(0.0F);
+  this->filteredDerivative = T(0.0F);
+  this->previousDerivativeInput = T(0.0F);
+  this->initialised = false;
+}
 
-  float errorDerivative =
-      (currentError - previousError) / this->timestepSeconds;
+template <typename T>
+T PidController<T>::getControlSignal(T currentState,
+                                     T targetState,
+                                     T feedForward)
+{
+  PROFILE_STAGE("pid.step");
+  return this->step(currentState,
+                    targetState,
+                    feedForward,
+                    this->timestepSeconds,
+                    this->inverseTimestepSeconds);
+}
 
-  this->errorIntegral += (currentError * this->timestepSeconds);
+template <typename T>
+T PidController<T>::getControlSignal(uint32_t nowUs,
+                                     T currentState,
+                                     T targetState,
+                                     T feedForward)
+{
+  PROFILE_STAGE("pid.step");
 
-  if (this->params.windupLimitFactor != 1.0)
+  // The first step has no previous step to measure from
+  if (!this->initialised)
+  {
+    this->previousTimeUs = nowUs;
+    return this->step(currentState,
+                      targetState,
+                      feedForward,
+                      this->timestepSeconds,
+                      this->inverseTimestepSeconds);
+  }
+
+  uint32_t timestepUs = std::clamp(nowUs - this->previousTimeUs,
+                                   this->minTimestepUs,
+                                   this->maxTimestepUs);
+  this->previousTimeUs = nowUs;
+  return this->step(currentState,
+                    targetState,
+                    feedForward,
+                    secondsOf<T>(timestepUs),
+                    inverseSecondsOf<T>(timestepUs,
+                                        this->inverseSecondsOfTimestep));
+}
+
+template <typename T>
+T PidController<T>::step(T currentState,
+                         T targetState,
+                         T feedForward,
+                         T timestepSeconds,
+                         T inverseTimestepSeconds)
+{
+  T currentError = targetState - currentState;
+  T proportionalError =
+      (this->proportionalSetpointWeight * targetState) - currentState;
+  T derivativeInput =
+      (this->derivativeSetpointWeight * targetState) - currentState;
+
+  if (!this->initialised)
+  {
+    this->initialised = true;
+    this->previousDerivativeInput = derivativeInput;
+  }
+
+  T rawDerivative = (derivativeInput - this->previousDerivativeInput) *
+                    inverseTimestepSeconds;
+  this->filteredDerivative += this->derivativeSmoothingFactor *
+                              (rawDerivative - this->filteredDerivative);
+
+  this->errorIntegral += currentError * timestepSeconds;
+
+  if (this->params.windupLimitFactor != 1.0F)
   {
     this->applyAntiIntegralWindupMechanism();
   }
 
-  float controlSignal = (this->params.Kp * currentError) +
-                        (this->params.Kd * errorDerivative) +
-                        (this->params.Ki * this->errorIntegral);
+  T controlSignal = (this->Kp * proportionalError) +
+                    (this->Kd * this->filteredDerivative) +
+                    (this->Ki * this->errorIntegral) + feedForward;
 
-  this->previousError = currentError;
+  this->previousDerivativeInput = derivativeInput;
 
   // Clamp the output between the min and max control signal values
-  return std::clamp<float>(
-      controlSignal, params.minControlSignal, params.maxControlSignal);
+  return std::clamp<T>(
+      controlSignal, this->minControlSignal, this->maxControlSignal);
 }
 
-std::string PidController::Parameters::toString() const
+FormattedMessage<PidParameters::TO_STRING_SIZE> PidParameters::toString() const
 {
-  return format(
+  return format<TO_STRING_SIZE>(
       "PID Control Parameters \n Kp: %.2f, Kd: %.2f, Ki: %.2f, dtMs: %u, "
-      "Min: %.2f, Max: %.2f, Windup Factor:  %.2f",
+      "Min: %.2f, Max: %.2f, Windup Factor:  %.2f, Derivative Smoothing: "
+      "%.2f, Setpoint Weights: %.2f, %.2f, Timestep Bounds: %.2f, %.2f",
       this->Kp,
       this->Kd,
       this->Ki,
       this->timestepMs,
       this->minControlSignal,
       this->maxControlSignal,
-      this->windupLimitFactor);
+      this->windupLimitFactor,
+      this->derivativeSmoothingFactor,
+      this->proportionalSetpointWeight,
+      this->derivativeSetpointWeight,
+      this->minTimestepFactor,
+      this->maxTimestepFactor);
 }
 
-void PidController::applyAntiIntegralWindupMechanism()
+template <typename T> void PidController<T>::updateIntegralLimits()
+{
+  // Without an integral gain the integral has no effect, so hold it at 0
+  // rather than dividing by 0
+  if (this->params.Ki == 0.0F)
+  {
+    this->minIntegral = T(0.0F);
+    this->maxIntegral = T(0.0F);
+    return;
+  }
+
+  float inverseKi = 1.0F / this->params.Ki;
+  this->minIntegral = T(this->params.windupLimitFactor *
+                        this->params.minControlSignal * inverseKi);
+  this->maxIntegral = T(this->params.windupLimitFactor *
+                        this->params.maxControlSignal * inverseKi);
+
+  // A negative Ki swaps the bounds
+  if (this->maxIntegral < this->minIntegral)
+  {
+    std::swap(this->minIntegral, this->maxIntegral);
+  }
+}
+
+template <typename T> void PidController<T>::applyAntiIntegralWindupMechanism()
 {
-  float minIntegral = this->params.windupLimitFactor *
-                      this->params.minControlSignal / this->params.Ki;
-  float maxIntegral = this->params.windupLimitFactor *
-                      this->params.maxControlSignal / this->params.Ki;
   this->errorIntegral =
-      std::clamp<float>(this->errorIntegral, minIntegral, maxIntegral);
-}
\ No newline at end of file
+      std::clamp<T>(this->errorIntegral, this->minIntegral, this->maxIntegral);
+}
+
+template class PidController<float>;
+template class PidController<FixedPoint>;
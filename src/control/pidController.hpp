@@ -1,26 +1,77 @@
 #pragma once
 
+#include "boundedReciprocal.hpp"
+#include "fixedPoint.hpp"
+#include "logging/format.hpp"
+#include <cstddef>
 #include <cstdint>
-#include <string>
+
+/**
+ * @brief Parameters of a PidController, whatever type it computes in
+ *
+ */
+struct PidParameters
+{
+  float Kp{0.0F};
+  float Kd{0.0F};
+  float Ki{0.0F};
+  uint32_t timestepMs{0};
+  float maxControlSignal{0.0F};
+  float minControlSignal{0.0F};
+  float windupLimitFactor{0.8F};
+
+  // Smoothing factor of the first-order low-pass filter on the derivative
+  // term (see ExponentialFilter). 1 leaves the derivative unfiltered
+  float derivativeSmoothingFactor{1.0F};
+
+  // Setpoint weights: the proportional and derivative terms act on
+  // (weight * targetState - currentState). A proportional weight below 1
+  // softens the response to setpoint steps, a derivative weight of 0 takes the
+  // derivative of the measurement only, so setpoint steps don't kick the
+  // output. The integral term always acts on the full error
+  float proportionalSetpointWeight{1.0F};
+  float derivativeSetpointWeight{1.0F};
+
+  // Bounds of a measured timestep, as multiples of timestepMs. A late step
+  // (e.g. after a stall) is treated as maxTimestepFactor * timestepMs long,
+  // so one spike can't blow up the integral or the derivative, and neither
+  // can two steps in quick succession. For FixedPoint, keep the bounds
+  // within BoundedReciprocal::MAX_RANGE_RATIO of each other
+  float minTimestepFactor{0.5F};
+  float maxTimestepFactor{2.0F};
+
+  // Longer than a log line
+  static constexpr size_t TO_STRING_SIZE{320};
+  [[nodiscard]] FormattedMessage<TO_STRING_SIZE> toString() const;
+};
 
 /**
  * @brief PID controller class
  *
+ * T is the type the control step is computed in: float, or FixedPoint for a
+ * control step that needs no FPU and takes the same time for every input. The
+ * parameters are always given as floats.
+ *
+ * Every reciprocal the step needs is computed up front, at construction and
+ * when a gain is updated, so getControlSignal only adds and multiplies. The
+ * overload that takes a measured timestamp also needs the reciprocal of the
+ * measured timestep: a float divide, or for FixedPoint a BoundedReciprocal,
+ * which only multiplies since the timestep is clamped to a known range.
+ *
+ * u = Kp * (b * r - y) + Kd * lowpass(d/dt (c * r - y)) + Ki * integral(r - y)
+ *     + feedForward
+ *
+ * where r is the target state, y the current state and b and c the setpoint
+ * weights. The integral is clamped by the anti-windup mechanism and u by the
+ * control signal limits.
+ *
+ * Both types are instantiated in pidController.cpp.
+ *
  */
-class PidController
+template <typename T> class PidController
 {
  public:
-  struct Parameters
-  {
-    float Kp{0.0F};
-    float Kd{0.0F};
-    float Ki{0.0F};
-    uint32_t timestepMs{0};
-    float maxControlSignal{0.0F};
-    float minControlSignal{0.0F};
-    float windupLimitFactor{0.8F};
-    [[nodiscard]] std::string toString() const;
-  };
+  using Parameters = PidParameters;
 
   PidController(Parameters params);
 
@@ -28,14 +79,72 @@ class PidController
   void updateKd(float Kd);
   void updateKi(float Ki);
 
-  float getControlSignal(float currentState, float targetState);
+  /**
+   * @brief Step the controller
+   *
+   * @param feedForward - added to the control signal before it is clamped,
+   * e.g. the control effort a known disturbance or setpoint change calls for
+   */
+  T getControlSignal(T currentState, T targetState, T feedForward = T{});
+
+  /**
+   * @brief Step the controller, using the time since the previous step
+   * instead of timestepMs for the derivative and integral terms
+   *
+   * @param nowUs - free running time of the step, e.g. micros()
+   * @param feedForward - see above
+   */
+  T getControlSignal(uint32_t nowUs,
+                     T currentState,
+                     T targetState,
+                     T feedForward = T{});
+
+  /**
+   * @brief Clear the integral and derivative history, e.g. when the
+   * controller takes over again after a pause
+   *
+   */
+  void reset();
 
  private:
   Parameters params;
 
-  float timestepSeconds{0.0F};
-  float errorIntegral{0.0F};
-  float previousError{0.0F};
+  T Kp;
+  T Kd;
+  T Ki;
+  T timestepSeconds;
+  T inverseTimestepSeconds;
+  T maxControlSignal;
+  T minControlSignal;
+  T derivativeSmoothingFactor;
+  T proportionalSetpointWeight;
+  T derivativeSetpointWeight;
+
+  // Bounds of errorIntegral, computed from the windup limit factor and Ki
+  T maxIntegral;
+  T minIntegral;
+
+  // Measured timesteps are clamped to these
+  uint32_t minTimestepUs;
+  uint32_t maxTimestepUs;
+  uint32_t previousTimeUs{0};
+
+  // 1 / a measured timestep in seconds, for FixedPoint
+  BoundedReciprocal inverseSecondsOfTimestep;
+
+  T errorIntegral{0.0F};
+  T filteredDerivative{0.0F};
+
+  // (c * r - y) of the previous step. The first step after construction or
+  // reset has no previous step, so its derivative is zero
+  T previousDerivativeInput{0.0F};
+  bool initialised{false};
 
+  T step(T currentState,
+         T targetState,
+         T feedForward,
+         T timestepSeconds,
+         T inverseTimestepSeconds);
+  void updateIntegralLimits();
   void applyAntiIntegralWindupMechanism();
 };
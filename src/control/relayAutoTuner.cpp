@@ -0,0 +1,117 @@
+#include "relayAutoTuner.hpp"
+#include <algorithm>
+#include <cmath>
+
+RelayAutoTuner::RelayAutoTuner(Params params) : params(params)
+{
+}
+
+void RelayAutoTuner::start(uint32_t nowMs)
+{
+  this->status = Status::running;
+  this->result = {};
+  this->startMs = nowMs;
+  this->cycles = 0;
+  this->measuredCycles = 0;
+  this->periodSumMs = 0;
+  this->amplitudeSum = 0;
+
+  // The first update decides which way the relay starts
+  this->relayHigh = false;
+  this->cycleStartMs = nowMs;
+  this->cycleMaxError = -INFINITY;
+  this->cycleMinError = INFINITY;
+}
+
+float RelayAutoTuner::update(float error, uint32_t nowMs)
+{
+  if (this->status != Status::running)
+  {
+    return 0;
+  }
+
+  if (nowMs - this->startMs >= this->params.timeoutMs)
+  {
+    this->status = Status::failed;
+    return 0;
+  }
+
+  this->cycleMaxError = std::max(this->cycleMaxError, error);
+  this->cycleMinError = std::min(this->cycleMinError, error);
+
+  if (!this->relayHigh && error > this->params.hysteresis)
+  {
+    this->relayHigh = true;
+    this->completeCycle(nowMs);
+  }
+  else if (this->relayHigh && error < -this->params.hysteresis)
+  {
+    this->relayHigh = false;
+  }
+
+  if (this->status != Status::running)
+  {
+    return 0;
+  }
+  return this->relayHigh ? this->params.relayAmplitude
+                         : -this->params.relayAmplitude;
+}
+
+RelayAutoTuner::Status RelayAutoTuner::getStatus() const
+{
+  return this->status;
+}
+
+RelayAutoTuner::Result RelayAutoTuner::getResult() const
+{
+  return this->result;
+}
+
+RelayAutoTuner::PiGains RelayAutoTuner::zieglerNicholsPi(Result result)
+{
+  return {.Kp = 0.45F * result.ultimateGain,
+          .integralTimeS = result.ultimatePeriodS / 1.2F};
+}
+
+void RelayAutoTuner::completeCycle(uint32_t nowMs)
+{
+  // The first switch high only starts the first cycle
+  if (this->cycles++ > this->params.settleCycles)
+  {
+    this->periodSumMs += nowMs - this->cycleStartMs;
+    this->amplitudeSum += (this->cycleMaxError - this->cycleMinError) / 2;
+    this->measuredCycles++;
+  }
+
+  this->cycleStartMs = nowMs;
+  this->cycleMaxError = -INFINITY;
+  this->cycleMinError = INFINITY;
+
+  if (this->measuredCycles == this->params.measureCycles)
+  {
+    this->finish();
+  }
+}
+
+void RelayAutoTuner::finish()
+{
+  float amplitude =
+      this->amplitudeSum / static_cast<float>(this->measuredCycles);
+
+  // An oscillation inside the hysteresis band can't be measured
+  if (amplitude <= this->params.hysteresis)
+  {
+    this->status = Status::failed;
+    return;
+  }
+
+  constexpr float PI{3.14159265F};
+  this->result.ultimateGain =
+      4 * this->params.relayAmplitude /
+      (PI * std::sqrt(amplitude * amplitude -
+                      this->params.hysteresis * this->params.hysteresis));
+  this->result.ultimatePeriodS = static_cast<float>(this->periodSumMs) /
+                                 static_cast<float>(this->measuredCycles) /
+                                 1000.0F;
+  this->status = Status::finished;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Relay feedback experiment (Astrom-Hagglund) that measures the
+ * ultimate gain and period of a plant, from which PID gains can be derived
+ * with the Ziegler-Nichols rules
+ *
+ * While running, the controller output is replaced by a relay: +amplitude
+ * while the error is positive, -amplitude while it is negative, with a
+ * hysteresis band so noise can't make the relay chatter. The plant settles
+ * into an oscillation whose period is the ultimate period Tu and whose error
+ * amplitude a gives the ultimate gain
+ *
+ *   Ku = 4 * amplitude / (pi * sqrt(a^2 - hysteresis^2))
+ *
+ * The first cycles are discarded while the oscillation builds up, then Tu and
+ * a are averaged over the measured cycles. The experiment fails if it doesn't
+ * finish within the timeout (e.g. the plant doesn't oscillate).
+ *
+ */
+class RelayAutoTuner
+{
+ public:
+  struct Params
+  {
+    float relayAmplitude;
+    float hysteresis;
+    uint32_t settleCycles;
+    uint32_t measureCycles;
+    uint32_t timeoutMs;
+  };
+
+  enum class Status
+  {
+    running,
+    finished,
+    failed
+  };
+
+  struct Result
+  {
+    float ultimateGain{0};
+    float ultimatePeriodS{0};
+  };
+
+  // Gains of a positional (non-incremental) PI controller
+  struct PiGains
+  {
+    float Kp{0};
+    float integralTimeS{0};
+  };
+
+  RelayAutoTuner(Params params);
+
+  /**
+   * @brief Start (or restart) the experiment
+   *
+   */
+  void start(uint32_t nowMs);
+
+  /**
+   * @brief Feed the newest error to the relay
+   *
+   * @return float - the relay output, +-relayAmplitude. Once the experiment
+   * has finished or failed it is 0
+   */
+  float update(float error, uint32_t nowMs);
+
+  [[nodiscard]] Status getStatus() const;
+
+  /**
+   * @brief Get the measured ultimate gain and period. Only valid once the
+   * experiment has finished
+   *
+   */
+  [[nodiscard]] Result getResult() const;
+
+  /**
+   * @brief Ziegler-Nichols PI gains: Kp = 0.45 * Ku, Ti = Tu / 1.2
+   *
+   */
+  static PiGains zieglerNicholsPi(Result result);
+
+ private:
+  Params params;
+  Status status{Status::failed};
+  Result result;
+
+  uint32_t startMs{0};
+  bool relayHigh{false};
+
+  // Current cycle, which starts when the relay switches high
+  uint32_t cycles{0};
+  uint32_t cycleStartMs{0};
+  float cycleMaxError{0};
+  float cycleMinError{0};
+
+  // Sums over the measured cycles
+  uint32_t measuredCycles{0};
+  uint32_t periodSumMs{0};
+  float amplitudeSum{0};
+
+  void completeCycle(uint32_t nowMs);
+  void finish();
+};
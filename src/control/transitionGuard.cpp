@@ -0,0 +1,69 @@
+#include "transitionGuard.hpp"
+
+TransitionGuard::TransitionGuard(Params params, Zone initialZone)
+    : params(params), zone(initialZone)
+{
+}
+
+TransitionGuard::Zone TransitionGuard::update(float input, uint32_t nowMs)
+{
+  // The dwell time of the initial zone starts at the first update
+  if (!this->dwellStarted)
+  {
+    this->dwellStarted = true;
+    this->zoneEnteredMs = nowMs;
+    this->windowStartMs = nowMs;
+  }
+
+  // Roll the transition rate window over
+  if (nowMs - this->windowStartMs >= ONE_MINUTE_MS)
+  {
+    this->transitionsInLastWindow = this->transitionsInWindow;
+    this->transitionsInWindow = 0;
+    this->windowStartMs = nowMs;
+  }
+
+  Zone desiredZone = this->unguardedZone(input);
+  if (desiredZone == this->zone)
+  {
+    return this->zone;
+  }
+
+  bool hasDwelled = nowMs - this->zoneEnteredMs >= this->params.minDwellMs;
+  if (desiredZone == Zone::below || hasDwelled)
+  {
+    this->zone = desiredZone;
+    this->zoneEnteredMs = nowMs;
+    this->transitionsInWindow++;
+  }
+  return this->zone;
+}
+
+uint32_t TransitionGuard::getTransitionsPerMinute() const
+{
+  return this->transitionsInLastWindow;
+}
+
+TransitionGuard::Zone TransitionGuard::unguardedZone(float input) const
+{
+  // The thresholds move away from the current zone by the hysteresis band, so
+  // the input has to travel further to leave a zone than it did to enter it
+  float lowerThreshold = this->zone == Zone::below
+                             ? this->params.lowerThreshold +
+                                   this->params.hysteresis
+                             : this->params.lowerThreshold;
+  float upperThreshold = this->zone == Zone::above
+                             ? this->params.upperThreshold -
+                                   this->params.hysteresis
+                             : this->params.upperThreshold;
+
+  if (input < lowerThreshold)
+  {
+    return Zone::below;
+  }
+  if (input > upperThreshold)
+  {
+    return Zone::above;
+  }
+  return Zone::within;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Splits an input (e.g. a distance) into three zones - below, within
+ * and above a range - and guards the transitions between them with hysteresis
+ * and a minimum dwell time, so an input sitting on a threshold can't make a
+ * StateMachine flap between two states every cycle
+ *
+ * - Entering a zone requires the input to cross the nominal threshold
+ * - Leaving a zone back across the same threshold requires the input to cross
+ *   the threshold by the hysteresis band
+ * - A zone must be held for the minimum dwell time before it can be left
+ *
+ * The below zone is the safety zone of the StateMachines that use this guard
+ * (e.g. TooCloseState), so entering it is never held back by the dwell time.
+ *
+ * The number of transitions is counted over fixed one minute windows so the
+ * flapping rate can be monitored.
+ *
+ */
+class TransitionGuard
+{
+ public:
+  enum class Zone
+  {
+    below,
+    within,
+    above
+  };
+
+  struct Params
+  {
+    float lowerThreshold;
+    float upperThreshold;
+    float hysteresis;
+    uint32_t minDwellMs;
+  };
+
+  TransitionGuard(Params params, Zone initialZone);
+
+  /**
+   * @brief Get the guarded zone for the newest input
+   *
+   * @param input The newest input value
+   * @param nowMs The current time
+   * @return Zone The zone the input is considered to be in
+   */
+  Zone update(float input, uint32_t nowMs);
+
+  /**
+   * @brief Number of transitions that took place in the last complete minute
+   *
+   */
+  [[nodiscard]] uint32_t getTransitionsPerMinute() const;
+
+ private:
+  Params params;
+  Zone zone;
+  bool dwellStarted{false};
+  uint32_t zoneEnteredMs{0};
+
+  // Transition rate instrumentation
+  static constexpr uint32_t ONE_MINUTE_MS{60000};
+  uint32_t windowStartMs{0};
+  uint32_t transitionsInWindow{0};
+  uint32_t transitionsInLastWindow{0};
+
+  [[nodiscard]] Zone unguardedZone(float input) const;
+};
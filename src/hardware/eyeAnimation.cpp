@@ -0,0 +1,159 @@
+#include "eyeAnimation.hpp"
+#include <algorithm>
+#include <cstddef>
+
+namespace
+{
+
+constexpr uint64_t integerSquareRoot(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = uint64_t{1} << 62;
+  while (bit > value)
+  {
+    bit >>= 2;
+  }
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// 255 * (x / 255)^2.5 = sqrt(x^5 / 255^3), rounded. Computed at compile time
+constexpr std::array<uint8_t, 256> makeGammaTable()
+{
+  std::array<uint8_t, 256> table{};
+  for (uint64_t x = 0; x < table.size(); x++)
+  {
+    uint64_t squared = x * x * x * x * x / (uint64_t{255} * 255 * 255);
+    uint64_t root = integerSquareRoot(squared);
+    if (squared - root * root > root)
+    {
+      root++;
+    }
+    table[x] = static_cast<uint8_t>(root);
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> GAMMA_TABLE = makeGammaTable();
+
+// The lowest perceived brightness whose duty cycle is nearest each duty cycle
+constexpr std::array<uint8_t, 256> makeInverseGammaTable()
+{
+  std::array<uint8_t, 256> table{};
+  for (int dutyCycle = 0; dutyCycle < static_cast<int>(table.size());
+       dutyCycle++)
+  {
+    int nearest = 0;
+    for (int brightness = 1; brightness < static_cast<int>(table.size());
+         brightness++)
+    {
+      int distance = GAMMA_TABLE[brightness] - dutyCycle;
+      int nearestDistance = GAMMA_TABLE[nearest] - dutyCycle;
+      if (distance * distance < nearestDistance * nearestDistance)
+      {
+        nearest = brightness;
+      }
+    }
+    table[dutyCycle] = static_cast<uint8_t>(nearest);
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> INVERSE_GAMMA_TABLE =
+    makeInverseGammaTable();
+
+} // namespace
+
+namespace EyeAnimation
+{
+
+uint32_t getDurationMs(Keyframe const& keyframe)
+{
+  return keyframe.repeats * keyframe.periodMs;
+}
+
+Rgb colourAt(Keyframe const& keyframe, uint32_t elapsedMs)
+{
+  uint32_t periodMs = keyframe.periodMs;
+  uint32_t phaseMs = elapsedMs % periodMs;
+
+  switch (keyframe.type)
+  {
+    case Keyframe::Type::fade:
+      return blend(
+          keyframe.from,
+          keyframe.to,
+          static_cast<uint32_t>(uint64_t{phaseMs} * PROGRESS_ONE / periodMs));
+    case Keyframe::Type::blink:
+      return 2 * phaseMs < periodMs ? keyframe.to : keyframe.from;
+    case Keyframe::Type::pulse:
+    {
+      // Up for the first half of the period, down for the second
+      uint32_t distanceFromEndMs =
+          2 * phaseMs < periodMs ? phaseMs : periodMs - phaseMs;
+      return blend(keyframe.from,
+                   keyframe.to,
+                   static_cast<uint32_t>(uint64_t{distanceFromEndMs} * 2 *
+                                         PROGRESS_ONE / periodMs));
+    }
+  }
+  return keyframe.to;
+}
+
+Rgb getEndColour(Keyframe const& keyframe)
+{
+  return keyframe.type == Keyframe::Type::fade ? keyframe.to : keyframe.from;
+}
+
+Rgb blend(Rgb from, Rgb to, uint32_t progress)
+{
+  // The ends are the given duty cycles, exactly
+  if (progress == 0)
+  {
+    return from;
+  }
+  if (progress >= PROGRESS_ONE)
+  {
+    return to;
+  }
+
+  Rgb colour{};
+  for (size_t i = 0; i < colour.size(); i++)
+  {
+    int fromBrightness = toBrightness(from.at(i));
+    int difference = toBrightness(to.at(i)) - fromBrightness;
+    uint8_t dutyCycle = gammaCorrect(static_cast<uint8_t>(
+        fromBrightness + difference * static_cast<int>(progress) /
+                             static_cast<int>(PROGRESS_ONE)));
+    // A duty cycle and the duty cycle of its brightness can be one apart, so
+    // keep the blend between the ends
+    colour.at(i) = std::clamp(dutyCycle,
+                              std::min(from.at(i), to.at(i)),
+                              std::max(from.at(i), to.at(i)));
+  }
+  return colour;
+}
+
+uint8_t gammaCorrect(uint8_t brightness)
+{
+  return GAMMA_TABLE.at(brightness);
+}
+
+uint8_t toBrightness(uint8_t dutyCycle)
+{
+  return INVERSE_GAMMA_TABLE.at(dutyCycle);
+}
+
+} // namespace EyeAnimation
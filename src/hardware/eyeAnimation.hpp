@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The eye animation keyframes and the colour they show over time, in
+ * integer arithmetic only. Shared by Eyes, which times the keyframes, and
+ * EyeSequence, which turns a keyframe into a sequence the PWM peripheral plays
+ *
+ * Colours are LED duty cycles. Keyframes start and end on their colours
+ * exactly, and blend in between in perceived brightness, so fades look even
+ * rather than rushing through the dim end.
+ *
+ */
+namespace EyeAnimation
+{
+
+using Rgb = std::array<uint8_t, 3>;
+
+// A keyframe plays for repeats * periodMs
+struct Keyframe
+{
+  enum class Type : uint8_t
+  {
+    // From one colour to the other, over the period
+    fade,
+    // The to colour for the first half of each period, the from colour for
+    // the second half
+    blink,
+    // From the from colour to the to colour and back, within each period
+    pulse
+  };
+
+  Type type;
+  Rgb from;
+  Rgb to;
+  uint16_t repeats;
+  uint32_t periodMs;
+};
+
+// Blend progress, from 0 to PROGRESS_ONE
+constexpr uint32_t PROGRESS_ONE{256};
+
+uint32_t getDurationMs(Keyframe const& keyframe);
+
+/**
+ * @brief The colour of a keyframe elapsedMs into it
+ *
+ */
+Rgb colourAt(Keyframe const& keyframe, uint32_t elapsedMs);
+
+/**
+ * @brief The colour a keyframe leaves the eyes in: the to colour of a fade,
+ * the from colour of a blink or a pulse
+ *
+ */
+Rgb getEndColour(Keyframe const& keyframe);
+
+/**
+ * @brief The colour progress of the way from one colour to another, evenly in
+ * perceived brightness. From at 0 and to at PROGRESS_ONE
+ *
+ */
+Rgb blend(Rgb from, Rgb to, uint32_t progress);
+
+/**
+ * @brief LED duty cycle (0-255) for a perceived brightness, with a gamma of
+ * 2.5
+ *
+ */
+uint8_t gammaCorrect(uint8_t brightness);
+
+/**
+ * @brief The perceived brightness whose duty cycle is nearest a duty cycle,
+ * the inverse of gammaCorrect
+ *
+ */
+uint8_t toBrightness(uint8_t dutyCycle);
+
+} // namespace EyeAnimation
@@ -0,0 +1,63 @@
+#include "eyePwm.hpp"
+#include "Arduino.h"
+#include "nrf.h"
+
+EyePwm::EyePwm(std::array<int, 3> pins, EyeSequence::Polarity polarity)
+    : polarity(polarity)
+{
+  NRF_PWM_Type* pwm = NRF_PWM2;
+
+  // The pins idle with the LED off until the first sequence plays
+  for (size_t channel = 0; channel < pins.size(); channel++)
+  {
+    pinMode(pins.at(channel), OUTPUT);
+    digitalWrite(pins.at(channel),
+                 polarity == EyeSequence::Polarity::activeLow ? HIGH : LOW);
+    pwm->PSEL.OUT[channel] = g_ADigitalPinMap[pins.at(channel)];
+  }
+  pwm->PSEL.OUT[3] = PWM_PSEL_OUT_CONNECT_Disconnected
+                     << PWM_PSEL_OUT_CONNECT_Pos;
+
+  // 16MHz / 16 = 1MHz, counting up to COUNTER_TOP
+  pwm->ENABLE = PWM_ENABLE_ENABLE_Enabled << PWM_ENABLE_ENABLE_Pos;
+  pwm->MODE = PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos;
+  pwm->PRESCALER = PWM_PRESCALER_PRESCALER_DIV_16
+                   << PWM_PRESCALER_PRESCALER_Pos;
+  pwm->COUNTERTOP = EyeSequence::COUNTER_TOP;
+  pwm->LOOP = 0;
+  pwm->DECODER = (PWM_DECODER_LOAD_Individual << PWM_DECODER_LOAD_Pos) |
+                 (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+  pwm->SEQ[0].ENDDELAY = 0;
+  pwm->SHORTS = 0;
+}
+
+void EyePwm::play(EyeAnimation::Keyframe const& keyframe)
+{
+  EyeSequence& sequence = this->getIdleSequence();
+  sequence.generate(keyframe, this->polarity);
+  EyePwm::start(sequence);
+}
+
+void EyePwm::setColour(EyeAnimation::Rgb colour)
+{
+  EyeSequence& sequence = this->getIdleSequence();
+  sequence.generate(colour, this->polarity);
+  EyePwm::start(sequence);
+}
+
+EyeSequence& EyePwm::getIdleSequence()
+{
+  EyeSequence& sequence = this->sequences.at(this->nextSequence);
+  this->nextSequence = (this->nextSequence + 1) % this->sequences.size();
+  return sequence;
+}
+
+void EyePwm::start(EyeSequence const& sequence)
+{
+  NRF_PWM_Type* pwm = NRF_PWM2;
+  pwm->SEQ[0].PTR = reinterpret_cast<uintptr_t>(sequence.getSteps());
+  pwm->SEQ[0].CNT = sequence.getLength() * std::tuple_size_v<EyeSequence::Step>;
+  pwm->SEQ[0].REFRESH = sequence.getRefresh();
+  pwm->EVENTS_SEQEND[0] = 0;
+  pwm->TASKS_SEQSTART[0] = 1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "eyeSequence.hpp"
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Drives the eye RGB LED with the nRF52 PWM peripheral (PWM2): a
+ * keyframe is precomputed into an EyeSequence in RAM and the peripheral plays
+ * it back by EasyDMA, so the CPU does nothing while a fade plays. At the end
+ * of a sequence the peripheral holds its last step
+ *
+ * There are two sequence buffers, used in turn, so a sequence is never
+ * overwritten while the peripheral may still be reading it.
+ *
+ */
+class EyePwm
+{
+ public:
+  EyePwm(std::array<int, 3> pins, EyeSequence::Polarity polarity);
+
+  /**
+   * @brief Start playing a keyframe, replacing whatever is playing
+   *
+   */
+  void play(EyeAnimation::Keyframe const& keyframe);
+
+  /**
+   * @brief Hold a colour, replacing whatever is playing
+   *
+   */
+  void setColour(EyeAnimation::Rgb colour);
+
+ private:
+  EyeSequence::Polarity polarity;
+
+  std::array<EyeSequence, 2> sequences;
+  size_t nextSequence{0};
+
+  EyeSequence& getIdleSequence();
+  static void start(EyeSequence const& sequence);
+};
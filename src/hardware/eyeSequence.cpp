@@ -0,0 +1,91 @@
+#include "eyeSequence.hpp"
+#include <algorithm>
+
+void EyeSequence::generate(EyeAnimation::Keyframe const& keyframe,
+                           Polarity polarity)
+{
+  uint32_t durationMs = EyeAnimation::getDurationMs(keyframe);
+  size_t numberOfSteps = std::clamp<size_t>(
+      durationMs / MIN_STEP_MS, 1, MAX_STEPS);
+
+  // Steps line up with the half periods of a blink or a pulse. There is no
+  // whole number of steps per half period if there are too many of them, so
+  // those are sampled as finely as possible instead
+  if (keyframe.type != EyeAnimation::Keyframe::Type::fade)
+  {
+    size_t halfPeriods = size_t{2} * keyframe.repeats;
+    if (halfPeriods <= MAX_STEPS)
+    {
+      numberOfSteps = std::max(numberOfSteps / halfPeriods, size_t{1}) *
+                      halfPeriods;
+    }
+  }
+
+  for (size_t step = 0; step < numberOfSteps; step++)
+  {
+    auto elapsedMs =
+        static_cast<uint32_t>(uint64_t{durationMs} * step / numberOfSteps);
+    EyeAnimation::Rgb colour = step + 1 < numberOfSteps
+                                   ? EyeAnimation::colourAt(keyframe, elapsedMs)
+                                   : EyeAnimation::getEndColour(keyframe);
+    this->steps.at(step) = EyeSequence::toStep(colour, polarity);
+  }
+  this->length = numberOfSteps;
+
+  // Steps are a whole number of PWM periods, the nearest to the step length
+  uint64_t stepUs = uint64_t{durationMs} * 1000 / numberOfSteps;
+  uint64_t periods = (stepUs + PWM_PERIOD_US / 2) / PWM_PERIOD_US;
+  this->refresh = static_cast<uint32_t>(std::max<uint64_t>(periods, 1) - 1);
+}
+
+void EyeSequence::generate(EyeAnimation::Rgb colour, Polarity polarity)
+{
+  this->steps.at(0) = EyeSequence::toStep(colour, polarity);
+  this->length = 1;
+  this->refresh = 0;
+}
+
+EyeSequence::Step const* EyeSequence::getSteps() const
+{
+  return this->steps.data();
+}
+
+size_t EyeSequence::getLength() const
+{
+  return this->length;
+}
+
+uint32_t EyeSequence::getRefresh() const
+{
+  return this->refresh;
+}
+
+EyeAnimation::Rgb EyeSequence::getDutyCycles(size_t step) const
+{
+  Step const& values = this->steps.at(step);
+  EyeAnimation::Rgb dutyCycles{};
+  for (size_t channel = 0; channel < dutyCycles.size(); channel++)
+  {
+    dutyCycles.at(channel) =
+        static_cast<uint8_t>(values.at(channel) & ~ACTIVE_HIGH_BIT);
+  }
+  return dutyCycles;
+}
+
+uint32_t EyeSequence::getDurationUs() const
+{
+  return static_cast<uint32_t>(this->length) * (this->refresh + 1) *
+         PWM_PERIOD_US;
+}
+
+EyeSequence::Step EyeSequence::toStep(EyeAnimation::Rgb colour,
+                                      Polarity polarity)
+{
+  uint16_t polarityBit = polarity == Polarity::activeHigh ? ACTIVE_HIGH_BIT : 0;
+  Step step{polarityBit, polarityBit, polarityBit, polarityBit};
+  for (size_t channel = 0; channel < colour.size(); channel++)
+  {
+    step.at(channel) |= colour.at(channel);
+  }
+  return step;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "eyeAnimation.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A keyframe of the eye animation, precomputed as the duty cycle
+ * sequence the nRF52 PWM peripheral plays back by EasyDMA (see EyePwm)
+ *
+ * The layout is the peripheral's "individual" decoder layout: each step holds
+ * one 16-bit compare value per channel (red, green, blue and an unused fourth
+ * channel). Bit 15 of a compare value is the polarity, the rest is the duty
+ * cycle in PWM clock ticks, out of COUNTER_TOP. Every step is played for
+ * refresh + 1 PWM periods.
+ *
+ * A keyframe is sampled into at most MAX_STEPS steps of at least MIN_STEP_MS.
+ * Blinks and pulses get a whole number of steps per half period, so a blink
+ * switches exactly on its edges. The first step is the keyframe's starting
+ * colour and the last is its end colour, which the peripheral then holds.
+ *
+ */
+class EyeSequence
+{
+ public:
+  // The PWM clock runs at 1MHz and counts up to COUNTER_TOP, one tick per
+  // duty cycle level
+  static constexpr uint16_t COUNTER_TOP{255};
+  static constexpr uint32_t PWM_PERIOD_US{COUNTER_TOP};
+
+  static constexpr size_t MAX_STEPS{64};
+  static constexpr uint32_t MIN_STEP_MS{5};
+
+  enum class Polarity
+  {
+    // The LED lights while the output is high
+    activeHigh,
+    // The LED lights while the output is low, e.g. a common anode LED
+    activeLow
+  };
+
+  // Compare values of the red, green, blue and unused channels
+  using Step = std::array<uint16_t, 4>;
+
+  /**
+   * @brief Sample a keyframe. Replaces the previous sequence
+   *
+   */
+  void generate(EyeAnimation::Keyframe const& keyframe, Polarity polarity);
+
+  /**
+   * @brief A single step holding a colour
+   *
+   */
+  void generate(EyeAnimation::Rgb colour, Polarity polarity);
+
+  [[nodiscard]] Step const* getSteps() const;
+  [[nodiscard]] size_t getLength() const;
+
+  // Value of the peripheral's REFRESH register for this sequence
+  [[nodiscard]] uint32_t getRefresh() const;
+
+  /**
+   * @brief The duty cycles (0-COUNTER_TOP) of a step, with the polarity bit
+   * removed
+   *
+   */
+  [[nodiscard]] EyeAnimation::Rgb getDutyCycles(size_t step) const;
+
+  /**
+   * @brief How long the whole sequence plays for
+   *
+   */
+  [[nodiscard]] uint32_t getDurationUs() const;
+
+ private:
+  // Bit 15 set: the output is high for the duty cycle, clear: low
+  static constexpr uint16_t ACTIVE_HIGH_BIT{0x8000};
+
+  std::array<Step, MAX_STEPS> steps{};
+  size_t length{0};
+  uint32_t refresh{0};
+
+  static Step toStep(EyeAnimation::Rgb colour, Polarity polarity);
+};
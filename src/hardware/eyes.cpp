@@ -1,23 +1,116 @@
 #include "eyes.hpp"
+#include "logging/log.hpp"
+#include "profiling/profiler.hpp"
+#include <algorithm>
 
-Eyes::Eyes() : eyes(redPin, greenPin, bluePin, RGBLed::COMMON_ANODE)
+Eyes::Eyes() : eyes(PINS, EyeSequence::Polarity::activeLow)
 {
 }
 
 void Eyes::setColour(Colour colour)
 {
-  this->eyes.setColor(Eyes::rgbValueFromEyeColour(colour).data());
+  // An explicitly set colour overrides any animation that is still playing
+  this->keyframeHead = 0;
+  this->numberOfKeyframes = 0;
+  this->keyframeStarted = false;
+  this->eyes.setColour(Eyes::rgbValueFromEyeColour(colour));
 }
 
 void Eyes::crossFade(Colour from, Colour to, int milliSeconds)
 {
-  this->eyes.crossFade(Eyes::rgbValueFromEyeColour(from).data(),
-                       Eyes::rgbValueFromEyeColour(to).data(),
-                       CROSS_FADE_STEPS,
-                       milliSeconds);
+  this->queue({.type = Keyframe::Type::fade,
+               .from = Eyes::rgbValueFromEyeColour(from),
+               .to = Eyes::rgbValueFromEyeColour(to),
+               .repeats = 1,
+               .periodMs = static_cast<uint32_t>(milliSeconds)});
 }
 
-std::array<int, 3> Eyes::rgbValueFromEyeColour(Colour colour)
+void Eyes::blink(Colour colour, Colour background, int count, int periodMs)
+{
+  this->queue({.type = Keyframe::Type::blink,
+               .from = Eyes::rgbValueFromEyeColour(background),
+               .to = Eyes::rgbValueFromEyeColour(colour),
+               .repeats = static_cast<uint16_t>(count),
+               .periodMs = static_cast<uint32_t>(periodMs)});
+}
+
+void Eyes::pulse(Colour colour, Colour background, int count, int periodMs)
+{
+  this->queue({.type = Keyframe::Type::pulse,
+               .from = Eyes::rgbValueFromEyeColour(background),
+               .to = Eyes::rgbValueFromEyeColour(colour),
+               .repeats = static_cast<uint16_t>(count),
+               .periodMs = static_cast<uint32_t>(periodMs)});
+}
+
+void Eyes::queue(Keyframe keyframe)
+{
+  PROFILE_STAGE("eyes.queue");
+  if (this->numberOfKeyframes >= MAX_QUEUED_KEYFRAMES)
+  {
+    LOG_WARN("%s", "Eye animation queue is full - dropping animation");
+    return;
+  }
+
+  // A zero length period would play for no time at all, so it can't be
+  // divided by
+  keyframe.repeats = std::max<uint16_t>(keyframe.repeats, 1);
+  keyframe.periodMs = std::max<uint32_t>(keyframe.periodMs, 1);
+
+  size_t tail =
+      (this->keyframeHead + this->numberOfKeyframes) % MAX_QUEUED_KEYFRAMES;
+  this->keyframes.at(tail) = keyframe;
+  this->numberOfKeyframes++;
+}
+
+void Eyes::update(uint32_t nowMs)
+{
+  PROFILE_STAGE("eyes.update");
+  while (this->numberOfKeyframes > 0)
+  {
+    Keyframe const& keyframe = this->keyframes.at(this->keyframeHead);
+
+    // Keyframes are timed from the first update they are seen in, so queueing
+    // one never requires access to the clock
+    if (!this->keyframeStarted)
+    {
+      this->keyframeStarted = true;
+      this->keyframeStartMs = nowMs;
+      this->eyes.play(keyframe);
+    }
+
+    uint32_t durationMs = EyeAnimation::getDurationMs(keyframe);
+    if (nowMs - this->keyframeStartMs < durationMs)
+    {
+      return;
+    }
+
+    // The peripheral holds the end colour of the keyframe. Carry any
+    // overshoot into the next keyframe so chained keyframes keep time
+    uint32_t nextStartMs = this->keyframeStartMs + durationMs;
+    this->popKeyframe();
+    if (this->numberOfKeyframes > 0)
+    {
+      this->keyframeStarted = true;
+      this->keyframeStartMs = nextStartMs;
+      this->eyes.play(this->keyframes.at(this->keyframeHead));
+    }
+  }
+}
+
+bool Eyes::isFading() const
+{
+  return this->numberOfKeyframes > 0;
+}
+
+void Eyes::popKeyframe()
+{
+  this->keyframeHead = (this->keyframeHead + 1) % MAX_QUEUED_KEYFRAMES;
+  this->numberOfKeyframes--;
+  this->keyframeStarted = false;
+}
+
+EyeAnimation::Rgb Eyes::rgbValueFromEyeColour(Colour colour)
 {
   switch (colour)
   {
@@ -1,15 +1,25 @@
 #pragma once
 #include "Arduino.h"
-#include <RGBLed.h>
+#include "eyeAnimation.hpp"
+#include "eyePwm.hpp"
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 /**
  * @brief Represents and encapsulates the "eyes" of the robot
  *
  * Abstracts away the underlying eye colour mechanicam - an RGB LED - and only
- * exposes a method for setting the eye colour
+ * exposes methods for setting the eye colour and animating it
  *
- * Underlying Library: Uses the RGBLed library to control the RGB LED
+ * Animations (crossfades, blinks and pulses) are non-blocking: they are queued
+ * as keyframes (see EyeAnimation) and played back one after the other by
+ * calling the update method periodically (from the eyes task), so queueing
+ * one only costs a copy into the queue. When a keyframe starts, it is handed
+ * to the PWM peripheral as a precomputed duty cycle sequence, so the CPU does
+ * nothing while it plays. The update method only keeps time.
+ *
+ * Underlying Library: Drives the nRF52 PWM peripheral directly (see EyePwm)
  *
  */
 class Eyes
@@ -24,17 +34,31 @@ class Eyes
     light_blue,
   };
 
+  // RGB values for the various eye colours, as LED duty cycles
+  struct EyeColourRgbValues
+  {
+    static constexpr EyeAnimation::Rgb OFF{0, 0, 0};
+    static constexpr EyeAnimation::Rgb RED{255, 0, 0};
+    static constexpr EyeAnimation::Rgb GREEN{0, 255, 0};
+    static constexpr EyeAnimation::Rgb BLUE{0, 0, 255};
+    static constexpr EyeAnimation::Rgb LIGHT_BLUE{173, 216, 255};
+  };
+
+  static EyeAnimation::Rgb rgbValueFromEyeColour(Colour colour);
+
   Eyes();
 
   /**
-   * @brief Set the Colour object
+   * @brief Set the Colour object. Cancels any queued animation
    *
    * @param colour - the desired colour of the eyes
    */
   void setColour(Colour colour);
 
   /**
-   * @brief Crossfade from one colour to another
+   * @brief Queue a crossfade from one colour to another. The crossfade starts
+   * once all previously queued animations have finished. Fading from a colour
+   * to the same colour holds that colour for the given duration
    *
    * @param from - the starting colour
    * @param to - the ending colour
@@ -42,27 +66,56 @@ class Eyes
    */
   void crossFade(Colour from, Colour to, int milliSeconds);
 
+  /**
+   * @brief Queue a blink: the colour for the first half of each period, the
+   * background colour for the second half. Ends on the background colour
+   *
+   * @param count - the number of blinks
+   * @param periodMs - the duration of one blink
+   */
+  void blink(Colour colour, Colour background, int count, int periodMs);
+
+  /**
+   * @brief Queue a pulse: a fade from the background colour to the colour and
+   * back, within each period. Ends on the background colour
+   *
+   * @param count - the number of pulses
+   * @param periodMs - the duration of one pulse
+   */
+  void pulse(Colour colour, Colour background, int count, int periodMs);
+
+  /**
+   * @brief Advance the queued animations. Must be called periodically
+   *
+   * @param nowMs - the current time
+   */
+  void update(uint32_t nowMs);
+
+  /**
+   * @brief Whether any animation is still playing or queued
+   *
+   */
+  [[nodiscard]] bool isFading() const;
+
  private:
   // The pins the RGB LED is connected to. In the case of the robot, there are
-  // two RGB LEDs wired togeher - each LED represents one eye
-  int redPin{A0};
-  int greenPin{A1};
-  int bluePin{A2};
+  // two RGB LEDs wired togeher - each LED represents one eye. They are common
+  // anode LEDs, lit while a pin is low
+  static constexpr std::array<int, 3> PINS{A0, A1, A2};
 
-  // The RGB LED object
-  RGBLed eyes;
+  EyePwm eyes;
 
-  static constexpr int CROSS_FADE_STEPS{100};
+  using Keyframe = EyeAnimation::Keyframe;
 
-  // RGB values for the various eye colours
-  struct EyeColourRgbValues
-  {
-    static constexpr std::array<int, 3> OFF{0, 0, 0};
-    static constexpr std::array<int, 3> RED{255, 0, 0};
-    static constexpr std::array<int, 3> GREEN{0, 255, 0};
-    static constexpr std::array<int, 3> BLUE{0, 0, 255};
-    static constexpr std::array<int, 3> LIGHT_BLUE{173, 216, 255};
-  };
+  static constexpr size_t MAX_QUEUED_KEYFRAMES{16};
+  std::array<Keyframe, MAX_QUEUED_KEYFRAMES> keyframes{};
+  size_t keyframeHead{0};
+  size_t numberOfKeyframes{0};
+
+  // Playback state of the keyframe at the head of the queue
+  bool keyframeStarted{false};
+  uint32_t keyframeStartMs{0};
 
-  static std::array<int, 3> rgbValueFromEyeColour(Colour colour);
+  void queue(Keyframe keyframe);
+  void popKeyframe();
 };
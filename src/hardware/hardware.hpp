@@ -2,6 +2,7 @@
 #include "eyes.hpp"
 #include "joints.hpp"
 #include "sonarArray.hpp"
+#include "storage.hpp"
 #include "switch.hpp"
 
 /**
@@ -14,4 +15,5 @@ struct Hardware
   Joints joints;
   SonarArray sonarArray;
   Switch modeSwitch;
+  Storage storage;
 };
\ No newline at end of file
@@ -1,8 +1,23 @@
 #include "joints.hpp"
 #include "logging/log.hpp"
+#include "profiling/profiler.hpp"
 #include <algorithm>
 
-Joints::Joints() : angleToDutyLinearCycleMap(ANGLE_TO_DUTY_CYCLE_PARAMS)
+// constexpr ensures the tables are generated at compile time (and so live in
+// flash rather than being built at start up)
+constexpr std::array<Joints::DutyCycleTable, Joints::NUMBER_OF_CHANNELS>
+    Joints::DUTY_CYCLE_TABLES{
+        // Name::waist
+        Joints::makeDutyCycleTable(WAIST_LIMITS, WAIST_ZERO_OFFSET, 1, 2),
+        // Name::right_shoulder
+        Joints::makeDutyCycleTable(
+            RIGHT_SHOULDER_LIMITS, RIGHT_SHOULDER_ZERO_OFFSET, -1, 1),
+        // Name::left_shoulder
+        Joints::makeDutyCycleTable(
+            LEFT_SHOULDER_LIMITS, LEFT_SHOULDER_ZERO_OFFSET, 1, 0),
+    };
+
+Joints::Joints() : pwmDriverBoard(PWM_DRIVER_I2C_ADDRESS, Wire)
 {
   // Configure servo driver board
   this->pwmDriverBoard.begin();
@@ -23,55 +38,130 @@ Joints::Joints() : angleToDutyLinearCycleMap(ANGLE_TO_DUTY_CYCLE_PARAMS)
 
 void Joints::setAngle(Name name, int angle)
 {
-  Limits limits = Joints::getLimits(name);
+  PROFILE_STAGE("joints.setAngle");
+  this->storeAngle(name, angle);
+  uint8_t channel = Joints::dutyCycleTable(name).channel;
+  uint16_t dutyCycle = Joints::getDutyCycle(name, angle);
+  if (dutyCycle == this->dutyCycles.at(channel))
+  {
+    return;
+  }
 
-  // Check if the angle is within the allowable hardware limits. If not, clamp
-  // the angle and log a warning - don't fail silently
-  if (angle < limits.minAngle || angle > limits.maxAngle)
+  this->dutyCycles.at(channel) = dutyCycle;
+  this->pwmDriverBoard.setPWM(channel, PULSE_SIGNAL_START, dutyCycle);
+
+  // setPWM writes the register address followed by the four channel registers
+  this->busStatistics.transactions++;
+  this->busStatistics.bytes += 1 + REGISTERS_PER_CHANNEL;
+}
+
+void Joints::setAngles(Angles angles)
+{
+  this->storeAngle(Name::waist, angles.waist);
+  this->storeAngle(Name::left_shoulder, angles.leftShoulder);
+  this->storeAngle(Name::right_shoulder, angles.rightShoulder);
+
+  std::array<uint16_t, NUMBER_OF_CHANNELS> dutyCycles{};
+  dutyCycles.at(Joints::dutyCycleTable(Name::waist).channel) =
+      Joints::getDutyCycle(Name::waist, angles.waist);
+  dutyCycles.at(Joints::dutyCycleTable(Name::left_shoulder).channel) =
+      Joints::getDutyCycle(Name::left_shoulder, angles.leftShoulder);
+  dutyCycles.at(Joints::dutyCycleTable(Name::right_shoulder).channel) =
+      Joints::getDutyCycle(Name::right_shoulder, angles.rightShoulder);
+
+  // Find the span of channels that need to change. Unchanged channels inside
+  // the span are rewritten with their current value, which is cheaper than a
+  // second transaction
+  int firstChannel = -1;
+  int lastChannel = -1;
+  for (int channel = 0; channel < NUMBER_OF_CHANNELS; channel++)
   {
-    int angleRequest = angle;
-    angle = std::clamp(angleRequest, limits.minAngle, limits.maxAngle);
+    if (dutyCycles.at(channel) != this->dutyCycles.at(channel))
+    {
+      firstChannel = firstChannel < 0 ? channel : firstChannel;
+      lastChannel = channel;
+    }
+  }
+  if (firstChannel < 0)
+  {
+    return;
+  }
 
-    LOG_WARN("Attempted to set an angle: %d, which is out of bound [%d, %d] - "
-             "Clamping angle at: %d",
-             angleRequest,
-             limits.minAngle,
-             limits.maxAngle,
-             angle);
+  // The servo driver board auto-increments the register address after each
+  // byte, so the registers of consecutive channels can be written in one burst
+  Wire.beginTransmission(PWM_DRIVER_I2C_ADDRESS);
+  Wire.write(static_cast<uint8_t>(LED0_ON_L_REGISTER +
+                                  REGISTERS_PER_CHANNEL * firstChannel));
+  for (int channel = firstChannel; channel <= lastChannel; channel++)
+  {
+    uint16_t dutyCycle = dutyCycles.at(channel);
+    Wire.write(static_cast<uint8_t>(PULSE_SIGNAL_START & 0xFF));
+    Wire.write(static_cast<uint8_t>(PULSE_SIGNAL_START >> 8));
+    Wire.write(static_cast<uint8_t>(dutyCycle & 0xFF));
+    Wire.write(static_cast<uint8_t>(dutyCycle >> 8));
+    this->dutyCycles.at(channel) = dutyCycle;
   }
+  Wire.endTransmission();
+
+  this->busStatistics.transactions++;
+  this->busStatistics.bytes +=
+      1 + REGISTERS_PER_CHANNEL * (lastChannel - firstChannel + 1);
+}
 
-  int offsetAngle = Joints::accountForZeroOffset(name, angle);
-  uint32_t servoNumber = Joints::servoNumber(name);
-  auto dutyCycle =
-      static_cast<uint32_t>(this->angleToDutyLinearCycleMap.getOutput(
-          static_cast<float>(offsetAngle)));
-  this->pwmDriverBoard.setPWM(servoNumber, PULSE_SIGNAL_START, dutyCycle);
+Joints::Angles Joints::getAngles() const
+{
+  return this->angles;
+}
+
+Joints::BusStatistics Joints::getBusStatistics() const
+{
+  return this->busStatistics;
 }
 
-int Joints::accountForZeroOffset(Name name, int angle)
+void Joints::storeAngle(Name name, int angle)
 {
+  Limits limits = Joints::getLimits(name);
+  angle = std::clamp(angle, limits.minAngle, limits.maxAngle);
   switch (name)
   {
     case Name::waist:
-      return WAIST_ZERO_OFFSET + angle;
+      this->angles.waist = angle;
+      break;
     case Name::left_shoulder:
-      return LEFT_SHOULDER_ZERO_OFFSET + angle;
+      this->angles.leftShoulder = angle;
+      break;
     case Name::right_shoulder:
-      return RIGHT_SHOULDER_ZERO_OFFSET - angle;
+      this->angles.rightShoulder = angle;
+      break;
   }
 }
 
-Joints::Limits Joints::getLimits(Name name)
+Joints::DutyCycleTable const& Joints::dutyCycleTable(Name name)
 {
-  switch (name)
+  return DUTY_CYCLE_TABLES.at(static_cast<size_t>(name));
+}
+
+uint16_t Joints::getDutyCycle(Name name, int angle)
+{
+  DutyCycleTable const& table = Joints::dutyCycleTable(name);
+  Limits limits = table.limits;
+
+  // Check if the angle is within the allowable hardware limits. If not, clamp
+  // the angle and log a warning - don't fail silently
+  if (angle < limits.minAngle || angle > limits.maxAngle)
   {
-    case Name::waist:
-      return WAIST_LIMITS;
-    case Name::right_shoulder:
-      return RIGHT_SHOULDER_LIMITS;
-    case Name::left_shoulder:
-      return LEFT_SHOULDER_LIMITS;
+    int angleRequest = angle;
+    angle = std::clamp(angleRequest, limits.minAngle, limits.maxAngle);
+
+    LOG_WARN("Attempted to set an angle: %d, which is out of bound [%d, %d] - "
+             "Clamping angle at: %d",
+             angleRequest,
+             limits.minAngle,
+             limits.maxAngle,
+             angle);
   }
+
+  return table.dutyCycles.at(static_cast<size_t>(angle - limits.minAngle));
 }
 
 int Joints::getLimitsRange(Name name)
@@ -80,20 +170,7 @@ int Joints::getLimitsRange(Name name)
   return limits.maxAngle - limits.minAngle;
 }
 
-uint8_t Joints::servoNumber(Name name)
-{
-  switch (name)
-  {
-    case Name::left_shoulder:
-      return 0;
-    case Name::right_shoulder:
-      return 1;
-    case Name::waist:
-      return 2;
-  }
-}
-
-std::string Joints::toString(Name name)
+std::string_view Joints::toString(Name name)
 {
   switch (name)
   {
@@ -2,7 +2,8 @@
 #include "control/linearMap.hpp"
 #include <Adafruit_PWMServoDriver.h>
 
-#include <string>
+#include <array>
+#include <string_view>
 
 /**
  * @brief Represents and encapsulates the three joints of the robot: Waist,
@@ -11,8 +12,17 @@
  * Abstracts away the underlying actuation mechanism (servo motor) and only
  * exposes a method for setting the joint angle
  *
- * Underlying Library: Uses the Adafruit_PWMServoDriver library to control the
- * servo motors
+ * Angles are converted to duty cycles with per-joint lookup tables that are
+ * generated at compile time from the servo parameters and the joint zero
+ * offsets, so setting an angle is a bounds check and a table load.
+ *
+ * The duty cycle last written to each servo channel is cached, and writes that
+ * wouldn't change it are skipped. setAngles updates all three joints in a
+ * single I2C transaction using the PCA9685 register auto-increment
+ *
+ * Underlying Library: Uses the Adafruit_PWMServoDriver library to configure
+ * the servo driver board and to control single servo motors. Batched writes go
+ * straight to the I2C bus (Wire)
  *
  */
 class Joints
@@ -31,18 +41,76 @@ class Joints
     left_shoulder
   };
 
+  struct Angles
+  {
+    int waist;
+    int leftShoulder;
+    int rightShoulder;
+  };
+
+  // I2C bus usage, used to quantify the cost of the joint writes
+  struct BusStatistics
+  {
+    uint32_t transactions{0};
+    uint32_t bytes{0};
+  };
+
   Joints();
 
   void setAngle(Name name, int angle);
-  static Limits getLimits(Name name);
+
+  /**
+   * @brief Set the angle of all three joints in a single I2C transaction.
+   * Joints whose duty cycle would not change are not written to
+   *
+   * @param angles
+   */
+  void setAngles(Angles angles);
+
+  /**
+   * @brief Get the angles last set (clamped to the joint limits), i.e. where
+   * the joints are headed
+   *
+   */
+  [[nodiscard]] Angles getAngles() const;
+
+  [[nodiscard]] BusStatistics getBusStatistics() const;
+
+  /**
+   * @brief The duty cycle setAngle writes for an angle: a bounds check and a
+   * table load. Out of bounds angles are clamped, with a warning
+   *
+   */
+  static uint16_t getDutyCycle(Name name, int angle);
+
+  static constexpr Limits getLimits(Name name)
+  {
+    switch (name)
+    {
+      case Name::waist:
+        return WAIST_LIMITS;
+      case Name::right_shoulder:
+        return RIGHT_SHOULDER_LIMITS;
+      case Name::left_shoulder:
+        return LEFT_SHOULDER_LIMITS;
+    }
+    return WAIST_LIMITS;
+  }
   static int getLimitsRange(Name name);
-  static std::string toString(Name name);
+  static std::string_view toString(Name name);
 
  private:
   static constexpr uint32_t PULSE_SIGNAL_START{0};
   static constexpr uint32_t PWM_FREQUENCY_HZ{50};
   static constexpr uint32_t OSCILLATOR_FREQUENCY_HZ{25000000};
 
+  // PCA9685 register map. Each channel has four consecutive registers (ON_L,
+  // ON_H, OFF_L, OFF_H) starting at LED0_ON_L
+  static constexpr uint8_t PWM_DRIVER_I2C_ADDRESS{0x40};
+  static constexpr uint8_t LED0_ON_L_REGISTER{0x06};
+  static constexpr uint8_t REGISTERS_PER_CHANNEL{4};
+  static constexpr uint8_t NUMBER_OF_CHANNELS{3};
+
   // These parameters are hardware specific and define the angles required for
   // each joint to be in the kinematic zero position. The zero position is
   // defined as:
@@ -76,12 +144,60 @@ class Joints
       .outputMax = 450, // Max duty cycle
   };
 
-  LinearMap angleToDutyLinearCycleMap;
+  // Angle -> duty cycle lookup table for a single joint, indexed by
+  // (angle - limits.minAngle). Tables are sized for the largest joint range
+  static constexpr size_t DUTY_CYCLE_TABLE_SIZE{181};
+
+  struct DutyCycleTable
+  {
+    Limits limits;
+    uint8_t channel;
+    std::array<uint16_t, DUTY_CYCLE_TABLE_SIZE> dutyCycles;
+  };
+
+  /**
+   * @brief Generate the lookup table of a joint
+   *
+   * @param limits - the joint limits, the range covered by the table
+   * @param zeroOffset - the servo angle at the joint's kinematic zero position
+   * @param direction - +1 if the servo angle increases with the joint angle,
+   * -1 if it decreases
+   * @param channel - the servo driver board channel the joint is wired to
+   */
+  static constexpr DutyCycleTable makeDutyCycleTable(Limits limits,
+                                                     int zeroOffset,
+                                                     int direction,
+                                                     uint8_t channel)
+  {
+    LinearMap angleToDutyCycle(ANGLE_TO_DUTY_CYCLE_PARAMS);
+    DutyCycleTable table{.limits = limits, .channel = channel, .dutyCycles{}};
+    for (int angle = limits.minAngle; angle <= limits.maxAngle; angle++)
+    {
+      int servoAngle = zeroOffset + direction * angle;
+      table.dutyCycles.at(static_cast<size_t>(angle - limits.minAngle)) =
+          static_cast<uint16_t>(
+              angleToDutyCycle.getOutput(static_cast<float>(servoAngle)));
+    }
+    return table;
+  }
+
+  // One table per joint, indexed by Name
+  static std::array<DutyCycleTable, NUMBER_OF_CHANNELS> const
+      DUTY_CYCLE_TABLES;
 
   // Used to control up to 16 servo motors
   Adafruit_PWMServoDriver pwmDriverBoard;
 
+  // Duty cycle last written to each servo channel. Zero (never a valid duty
+  // cycle) forces the first write
+  std::array<uint16_t, NUMBER_OF_CHANNELS> dutyCycles{};
+
+  // Angle last set on each joint
+  Angles angles{};
+
+  BusStatistics busStatistics;
+
   // Helper functions
-  static uint8_t servoNumber(Name name);
-  static int accountForZeroOffset(Name name, int angle);
+  static DutyCycleTable const& dutyCycleTable(Name name);
+  void storeAngle(Name name, int angle);
 };
@@ -1,33 +1,145 @@
 #include "sonarArray.hpp"
 #include "Arduino.h"
 #include "logging/log.hpp"
+#include "profiling/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+SonarArray::EdgeBuffer SonarArray::rightEchoEdges;
+SonarArray::EdgeBuffer SonarArray::leftEchoEdges;
 
 SonarArray::SonarArray()
 {
   // Set up the pins
-  pinMode(this->rightSensor.triggerPin, OUTPUT);
-  pinMode(this->rightSensor.echoPin, INPUT);
-  pinMode(this->leftSensor.triggerPin, OUTPUT);
-  pinMode(this->leftSensor.echoPin, INPUT);
+  pinMode(RIGHT_SENSOR.triggerPin, OUTPUT);
+  pinMode(RIGHT_SENSOR.echoPin, INPUT);
+  pinMode(LEFT_SENSOR.triggerPin, OUTPUT);
+  pinMode(LEFT_SENSOR.echoPin, INPUT);
+
+  // Timestamp both edges of each echo pulse
+  attachInterrupt(digitalPinToInterrupt(RIGHT_SENSOR.echoPin),
+                  SonarArray::onRightEcho,
+                  CHANGE);
+  attachInterrupt(digitalPinToInterrupt(LEFT_SENSOR.echoPin),
+                  SonarArray::onLeftEcho,
+                  CHANGE);
 }
 
-SonarArray::Distance SonarArray::getDistance()
+void SonarArray::update()
 {
+  PROFILE_STAGE("sonar.update");
+  uint32_t nowUs = micros();
+
+  if (this->pingInFlight)
+  {
+    bool echoCollected =
+        this->pingingRightSensor
+            ? this->collectEcho(rightEchoEdges,
+                                this->rightFilter,
+                                this->distanceFromRightSensor,
+                                nowUs)
+            : this->collectEcho(leftEchoEdges,
+                                this->leftFilter,
+                                this->distanceFromLeftSensor,
+                                nowUs);
+    if (!echoCollected)
+    {
+      return;
+    }
+  }
+
+  // Leave enough time between pings to prevent interference between the two
+  // sensors
+  if (nowUs - this->pingTriggeredUs < PING_INTERVAL_US)
+  {
+    return;
+  }
 
-  float distanceFromRightSensor = getDistanceFromSensor(this->rightSensor);
+  // Ping the other sensor
+  this->pingingRightSensor = !this->pingingRightSensor;
+  EdgeBuffer& edges =
+      this->pingingRightSensor ? rightEchoEdges : leftEchoEdges;
+  SonarArray::discardEdges(edges);
+  SonarArray::trigger(this->pingingRightSensor ? RIGHT_SENSOR : LEFT_SENSOR);
+  this->pingTriggeredUs = nowUs;
+  this->pingInFlight = true;
+  this->echoRiseSeen = false;
+}
+
+SonarArray::Distance SonarArray::getDistance() const
+{
+  PROFILE_STAGE("sonar.getDistance");
+  float min = std::min(this->distanceFromRightSensor.distance,
+                       this->distanceFromLeftSensor.distance);
 
-  delay(30); // Delay to prevent interference between the two sensors
+  return {.right = this->distanceFromRightSensor.distance,
+          .left = this->distanceFromLeftSensor.distance,
+          .min = min,
+          .valid = this->distanceFromRightSensor.valid &&
+                   this->distanceFromLeftSensor.valid};
+}
 
-  float distanceFromLeftSensor = getDistanceFromSensor(this->leftSensor);
+void SonarArray::setProximityAlarm(float distanceCm, CancellationToken& token)
+{
+  this->proximityAlarmCm = distanceCm;
+  this->proximityAlarm = &token;
+}
+
+void SonarArray::checkProximity(float echoDistance)
+{
+  if (this->proximityAlarm == nullptr)
+  {
+    return;
+  }
+  this->closeEchoes =
+      echoDistance < this->proximityAlarmCm ? this->closeEchoes + 1 : 0;
+  if (this->closeEchoes >= PROXIMITY_ALARM_ECHOES)
+  {
+    this->proximityAlarm->cancel();
+  }
+}
+
+bool SonarArray::collectEcho(EdgeBuffer& edges,
+                             Filter& filter,
+                             Filter::Output& distance,
+                             uint32_t nowUs)
+{
+  // Essentially we are measuring the time it takes for sound wave to hit an
+  // object and bounce back, which is the width of the echo pulse
+  Edge edge{};
+  while (edges.pop(edge))
+  {
+    if (edge.rising)
+    {
+      this->echoRiseSeen = true;
+      this->echoRiseUs = edge.timestampUs;
+    }
+    else if (this->echoRiseSeen)
+    {
+      float echoDistance =
+          SonarArray::echoTimeToDistance(edge.timestampUs - this->echoRiseUs);
+      this->checkProximity(echoDistance);
+      distance = filter.update(echoDistance);
+      this->pingInFlight = false;
+      return true;
+    }
+  }
 
-  float min = std::min(distanceFromRightSensor, distanceFromLeftSensor);
+  // No (complete) echo - measure zero, which is the safe assumption that an
+  // object is right in front of the robot. The filter decides whether this is
+  // a one-off dropout or a real measurement
+  if (nowUs - this->pingTriggeredUs >= ECHO_TIMEOUT_US)
+  {
+    this->closeEchoes = 0;
+    distance = filter.update(0);
+    this->pingInFlight = false;
+    return true;
+  }
 
-  return {.right = distanceFromRightSensor,
-          .left = distanceFromLeftSensor,
-          .min = min};
+  return false;
 }
 
-float SonarArray::getDistanceFromSensor(Hcsr04SensorPins sensor)
+void SonarArray::trigger(Hcsr04SensorPins sensor)
 {
   // This article explains what is going on here better than I can in a few
   // comments - give is a squiz if you're interested in the details:
@@ -39,23 +151,65 @@ float SonarArray::getDistanceFromSensor(Hcsr04SensorPins sensor)
   digitalWrite(sensor.triggerPin, HIGH);
   delayMicroseconds(10);
   digitalWrite(sensor.triggerPin, LOW);
+}
 
-  // Essentially we are measuring the time it takes for sound wave to hit an
-  // object and bounce back
-  auto timeForWaveToBounceAndReflectUs =
-      static_cast<float>(pulseIn(sensor.echoPin, HIGH));
+void SonarArray::discardEdges(EdgeBuffer& edges)
+{
+  Edge edge{};
+  while (edges.pop(edge))
+  {
+  }
+}
 
-  float timeForWaveToTravelOneWayS =
-      timeForWaveToBounceAndReflectUs / 2 * MICROSECONDS_TO_SECONDS;
+void SonarArray::onRightEcho()
+{
+  rightEchoEdges.push({.timestampUs = micros(),
+                       .rising = digitalRead(RIGHT_SENSOR.echoPin) == HIGH});
+}
 
-  // Distance = time * speed of sound
-  float distanceToObjectCm = timeForWaveToTravelOneWayS * SPEED_OF_SOUND;
+void SonarArray::onLeftEcho()
+{
+  leftEchoEdges.push({.timestampUs = micros(),
+                      .rising = digitalRead(LEFT_SENSOR.echoPin) == HIGH});
+}
+
+SonarArray::Position SonarArray::getPosition(Distance const& distance)
+{
+  if (distance.right <= 0 || distance.left <= 0)
+  {
+    return {.bearingDeg = 0, .rangeCm = 0};
+  }
+
+  float bearing = std::atan((distance.left - distance.right) /
+                            ((distance.left + distance.right) *
+                             std::tan(SENSOR_HALF_ANGLE_RAD)));
 
-  return distanceToObjectCm;
+  // Both sensors' estimates of the range, averaged
+  float rangeCm =
+      (distance.right * std::cos(bearing - SENSOR_HALF_ANGLE_RAD) +
+       distance.left * std::cos(bearing + SENSOR_HALF_ANGLE_RAD)) /
+      2;
+  return {.bearingDeg = bearing * RADIANS_TO_DEGREES, .rangeCm = rangeCm};
+}
+
+SonarArray::Distance SonarArray::positionToDistance(Position position)
+{
+  float bearing =
+      std::clamp(position.bearingDeg, -MAX_BEARING_DEG, MAX_BEARING_DEG) /
+      RADIANS_TO_DEGREES;
+  float right = position.rangeCm / std::cos(bearing - SENSOR_HALF_ANGLE_RAD);
+  float left = position.rangeCm / std::cos(bearing + SENSOR_HALF_ANGLE_RAD);
+  return {.right = right,
+          .left = left,
+          .min = std::min(right, left),
+          .valid = position.rangeCm > 0};
 }
 
-std::string SonarArray::Distance::toString() const
+FormattedMessage<> SonarArray::Distance::toString() const
 {
-  return format(
-      "Right: %.0f, Left: %.0f Min: %.0f", this->right, this->left, this->min);
+  return format("Right: %.0f, Left: %.0f Min: %.0f Valid: %d",
+                this->right,
+                this->left,
+                this->min,
+                this->valid);
 }
@@ -1,5 +1,9 @@
 #pragma once
-#include <string>
+#include "control/distanceFilter.hpp"
+#include "logging/format.hpp"
+#include "utilities/cancellationToken.hpp"
+#include "utilities/spscRingBuffer.hpp"
+#include <cstdint>
 
 /**
  * @brief Represents and encapsulates two HC-SR04 two sonar sensors which
@@ -7,12 +11,34 @@
  * the robot, at an angle of 15 degrees apart. Each sensors measures the
  * distance to the nearest object in front of it. These two distances can be
  * combined to determine whether the closest object is to the left, right or
- * straight ahead.
+ * straight ahead. The right sensor points towards positive waist angles.
+ * Taking the object to be a surface square to the line of sight (e.g. a
+ * person facing the robot), each sensor measures the distance to it along its
+ * own axis, so the object's bearing follows from the two distances (see
+ * getPosition).
  *
  * Abstracts away the underlying GPIO ineraction
  *
- * Underlying Library: Uses the digital_wiring library to read the state of the
- * two HC-SR04 ultrasonic sensors.
+ * The echo pins are captured with edge interrupts: each interrupt timestamps
+ * the edge into a small lock-free buffer and returns. The two sensors are
+ * pinged alternately, one per call to the update method, and a sensor is only
+ * pinged once the other sensor's echo has completed so that the sensors never
+ * hear each other's ping. The update method is expected to be called
+ * periodically (from the sensing task) and never waits for an echo. The
+ * getDistance method returns the latest completed measurements
+ *
+ * Each sensor's measurements are passed through a DistanceFilter (median,
+ * outlier gate, exponential smoothing) which removes the dropouts and
+ * multipath spikes the HC-SR04 is prone to. A distance is only flagged as
+ * valid when both filters trust their output
+ *
+ * The filters take a few measurements to follow a sudden change, which is too
+ * slow for someone stepping right up to the robot. A proximity alarm (see
+ * setProximityAlarm) is raised on the raw echo instead, as soon as it comes
+ * back
+ *
+ * Underlying Library: Uses the digital_wiring library to trigger the two
+ * HC-SR04 ultrasonic sensors and to attach the echo pin interrupts.
  *
  */
 class SonarArray
@@ -23,11 +49,96 @@ class SonarArray
     float right;
     float left;
     float min;
-    [[nodiscard]] std::string toString() const;
+    bool valid;
+    [[nodiscard]] FormattedMessage<> toString() const;
+  };
+
+  // Where an object is, from straight ahead of the sensors
+  struct Position
+  {
+    // Positive towards the right sensor
+    float bearingDeg;
+    float rangeCm;
   };
 
+  // Angle between the two sensors' axes
+  static constexpr float SENSOR_ANGLE_DEG{15};
+
+  // Furthest bearing positionToDistance places an object at. Beyond it, the
+  // axis of the sensor on the other side is nearly parallel to the object
+  static constexpr float MAX_BEARING_DEG{90 - SENSOR_ANGLE_DEG};
+
+  // Filter configuration. At one measurement per sensor every ~60ms, the
+  // median window covers ~300ms of history
+  static constexpr size_t MEDIAN_WINDOW_SIZE{5};
+  using Filter = DistanceFilter<MEDIAN_WINDOW_SIZE>;
+  static constexpr Filter::Params FILTER_PARAMS{
+      .outlierGate = {.maxDelta = 30, .maxConsecutiveRejections = 3},
+      .smoothingFactor = 0.5F};
+
   SonarArray();
-  Distance getDistance();
+
+  /**
+   * @brief Collect the echo of the sensor in flight and, once it has
+   * completed, ping the next sensor in turn
+   *
+   */
+  void update();
+
+  /**
+   * @brief Get the latest (filtered) distance measured by each sensor
+   *
+   * @return Distance
+   */
+  [[nodiscard]] Distance getDistance() const;
+
+  /**
+   * @brief Cancel a token whenever PROXIMITY_ALARM_ECHOES echoes in a row
+   * (from either sensor, before filtering) put an object closer than a
+   * distance. A missing echo doesn't raise the alarm, the filters deal with
+   * those
+   *
+   * @param distanceCm - the alarm distance
+   * @param token - the token to cancel, must outlive the sonar array
+   */
+  void setProximityAlarm(float distanceCm, CancellationToken& token);
+
+  /**
+   * @brief Position of an object from the distance each sensor measures to it
+   *
+   * The sensors' axes are at -+a = -+SENSOR_ANGLE_DEG / 2 from straight ahead.
+   * They meet an object at range r and bearing b, a surface square to the
+   * line of sight, at r / cos(b - a) (right) and r / cos(b + a) (left), so
+   *
+   *   tan(b) = (left - right) / ((left + right) * tan(a))
+   *
+   * @return Position - straight ahead at 0cm if either distance is missing
+   */
+  static Position getPosition(Distance const& distance);
+
+  /**
+   * @brief The distance each sensor measures to an object at a position, the
+   * inverse of getPosition
+   *
+   * @param position - its bearing is clamped to -+MAX_BEARING_DEG
+   */
+  static Distance positionToDistance(Position position);
+
+  /**
+   * @brief Convert the width of an echo pulse to a distance
+   *
+   * @param echoTimeUs - time the echo pin was high i.e. the time it takes the
+   * sound wave to hit an object and bounce back
+   * @return float - the distance to the object in cm
+   */
+  static constexpr float echoTimeToDistance(uint32_t echoTimeUs)
+  {
+    float timeForWaveToTravelOneWayS =
+        static_cast<float>(echoTimeUs) / 2 * MICROSECONDS_TO_SECONDS;
+
+    // Distance = time * speed of sound
+    return timeForWaveToTravelOneWayS * SPEED_OF_SOUND * METERS_TO_CM;
+  }
 
  private:
   struct Hcsr04SensorPins
@@ -37,13 +148,74 @@ class SonarArray
   };
 
   // Hardware specific pin configuration
-  Hcsr04SensorPins rightSensor{.triggerPin = 7, .echoPin = 11};
-  Hcsr04SensorPins leftSensor{.triggerPin = 16, .echoPin = 15};
+  static constexpr Hcsr04SensorPins RIGHT_SENSOR{.triggerPin = 7,
+                                                 .echoPin = 11};
+  static constexpr Hcsr04SensorPins LEFT_SENSOR{.triggerPin = 16,
+                                                .echoPin = 15};
 
   // Physics constants
   static constexpr float METERS_TO_CM{100.0F};
   static constexpr float SPEED_OF_SOUND{343.0F};
   static constexpr float MICROSECONDS_TO_SECONDS{1 / 1000000.0F};
+  static constexpr float RADIANS_TO_DEGREES{180 / 3.14159265F};
+
+  // Angle between each sensor's axis and straight ahead
+  static constexpr float SENSOR_HALF_ANGLE_RAD{SENSOR_ANGLE_DEG / 2 /
+                                               RADIANS_TO_DEGREES};
+
+  // The HC-SR04 holds its echo pin high for at most ~38ms when nothing is in
+  // range. If the echo hasn't completed within this time of the trigger, the
+  // ping is abandoned
+  static constexpr uint32_t ECHO_TIMEOUT_US{40000};
+
+  // Minimum time between two consecutive pings (of either sensor) to prevent
+  // interference between the two sensors
+  static constexpr uint32_t PING_INTERVAL_US{30000};
+
+  // An echo pin edge, timestamped in the interrupt handler
+  struct Edge
+  {
+    uint32_t timestampUs;
+    bool rising;
+  };
+
+  using EdgeBuffer = SpscRingBuffer<Edge, 8>;
+
+  // The edge buffers are filled by the interrupt handlers, which can't carry a
+  // pointer to the object, hence they are static
+  static EdgeBuffer rightEchoEdges;
+  static EdgeBuffer leftEchoEdges;
+  static void onRightEcho();
+  static void onLeftEcho();
+
+  Filter rightFilter{FILTER_PARAMS};
+  Filter leftFilter{FILTER_PARAMS};
+
+  // Latest filtered measurements. Initialised to zero and invalid i.e. we
+  // assume an object is right in front of the robot until the sensors tell us
+  // otherwise
+  Filter::Output distanceFromRightSensor{.distance = 0, .valid = false};
+  Filter::Output distanceFromLeftSensor{.distance = 0, .valid = false};
+
+  // A single short echo may be a stray reflection, two in a row (one ping
+  // interval apart) are taken as an object
+  static constexpr uint32_t PROXIMITY_ALARM_ECHOES{2};
+  float proximityAlarmCm{0};
+  CancellationToken* proximityAlarm{nullptr};
+  uint32_t closeEchoes{0};
+
+  // The ping currently in flight
+  bool pingInFlight{false};
+  bool pingingRightSensor{false};
+  uint32_t pingTriggeredUs{0};
+  bool echoRiseSeen{false};
+  uint32_t echoRiseUs{0};
 
-  static float getDistanceFromSensor(Hcsr04SensorPins sensor);
-};
\ No newline at end of file
+  bool collectEcho(EdgeBuffer& edges,
+                   Filter& filter,
+                   Filter::Output& distance,
+                   uint32_t nowUs);
+  void checkProximity(float echoDistance);
+  static void trigger(Hcsr04SensorPins sensor);
+  static void discardEdges(EdgeBuffer& edges);
+};
@@ -0,0 +1,78 @@
+#include "storage.hpp"
+#include "logging/log.hpp"
+#include "utilities/heapGuard.hpp"
+#include <Adafruit_LittleFS.h>
+#include <InternalFileSystem.h>
+
+using Adafruit_LittleFS_Namespace::File;
+using Adafruit_LittleFS_Namespace::FILE_O_READ;
+using Adafruit_LittleFS_Namespace::FILE_O_WRITE;
+
+Storage::Storage() : mounted(InternalFS.begin())
+{
+  if (!this->mounted)
+  {
+    LOG_WARN("%s", "Unable to mount the internal file system");
+  }
+}
+
+bool Storage::erase(char const* name)
+{
+  HeapGuard::Exemption exemption;
+  return this->mounted && InternalFS.remove(name);
+}
+
+bool Storage::read(char const* name, void* data, size_t size)
+{
+  if (!this->mounted)
+  {
+    return false;
+  }
+
+  // LittleFS allocates the file while it is open
+  HeapGuard::Exemption exemption;
+  File file(InternalFS);
+  if (!file.open(name, FILE_O_READ))
+  {
+    return false;
+  }
+
+  // One byte more than the record, so a longer (older or newer) record
+  // doesn't load either
+  uint8_t extra = 0;
+  bool complete =
+      file.read(data, static_cast<uint16_t>(size)) == static_cast<int>(size) &&
+      file.read(&extra, 1) <= 0;
+  file.close();
+  return complete;
+}
+
+bool Storage::write(char const* name, void const* data, size_t size)
+{
+  if (!this->mounted)
+  {
+    return false;
+  }
+
+  // LittleFS allocates the file while it is open
+  HeapGuard::Exemption exemption;
+
+  // Opening a file for writing appends to it, so replace it
+  InternalFS.remove(name);
+
+  File file(InternalFS);
+  if (!file.open(name, FILE_O_WRITE))
+  {
+    LOG_WARN("Unable to open %s for writing", name);
+    return false;
+  }
+
+  bool complete =
+      file.write(static_cast<uint8_t const*>(data), size) == size;
+  file.close();
+  if (!complete)
+  {
+    LOG_WARN("Unable to write %s", name);
+  }
+  return complete;
+}
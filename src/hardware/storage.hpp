@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Persists small records (e.g. tuned gains) across power cycles
+ *
+ * Each record is a file in the nRF52's internal flash file system, holding the
+ * raw bytes of a trivially copyable struct. A record only loads if its size
+ * matches, so records should carry a version field that is bumped whenever
+ * their layout changes.
+ *
+ * Flash writes take milliseconds and wear the flash, so save records rarely
+ * (e.g. once a tuning run has finished), never every cycle.
+ *
+ * LittleFS allocates each file while it is open and frees it on close, so
+ * the calls are exempt from the HeapGuard.
+ *
+ * Underlying Library: Uses the Adafruit LittleFS library (InternalFS)
+ *
+ */
+class Storage
+{
+ public:
+  Storage();
+
+  template <typename Record> bool load(char const* name, Record& record)
+  {
+    static_assert(std::is_trivially_copyable_v<Record>,
+                  "Storage records must be trivially copyable");
+    return this->read(name, &record, sizeof(Record));
+  }
+
+  template <typename Record> bool save(char const* name, Record const& record)
+  {
+    static_assert(std::is_trivially_copyable_v<Record>,
+                  "Storage records must be trivially copyable");
+    return this->write(name, &record, sizeof(Record));
+  }
+
+  /**
+   * @brief Remove a record
+   *
+   */
+  bool erase(char const* name);
+
+ private:
+  bool mounted{false};
+
+  bool read(char const* name, void* data, size_t size);
+  bool write(char const* name, void const* data, size_t size);
+};
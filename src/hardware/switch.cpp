@@ -1,16 +1,88 @@
 #include "switch.hpp"
+#include "logging/log.hpp"
+
+Switch::EdgeBuffer Switch::edges;
 
 Switch::Switch()
 {
-  pinMode(this->switchPin, INPUT_PULLDOWN);
+  pinMode(SWITCH_PIN, INPUT_PULLDOWN);
+  this->level = digitalRead(SWITCH_PIN) == HIGH;
+  this->state = Switch::stateFromLevel(this->level);
+  this->events.push({.state = this->state, .firstEdgeUs = micros()});
+
+  attachInterrupt(digitalPinToInterrupt(SWITCH_PIN), Switch::onEdge, CHANGE);
+}
+
+void Switch::update()
+{
+  uint32_t nowUs = micros();
+
+  Edge edge{};
+  while (Switch::edges.pop(edge))
+  {
+    this->addEdge(edge);
+  }
+
+  // Edges the buffer had no room for
+  bool high = digitalRead(SWITCH_PIN) == HIGH;
+  if (high != this->level)
+  {
+    this->addEdge({.timestampUs = nowUs, .high = high});
+  }
+
+  if (!this->settling || nowUs - this->lastEdgeUs < DEBOUNCE_US)
+  {
+    return;
+  }
+  this->settling = false;
+
+  // A glitch settles back on the state we already had
+  State settledState = Switch::stateFromLevel(this->level);
+  if (settledState == this->state)
+  {
+    return;
+  }
+  this->state = settledState;
+  if (!this->events.push(
+          {.state = settledState, .firstEdgeUs = this->firstEdgeUs}))
+  {
+    LOG_WARN("%s", "Switch event queue full, event dropped");
+  }
+}
+
+bool Switch::popEvent(Event& event)
+{
+  return this->events.pop(event);
 }
 
 Switch::State Switch::getState() const
 {
-  return digitalRead(this->switchPin) == 0 ? State::off : State::on;
+  return this->state;
+}
+
+void Switch::addEdge(Edge edge)
+{
+  if (!this->settling)
+  {
+    this->settling = true;
+    this->firstEdgeUs = edge.timestampUs;
+  }
+  this->level = edge.high;
+  this->lastEdgeUs = edge.timestampUs;
+}
+
+Switch::State Switch::stateFromLevel(bool high)
+{
+  return high ? State::on : State::off;
+}
+
+void Switch::onEdge()
+{
+  Switch::edges.push(
+      {.timestampUs = micros(), .high = digitalRead(SWITCH_PIN) == HIGH});
 }
 
-std::string Switch::toString(State state)
+std::string_view Switch::toString(State state)
 {
   switch (state)
   {
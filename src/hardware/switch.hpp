@@ -1,14 +1,25 @@
 #pragma once
 #include "Arduino.h"
-#include <string>
+#include "utilities/spscRingBuffer.hpp"
+#include <cstdint>
+#include <string_view>
 
 /**
  * @brief Represents and encapsulates the physical state switch of the robot.
  *
  * Abstracts away the underlying GPIO ineraction
  *
+ * The switch pin is captured with an edge interrupt: each interrupt timestamps
+ * the edge into a small lock-free buffer and returns. The update method is
+ * expected to be called periodically (from the mode task). It debounces the
+ * edges in time: the switch only takes a new state once the contact has been
+ * quiet for DEBOUNCE_US, so the bouncing of a flip, or a glitch shorter than
+ * that, never reaches the application. Each change of the debounced state is
+ * posted as an Event into a lock-free queue, for the application to pick up
+ * with the popEvent method
+ *
  * Underlying Library: Uses the digital_wiring library to read the state of the
- * switch
+ * switch and to attach the pin interrupt
  *
  */
 
@@ -21,11 +32,72 @@ class Switch
     off
   };
 
+  // A change of the debounced state
+  struct Event
+  {
+    State state;
+    // When the contact started to move, i.e. the first edge of the bounces
+    uint32_t firstEdgeUs;
+  };
+
+  // How long the contact must be quiet for its level to be taken. Toggle
+  // switches typically bounce for a few milliseconds
+  static constexpr uint32_t DEBOUNCE_US{20000};
+
+  /**
+   * @brief Set up the pin and post the initial state as an event
+   *
+   */
   Switch();
 
+  /**
+   * @brief Collect the edges seen since the last call and, once the contact
+   * has settled, post the new state
+   *
+   */
+  void update();
+
+  /**
+   * @brief Get the oldest state change that hasn't been picked up yet
+   *
+   * @return true if there was one
+   */
+  bool popEvent(Event& event);
+
+  /**
+   * @brief Get the debounced state
+   *
+   */
   [[nodiscard]] State getState() const;
-  static std::string toString(State state);
+  static std::string_view toString(State state);
 
  private:
-  int switchPin{A3};
+  static constexpr int SWITCH_PIN{A3};
+
+  // A switch pin edge, timestamped in the interrupt handler
+  struct Edge
+  {
+    uint32_t timestampUs;
+    bool high;
+  };
+
+  // The edge buffer is filled by the interrupt handler, which can't carry a
+  // pointer to the object, hence it is static. A burst of bounces may overflow
+  // it, which the update method makes up for by reading the pin
+  using EdgeBuffer = SpscRingBuffer<Edge, 16>;
+  static EdgeBuffer edges;
+  static void onEdge();
+
+  SpscRingBuffer<Event, 4> events;
+
+  State state{State::off};
+
+  // The contact since the last debounced state
+  bool settling{false};
+  bool level{false};
+  uint32_t firstEdgeUs{0};
+  uint32_t lastEdgeUs{0};
+
+  void addEdge(Edge edge);
+  static State stateFromLevel(bool high);
 };
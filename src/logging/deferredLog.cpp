@@ -0,0 +1,97 @@
+#include "deferredLog.hpp"
+#include "serialManager.hpp"
+#include <cstring>
+
+DeferredLog& DeferredLog::getInstance()
+{
+  static DeferredLog deferredLog;
+  return deferredLog;
+}
+
+void DeferredLog::drain(size_t maxRecords)
+{
+  std::array<uint8_t, MAX_FRAME_SIZE> frame{};
+  Record record{};
+
+  // Only take a record once its frame is sure to fit in the serial TX buffer,
+  // so records wait here rather than being dropped by the SerialManager
+  SerialManager& serialManager = SerialManager::getInstance();
+  for (size_t i = 0; i < maxRecords &&
+                     serialManager.availableForWrite() >= MAX_FRAME_SIZE &&
+                     this->records.pop(record);
+       i++)
+  {
+    size_t size = DeferredLog::encode(record, frame);
+    serialManager.write(frame.data(), size);
+  }
+
+  // Report dropped records once there is room to do so
+  if (this->droppedRecords > 0 && this->records.empty())
+  {
+    uint32_t droppedRecords = this->droppedRecords;
+    this->droppedRecords = 0;
+    this->push(" \e[38;5;202m[WARN]\e[0m Deferred log dropped %u records",
+               droppedRecords);
+  }
+}
+
+void DeferredLog::packString(Record& record,
+                             Argument& argument,
+                             char const* string)
+{
+  size_t available = STRING_CAPACITY - record.stringsLength;
+  size_t length = string == nullptr ? 0 : strnlen(string, available);
+
+  std::memcpy(record.strings.data() + record.stringsLength, string, length);
+  record.stringsLength += static_cast<uint8_t>(length);
+
+  argument.type = ArgumentType::string;
+  argument.stringLength = static_cast<uint8_t>(length);
+}
+
+size_t DeferredLog::encode(Record const& record,
+                           std::array<uint8_t, MAX_FRAME_SIZE>& frame)
+{
+  size_t size = 0;
+  auto append = [&frame, &size](void const* data, size_t length)
+  {
+    std::memcpy(frame.data() + size, data, length);
+    size += length;
+  };
+
+  // The format string is identified by its address, which the host decoder
+  // resolves using the firmware ELF
+  auto formatAddress =
+      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(record.format));
+
+  frame.at(size++) = 0xA5;
+  frame.at(size++) = 0x5A;
+  append(&formatAddress, sizeof(formatAddress));
+  frame.at(size++) = record.numberOfArguments;
+
+  size_t stringOffset = 0;
+  for (size_t i = 0; i < record.numberOfArguments; i++)
+  {
+    Argument const& argument = record.arguments.at(i);
+    frame.at(size++) = static_cast<uint8_t>(argument.type);
+    switch (argument.type)
+    {
+      case ArgumentType::signed_integer:
+        append(&argument.signedInteger, sizeof(argument.signedInteger));
+        break;
+      case ArgumentType::unsigned_integer:
+        append(&argument.unsignedInteger, sizeof(argument.unsignedInteger));
+        break;
+      case ArgumentType::floating_point:
+        append(&argument.floatingPoint, sizeof(argument.floatingPoint));
+        break;
+      case ArgumentType::string:
+        frame.at(size++) = argument.stringLength;
+        append(record.strings.data() + stringOffset, argument.stringLength);
+        stringOffset += argument.stringLength;
+        break;
+    }
+  }
+
+  return size;
+}
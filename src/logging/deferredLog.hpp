@@ -0,0 +1,158 @@
+#pragma once
+#include "utilities/spscRingBuffer.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Singleton, deferred, binary logging backend
+ *
+ * Instead of formatting a message when it is logged, only the address of the
+ * format string (which lives in flash) and the raw arguments are copied into a
+ * fixed-size record and pushed onto a lock-free ring buffer. No memory is
+ * allocated and nothing is written to the serial link. The records are drained
+ * to the serial link as binary frames in idle time (from the logging task),
+ * and the text is rebuilt on the host by scripts/decode_deferred_log.py, which
+ * looks the format strings up in the firmware ELF.
+ *
+ * Frame layout (little endian):
+ *
+ *   0xA5 0x5A | format address (u32) | argument count (u8) | arguments
+ *
+ * where each argument is a type byte followed by its value: i32, u32, f64, or
+ * a u8 length followed by that many string bytes.
+ *
+ * Logging must only take place from the main loop (single producer). If the
+ * ring buffer is full the record is dropped and counted, and the count is
+ * reported in its own frame once there is room again.
+ *
+ */
+class DeferredLog
+{
+ public:
+  enum class ArgumentType : uint8_t
+  {
+    signed_integer = 0,
+    unsigned_integer = 1,
+    floating_point = 2,
+    string = 3,
+  };
+
+  static constexpr size_t MAX_ARGUMENTS{8};
+  static constexpr size_t STRING_CAPACITY{48};
+  static constexpr size_t CAPACITY{16};
+
+  static DeferredLog& getInstance();
+
+  /**
+   * @brief Record a log message. Strings are copied (and truncated to fit in
+   * the record), everything else is copied by value
+   *
+   * @param format - printf style format string, must be a string literal
+   * @param args - the printf arguments
+   */
+  template <typename... Args> void push(char const* format, Args const&... args)
+  {
+    static_assert(sizeof...(Args) <= MAX_ARGUMENTS,
+                  "Too many arguments for a deferred log record");
+
+    Record record{};
+    record.format = format;
+    (this->pack(record, args), ...);
+
+    if (!this->records.push(record))
+    {
+      this->droppedRecords++;
+    }
+  }
+
+  /**
+   * @brief Write up to maxRecords of the oldest records to the serial link
+   *
+   * @param maxRecords - bounds the time spent draining
+   */
+  void drain(size_t maxRecords);
+
+  // Delete move and copy constructors
+  DeferredLog(DeferredLog&&) = delete;
+  DeferredLog(DeferredLog const&) = delete;
+
+  // Delete move and copy assignment operators
+  void operator=(DeferredLog&&) = delete;
+  void operator=(DeferredLog const&) = delete;
+
+ private:
+  DeferredLog() = default;
+
+  struct Argument
+  {
+    ArgumentType type;
+    union
+    {
+      int32_t signedInteger;
+      uint32_t unsignedInteger;
+      double floatingPoint;
+      uint8_t stringLength;
+    };
+  };
+
+  struct Record
+  {
+    char const* format;
+    uint8_t numberOfArguments;
+    std::array<Argument, MAX_ARGUMENTS> arguments;
+    uint8_t stringsLength;
+    std::array<char, STRING_CAPACITY> strings;
+  };
+
+  // Record buffer, one slot is kept free by the ring buffer
+  SpscRingBuffer<Record, CAPACITY> records;
+  uint32_t droppedRecords{0};
+
+  // Largest possible frame: header + every argument at its largest
+  static constexpr size_t MAX_FRAME_SIZE{2 + 4 + 1 + MAX_ARGUMENTS * 9 +
+                                         STRING_CAPACITY};
+
+  template <typename T> static void pack(Record& record, T const& arg)
+  {
+    Argument& argument = record.arguments.at(record.numberOfArguments++);
+    if constexpr (std::is_same_v<T, std::string>)
+    {
+      DeferredLog::packString(record, argument, arg.c_str());
+    }
+    else if constexpr (std::is_same_v<T, std::string_view>)
+    {
+      // Views of null-terminated strings only, as with the immediate backend
+      DeferredLog::packString(record, argument, arg.data());
+    }
+    else if constexpr (std::is_convertible_v<T, char const*>)
+    {
+      DeferredLog::packString(record, argument, arg);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+      argument.type = ArgumentType::floating_point;
+      argument.floatingPoint = static_cast<double>(arg);
+    }
+    else if constexpr (std::is_signed_v<T> || std::is_enum_v<T>)
+    {
+      argument.type = ArgumentType::signed_integer;
+      argument.signedInteger = static_cast<int32_t>(arg);
+    }
+    else
+    {
+      argument.type = ArgumentType::unsigned_integer;
+      argument.unsignedInteger = static_cast<uint32_t>(arg);
+    }
+  }
+
+  static void packString(Record& record,
+                         Argument& argument,
+                         char const* string);
+
+  static size_t encode(Record const& record,
+                       std::array<uint8_t, MAX_FRAME_SIZE>& frame);
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Longest message formatted in place (by format, or by the immediate logging
+// backend), longer messages are truncated
+#ifndef LOG_MAX_MESSAGE_SIZE
+#define LOG_MAX_MESSAGE_SIZE 160
+#endif
+
+/**
+ * @brief A message formatted into a fixed buffer, so formatting never
+ * allocates
+ *
+ */
+template <size_t Size = LOG_MAX_MESSAGE_SIZE> struct FormattedMessage
+{
+  std::array<char, Size> text{};
+
+  [[nodiscard]] char const* c_str() const
+  {
+    return this->text.data();
+  }
+};
+
+template <typename T> struct IsFormattedMessage : std::false_type
+{
+};
+
+template <size_t Size>
+struct IsFormattedMessage<FormattedMessage<Size>> : std::true_type
+{
+};
+
+/**
+ * @brief Pass strings to printf-style functions as C strings. A string view
+ * must view a null-terminated string, e.g. a string literal
+ *
+ */
+template <typename T> constexpr auto decayStrings(T const& arg)
+{
+  if constexpr (std::is_same_v<T, std::string> ||
+                IsFormattedMessage<T>::value)
+  {
+    return arg.c_str();
+  }
+  else if constexpr (std::is_same_v<T, std::string_view>)
+  {
+    return arg.data();
+  }
+  else
+  {
+    return arg;
+  }
+}
+
+/**
+ * @brief Format a message, printf-style, truncated to Size - 1 characters
+ *
+ */
+template <size_t Size = LOG_MAX_MESSAGE_SIZE, typename... Args>
+FormattedMessage<Size> format(char const* format, Args const&... args)
+{
+  FormattedMessage<Size> message;
+  snprintf(message.text.data(),
+           message.text.size(),
+           format,
+           decayStrings(args)...);
+  return message;
+}
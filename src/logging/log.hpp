@@ -1,40 +1,135 @@
 #pragma once
 
+#include "Arduino.h"
+#include "deferredLog.hpp"
+#include "format.hpp"
+#include "rateLimiter.hpp"
 #include "serialManager.hpp"
+#include <algorithm>
+#include <array>
 #include <cstdio>
-#include <memory>
-#include <string>
-#include <type_traits>
+#include <string_view>
 
-template <typename T> constexpr auto decayStrings(T arg)
+/**
+ * @brief Format a message into a stack buffer and queue it on the serial link,
+ * without allocating
+ *
+ */
+template <typename... Args>
+void writeLine(char const* format, Args const&... args)
 {
-  if constexpr (std::is_same_v<T, std::string>)
+  std::array<char, LOG_MAX_MESSAGE_SIZE> buffer{};
+  int length =
+      snprintf(buffer.data(), buffer.size(), format, decayStrings(args)...);
+  if (length < 0)
   {
-    return arg.c_str();
-  }
-  else
-  {
-    return arg;
+    return;
   }
+  auto size = std::min(static_cast<size_t>(length), buffer.size() - 1);
+  SerialManager::getInstance().write(std::string_view(buffer.data(), size));
 }
 
-template <typename... Args> std::string format(char const* format, Args... args)
-{
-  // +1 for '\0'
-  int size_s = snprintf(nullptr, 0, format, decayStrings(args)...) + 1;
-  auto size = static_cast<size_t>(size_s);
-  auto buf = std::make_unique<char[]>(size);
-  snprintf(buf.get(), size, format, decayStrings(args)...);
-  return {buf.get()};
-}
+//////////////////////////////////////////////////////////////////////
+// Log levels
+//////////////////////////////////////////////////////////////////////
+
+// Messages below LOG_MIN_LEVEL are compiled out entirely: no code is generated
+// and their arguments are never evaluated. Set it with a build flag, e.g.
+// -D LOG_MIN_LEVEL=LOG_LEVEL_WARN
+#define LOG_LEVEL_INFO 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_NONE 2
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Backends
+//////////////////////////////////////////////////////////////////////
+
+#ifdef LOG_DEFERRED
+
+// Deferred mode: the messages are recorded without formatting or allocation,
+// and written to the serial link as binary frames by LOG_FLUSH. Use
+// scripts/decode_deferred_log.py to read them
+#define LOG_WRITE(fmt, ...) DeferredLog::getInstance().push(fmt, ##__VA_ARGS__)
+
+// Maximum number of records written per flush, bounds the time spent flushing
+#define LOG_FLUSH_MAX_RECORDS 2
+
+#define LOG_FLUSH()                                                            \
+  do                                                                           \
+  {                                                                            \
+    DeferredLog::getInstance().drain(LOG_FLUSH_MAX_RECORDS);                   \
+    SerialManager::getInstance().flush();                                      \
+  } while (false)
+
+#else
+
+// Immediate mode: the messages are formatted as they are logged and queued on
+// the serial link
+#define LOG_WRITE(fmt, ...) writeLine(fmt, ##__VA_ARGS__)
+
+#define LOG_FLUSH() SerialManager::getInstance().flush()
+
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// Logging macros
+//////////////////////////////////////////////////////////////////////
+
+#define LOG_AT_LEVEL(level, fmt, ...)                                          \
+  do                                                                           \
+  {                                                                            \
+    if constexpr ((level) >= LOG_MIN_LEVEL)                                    \
+    {                                                                          \
+      LOG_WRITE(fmt, ##__VA_ARGS__);                                           \
+    }                                                                          \
+  } while (false)
 
 #define LOG_INFO(fmt, ...)                                                     \
-  SerialManager::getInstance().write(                                          \
-      format(" \e[38;5;220m[INFO]\e[0m " fmt, ##__VA_ARGS__))
+  LOG_AT_LEVEL(                                                                \
+      LOG_LEVEL_INFO, " \e[38;5;220m[INFO]\e[0m " fmt, ##__VA_ARGS__)
 
 #define LOG_WARN(fmt, ...)                                                     \
-  SerialManager::getInstance().write(                                          \
-      format(" \e[38;5;202m[WARN]\e[0m " fmt, ##__VA_ARGS__))
+  LOG_AT_LEVEL(                                                                \
+      LOG_LEVEL_WARN, " \e[38;5;202m[WARN]\e[0m " fmt, ##__VA_ARGS__)
+
+#define LOG_RAW(fmt, ...) LOG_AT_LEVEL(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+
+//////////////////////////////////////////////////////////////////////
+// Rate limited logging macros
+//////////////////////////////////////////////////////////////////////
+
+// Each call site gets its own RateLimiter, allowing at most maxPerSecond
+// messages per second. The first message let through after some have been
+// suppressed is preceded by a summary of how many were suppressed
+#define LOG_RATE_LIMITED(LOG_MACRO, level, maxPerSecond, fmt, ...)             \
+  do                                                                           \
+  {                                                                            \
+    if constexpr ((level) >= LOG_MIN_LEVEL)                                    \
+    {                                                                          \
+      static RateLimiter rateLimiter(maxPerSecond);                            \
+      if (rateLimiter.allow(millis()))                                         \
+      {                                                                        \
+        uint32_t suppressed = rateLimiter.takeSuppressed();                    \
+        if (suppressed > 0)                                                    \
+        {                                                                      \
+          LOG_MACRO("Suppressed %u messages from %s:%d",                       \
+                    suppressed,                                                \
+                    __FILE__,                                                  \
+                    __LINE__);                                                 \
+        }                                                                      \
+        LOG_MACRO(fmt, ##__VA_ARGS__);                                         \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
+#define LOG_INFO_RATE_LIMITED(maxPerSecond, fmt, ...)                          \
+  LOG_RATE_LIMITED(                                                            \
+      LOG_INFO, LOG_LEVEL_INFO, maxPerSecond, fmt, ##__VA_ARGS__)
 
-#define LOG_RAW(fmt, ...)                                                      \
-  SerialManager::getInstance().write(format(fmt, ##__VA_ARGS__))
+#define LOG_WARN_RATE_LIMITED(maxPerSecond, fmt, ...)                          \
+  LOG_RATE_LIMITED(                                                            \
+      LOG_WARN, LOG_LEVEL_WARN, maxPerSecond, fmt, ##__VA_ARGS__)
@@ -0,0 +1,27 @@
+#include "rateLimiter.hpp"
+
+bool RateLimiter::allow(uint32_t nowMs)
+{
+  if (!this->windowStarted || nowMs - this->windowStartMs >= ONE_SECOND_MS)
+  {
+    this->windowStarted = true;
+    this->windowStartMs = nowMs;
+    this->allowedInWindow = 0;
+  }
+
+  if (this->allowedInWindow >= this->maxPerSecond)
+  {
+    this->suppressed++;
+    return false;
+  }
+
+  this->allowedInWindow++;
+  return true;
+}
+
+uint32_t RateLimiter::takeSuppressed()
+{
+  uint32_t suppressed = this->suppressed;
+  this->suppressed = 0;
+  return suppressed;
+}
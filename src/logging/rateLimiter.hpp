@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Limits an event (e.g. a log message) to at most a given number of
+ * occurrences per second, counting the occurrences it suppresses
+ *
+ */
+class RateLimiter
+{
+ public:
+  constexpr RateLimiter(uint32_t maxPerSecond) : maxPerSecond(maxPerSecond)
+  {
+  }
+
+  /**
+   * @brief Whether the event may take place now
+   *
+   * @param nowMs The current time
+   * @return true if the event is allowed, false if it is suppressed
+   */
+  bool allow(uint32_t nowMs);
+
+  /**
+   * @brief Get the number of events suppressed since the last call, and reset
+   * the count
+   *
+   */
+  uint32_t takeSuppressed();
+
+ private:
+  static constexpr uint32_t ONE_SECOND_MS{1000};
+
+  uint32_t maxPerSecond;
+  bool windowStarted{false};
+  uint32_t windowStartMs{0};
+  uint32_t allowedInWindow{0};
+  uint32_t suppressed{0};
+};
@@ -1,9 +1,88 @@
-#include "SerialManager.hpp"
-#include "Uart.h"
+#include "serialManager.hpp"
+#include "Arduino.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
-void SerialManager::write(std::string&& message)
+bool SerialManager::write(std::string_view message)
 {
-  Serial.printf("%s\r\n", std::move(message).c_str());
+  static constexpr std::string_view LINE_ENDING{"\r\n"};
+
+  if (this->availableForWrite() < message.size() + LINE_ENDING.size())
+  {
+    this->droppedMessages++;
+    return false;
+  }
+
+  this->push(reinterpret_cast<uint8_t const*>(message.data()), message.size());
+  this->push(reinterpret_cast<uint8_t const*>(LINE_ENDING.data()),
+             LINE_ENDING.size());
+  return true;
+}
+
+bool SerialManager::write(uint8_t const* data, size_t size)
+{
+  if (this->availableForWrite() < size)
+  {
+    this->droppedMessages++;
+    return false;
+  }
+
+  this->push(data, size);
+  return true;
+}
+
+void SerialManager::flush()
+{
+  // Hand over the bytes up to the end of the ring, the rest (if any) goes on
+  // the next flush
+  size_t queued = this->head - this->tail;
+  size_t offset = this->tail & (TX_BUFFER_SIZE - 1);
+  size_t size = std::min({queued, TX_BUFFER_SIZE - offset, MAX_FLUSH_BYTES});
+  if (size > 0)
+  {
+    Serial.write(this->txBuffer.data() + offset, size);
+    this->tail += size;
+  }
+
+  // Report dropped messages once there is room to do so. The report does not
+  // go through write, so it is never counted as dropped itself
+  if (this->droppedMessages > 0)
+  {
+    std::array<char, 64> report{};
+    int length =
+        snprintf(report.data(),
+                 report.size(),
+                 " \e[38;5;202m[WARN]\e[0m Serial dropped %u messages\r\n",
+                 static_cast<unsigned>(this->droppedMessages));
+    auto reportSize = static_cast<size_t>(length);
+    if (length > 0 && reportSize < report.size() &&
+        this->availableForWrite() >= reportSize)
+    {
+      this->push(reinterpret_cast<uint8_t const*>(report.data()), reportSize);
+      this->droppedMessages = 0;
+    }
+  }
+}
+
+int SerialManager::read()
+{
+  return Serial.available() > 0 ? Serial.read() : -1;
+}
+
+size_t SerialManager::availableForWrite() const
+{
+  return TX_BUFFER_SIZE - (this->head - this->tail);
+}
+
+void SerialManager::push(uint8_t const* data, size_t size)
+{
+  // Copy in at most two pieces, either side of the end of the ring
+  size_t offset = this->head & (TX_BUFFER_SIZE - 1);
+  size_t firstSize = std::min(size, TX_BUFFER_SIZE - offset);
+  std::memcpy(this->txBuffer.data() + offset, data, firstSize);
+  std::memcpy(this->txBuffer.data(), data + firstSize, size - firstSize);
+  this->head += size;
 }
 
 SerialManager& SerialManager::getInstance()
@@ -16,9 +95,12 @@ SerialManager::SerialManager()
 {
   Serial.begin(115200);
 
-  // Wait while serial is initialised
-  while (!Serial)
+  // Optionally give a host some time to attach. Never wait forever, the robot
+  // must run without a host
+  uint32_t waitMs = SERIAL_WAIT_FOR_HOST_MS;
+  uint32_t startMs = millis();
+  while (!Serial && millis() - startMs < waitMs)
   {
     ;
   };
-}
\ No newline at end of file
+}
@@ -1,5 +1,16 @@
 #pragma once
-#include <string>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// How long to wait for the serial link to come up at startup. By default the
+// robot starts straight away, whether or not a host is attached. Set it with a
+// build flag, e.g. -D SERIAL_WAIT_FOR_HOST_MS=2000, to give a host time to
+// connect before the first messages are sent
+#ifndef SERIAL_WAIT_FOR_HOST_MS
+#define SERIAL_WAIT_FOR_HOST_MS 0
+#endif
 
 /**
  * @brief Singleton class that manages the serial communication used for logging
@@ -7,11 +18,57 @@
  * Singleton class ensures only one instance of the class is created and
  * provides a global point of access to it
  *
+ * Writes never block and never allocate: the bytes are copied into a fixed
+ * transmit ring and handed to the UART in small chunks by flush, which is
+ * called from the logging task. A message that does not fit in the ring is
+ * dropped whole and counted, and the count is reported once there is room.
+ *
+ * Must only be used from the main loop.
+ *
  */
 class SerialManager
 {
  public:
-  void write(std::string&& message);
+  static constexpr size_t TX_BUFFER_SIZE{1024};
+
+  // The nRF52 UART transmits through a 64 byte EasyDMA buffer. Handing it at
+  // most that much per flush means a flush never waits on the previous
+  // transfer, as long as flushes are at least ~6ms apart at 115200 baud
+  static constexpr size_t MAX_FLUSH_BYTES{64};
+
+  /**
+   * @brief Queue a line of text, terminated with "\r\n"
+   *
+   * @return true if the line was queued, false if it was dropped
+   */
+  bool write(std::string_view message);
+
+  /**
+   * @brief Queue raw bytes, without any line termination
+   *
+   * @return true if the bytes were queued, false if they were dropped
+   */
+  bool write(uint8_t const* data, size_t size);
+
+  /**
+   * @brief Hand up to MAX_FLUSH_BYTES of the queued bytes to the UART
+   *
+   */
+  void flush();
+
+  /**
+   * @brief Read one received byte, without waiting
+   *
+   * @return int - the byte, or -1 if nothing has been received
+   */
+  int read();
+
+  /**
+   * @brief Get the number of bytes that can currently be queued
+   *
+   */
+  [[nodiscard]] size_t availableForWrite() const;
+
   static SerialManager& getInstance();
 
   // Delete move and copy constructors
@@ -24,4 +81,15 @@ class SerialManager
 
  private:
   SerialManager();
+
+  static_assert((TX_BUFFER_SIZE & (TX_BUFFER_SIZE - 1)) == 0,
+                "SerialManager TX_BUFFER_SIZE must be a power of two");
+
+  // Free running indices, masked on access. head - tail is the queued size
+  std::array<uint8_t, TX_BUFFER_SIZE> txBuffer{};
+  size_t head{0};
+  size_t tail{0};
+  uint32_t droppedMessages{0};
+
+  void push(uint8_t const* data, size_t size);
 };
@@ -1,4 +1,5 @@
 #include "application/application.hpp"
+#include "utilities/heapGuard.hpp"
 
 // Avoid falling prey to the setup method as it usually leads to poor software
 // patterns and code quality. Instead, use standard c++ object oriented
@@ -9,6 +10,11 @@ void setup()
 
 void loop()
 {
-  Application application;
+  // Static rather than on the loop task's small stack. It is constructed on
+  // the first call, once the board has been initialised
+  static Application application;
+#ifdef NO_HEAP
+  HeapGuard::lock(HeapGuard::Action::trap);
+#endif
   application.run();
 }
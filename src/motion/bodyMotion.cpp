@@ -1,4 +1,7 @@
 #include "bodyMotion.hpp"
+#include "profiling/profiler.hpp"
+#include <algorithm>
+#include <cmath>
 
 namespace BodyMotion
 {
@@ -17,41 +20,167 @@ void allJointsToZero(Joints& joints)
   joints.setAngle(Joints::Name::waist, 0);
 }
 
-void singleDanceMotion(Joints& joints, int milliSeconds, int armOffset)
+void DanceMotion::start(Choreography::Routine const& routine,
+                        uint32_t beatMs,
+                        CancellationToken const* token)
 {
-  // The waist joint limits are less than the arm joint limits and so we use the
-  // waist joint limits as our limiting case. We sweep across the full waist
-  // range and move the arms as much as possible during that motion
-  Joints::Limits waistLimits = Joints::getLimits(Joints::Name::waist);
-  int waistRange = Joints::getLimitsRange(Joints::Name::waist);
+  // The cursors are set up at the first update, from where the joints are then
+  this->routine = &routine;
+  this->beatMs = std::max<uint32_t>(beatMs, 1);
+  this->token = token;
+  this->active = true;
+  this->started = false;
+}
+
+void DanceMotion::stop()
+{
+  this->active = false;
+}
+
+bool DanceMotion::isActive() const
+{
+  return this->active;
+}
 
-  uint32_t delayFor = static_cast<uint32_t>(milliSeconds / waistRange) / 2;
+void DanceMotion::update(Joints& joints, Eyes& eyes, uint32_t nowMs)
+{
+  PROFILE_STAGE("motion.update");
 
-  // Waist goes from 0 -> MaxAngle
-  for (int i = 0; i < waistLimits.maxAngle; i++)
+  if (!this->active)
   {
-    joints.setAngle(Joints::Name::waist, i);
-    joints.setAngle(Joints::Name::left_shoulder, i + armOffset);
-    joints.setAngle(Joints::Name::right_shoulder, -i + armOffset);
-    delay(delayFor);
+    return;
   }
 
-  // Waist goes from MaxAngle -> MinAngle
-  for (int i = waistLimits.maxAngle; i > waistLimits.minAngle; i--)
+  if (this->token != nullptr && this->token->isCancelled())
   {
-    joints.setAngle(Joints::Name::waist, i);
-    joints.setAngle(Joints::Name::left_shoulder, i + armOffset);
-    joints.setAngle(Joints::Name::right_shoulder, -i + armOffset);
-    delay(delayFor);
+    this->active = false;
+    return;
   }
 
-  // Waist goes from MinAngle -> 0
-  for (int i = waistLimits.minAngle; i < 0; i++)
+  // The routine is timed from the first update it is seen in, and each joint
+  // blends in from where it is then
+  if (!this->started)
   {
-    joints.setAngle(Joints::Name::waist, i);
-    joints.setAngle(Joints::Name::left_shoulder, i + armOffset);
-    joints.setAngle(Joints::Name::right_shoulder, -i + armOffset);
-    delay(delayFor);
+    this->started = true;
+    this->startMs = nowMs;
+    this->eyesCued = false;
+
+    Joints::Angles from = joints.getAngles();
+    std::array<int, Choreography::NUMBER_OF_TRACKS> fromAngles{
+        from.waist, from.leftShoulder, from.rightShoulder, 0};
+    for (size_t i = 0; i < this->cursors.size(); i++)
+    {
+      this->cursors.at(i) = {
+          .next = this->nextKeyframe(static_cast<Choreography::Track>(i), 0),
+          .fromAngle = static_cast<float>(fromAngles.at(i)),
+          .fromMs = 0};
+    }
+  }
+
+  uint32_t elapsedMs = nowMs - this->startMs;
+
+  joints.setAngles(
+      {.waist = this->advanceJoint(Choreography::Track::waist, elapsedMs),
+       .leftShoulder =
+           this->advanceJoint(Choreography::Track::leftShoulder, elapsedMs),
+       .rightShoulder =
+           this->advanceJoint(Choreography::Track::rightShoulder, elapsedMs)});
+  this->advanceEyes(eyes, elapsedMs);
+
+  // The final update above has already moved the joints to their end angles
+  uint32_t durationMs = this->stepToMs(this->routine->lengthSteps);
+  if (elapsedMs >= durationMs)
+  {
+    // How much longer the motion took than requested, which is bounded by the
+    // motion task period
+    PROFILE_VALUE("motion.overrun", (elapsedMs - durationMs) * 1000000U);
+    this->active = false;
+  }
+}
+
+uint32_t DanceMotion::stepToMs(uint16_t step) const
+{
+  return static_cast<uint32_t>(static_cast<uint64_t>(step) * this->beatMs /
+                               Choreography::STEPS_PER_BEAT);
+}
+
+uint16_t DanceMotion::nextKeyframe(Choreography::Track track,
+                                   uint16_t from) const
+{
+  for (uint16_t i = from; i < this->routine->numberOfKeyframes; i++)
+  {
+    if (this->routine->keyframes[i].getTrack() == track)
+    {
+      return i;
+    }
+  }
+  return this->routine->numberOfKeyframes;
+}
+
+int DanceMotion::advanceJoint(Choreography::Track track, uint32_t elapsedMs)
+{
+  Cursor& cursor = this->cursors.at(static_cast<size_t>(track));
+
+  // Pass the keyframes reached since the last update, then interpolate towards
+  // the one the joint is heading to
+  while (cursor.next < this->routine->numberOfKeyframes)
+  {
+    Choreography::Keyframe const& keyframe =
+        this->routine->keyframes[cursor.next];
+    uint32_t keyframeMs = this->stepToMs(keyframe.step);
+    if (keyframeMs > elapsedMs)
+    {
+      float normalisedTime = static_cast<float>(elapsedMs - cursor.fromMs) /
+                             static_cast<float>(keyframeMs - cursor.fromMs);
+      float position = Choreography::normalisedPosition(keyframe.getProfile(),
+                                                        normalisedTime);
+      float angle =
+          cursor.fromAngle +
+          (static_cast<float>(keyframe.value) - cursor.fromAngle) * position;
+      // The servos only resolve whole degrees
+      return static_cast<int>(std::lround(angle));
+    }
+
+    cursor.fromAngle = static_cast<float>(keyframe.value);
+    cursor.fromMs = keyframeMs;
+    cursor.next = this->nextKeyframe(track, cursor.next + 1);
+  }
+
+  // Past its last keyframe, the joint holds still
+  return static_cast<int>(std::lround(cursor.fromAngle));
+}
+
+void DanceMotion::advanceEyes(Eyes& eyes, uint32_t elapsedMs)
+{
+  Cursor& cursor =
+      this->cursors.at(static_cast<size_t>(Choreography::Track::eyes));
+
+  // Each cue reached queues the fade to the next one, which then ends on time
+  // for it. The queue is therefore never more than one fade deep, and the eyes
+  // are never later than one update behind the routine
+  while (cursor.next < this->routine->numberOfKeyframes &&
+         this->stepToMs(this->routine->keyframes[cursor.next].step) <=
+             elapsedMs)
+  {
+    Choreography::Keyframe const& cue = this->routine->keyframes[cursor.next];
+    auto colour = static_cast<Eyes::Colour>(cue.value);
+    if (!this->eyesCued)
+    {
+      this->eyesCued = true;
+      eyes.setColour(colour);
+    }
+
+    cursor.next =
+        this->nextKeyframe(Choreography::Track::eyes, cursor.next + 1);
+    if (cursor.next < this->routine->numberOfKeyframes)
+    {
+      Choreography::Keyframe const& nextCue =
+          this->routine->keyframes[cursor.next];
+      eyes.crossFade(colour,
+                     static_cast<Eyes::Colour>(nextCue.value),
+                     static_cast<int>(this->stepToMs(nextCue.step) -
+                                      this->stepToMs(cue.step)));
+    }
   }
 }
 
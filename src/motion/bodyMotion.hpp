@@ -1,5 +1,8 @@
 #pragma once
+#include "choreography.hpp"
+#include "hardware/eyes.hpp"
 #include "hardware/joints.hpp"
+#include "utilities/cancellationToken.hpp"
 
 /**
  * @brief A collection of free methods used to achieve different full-body
@@ -27,17 +30,85 @@ void setBothArmsToAngle(Joints& joints, int angle);
 void allJointsToZero(Joints& joints);
 
 /**
- * @brief Used to achieve a specific synchronised body motion. A single dance
- * motion is defined as:
+ * @brief Plays a dance routine (see choreography.hpp) on the joints and the
+ * eyes
  *
- * - Waist moves from 0     -> MaxAngle -> MinAngle -> 0
- * - Right Arm moves from 0 -> MaxAngle -> MinAngle -> 0
- * - Left Arm moves from 0  -> MinAngle -> MaxAngle -> 0
+ * The motion is non-blocking: it is started with the start method and then
+ * advanced by calling the update method periodically (from the motion task).
+ * The routine is interpreted straight from its constant table: each track
+ * keeps a cursor on the keyframe it is heading to, and each update evaluates
+ * the joints between their keyframes at the current time, with the keyframe's
+ * velocity profile. The motion therefore takes exactly the routine's length at
+ * the requested tempo regardless of the update rate, and playing it allocates
+ * nothing. All three joints are written in one batch, and Joints skips any
+ * joint whose (whole degree) angle hasn't changed. Eye cues are queued on the
+ * eyes as crossfades as they are reached
+ *
+ * The motion is pre-emptible: it can be stopped, or cancelled through a
+ * CancellationToken by code that doesn't own it (e.g. a sensor alarm), in
+ * which case it gives up at its next update. It blends in from wherever the
+ * joints are at its first update rather than from the zero position, so a
+ * routine can be started mid-sweep, or after the arms have been moved, without
+ * the joints jumping
  *
- * @param joints
- * @param milliSeconds
- * @param armOffset
  */
-void singleDanceMotion(Joints& joints, int milliSeconds, int armOffset = 0);
+class DanceMotion
+{
+ public:
+  /**
+   * @brief Start playing a routine. Any motion in progress is replaced
+   *
+   * @param routine - the routine, which must outlive the motion
+   * @param beatMs - the tempo, as the duration of one beat
+   * @param token - if given, the motion is abandoned at the first update after
+   * the token is cancelled, leaving the joints where they are
+   */
+  void start(Choreography::Routine const& routine,
+             uint32_t beatMs,
+             CancellationToken const* token = nullptr);
+
+  /**
+   * @brief Stop the motion, leaving the joints where they are
+   *
+   */
+  void stop();
+
+  [[nodiscard]] bool isActive() const;
+
+  /**
+   * @brief Move the joints to their position at the current time, and cue the
+   * eyes
+   *
+   * @param joints
+   * @param eyes
+   * @param nowMs - the current time
+   */
+  void update(Joints& joints, Eyes& eyes, uint32_t nowMs);
+
+ private:
+  bool active{false};
+  bool started{false};
+  uint32_t startMs{0};
+  uint32_t beatMs{0};
+  Choreography::Routine const* routine{nullptr};
+  CancellationToken const* token{nullptr};
+
+  // Where a track is in the routine: the keyframe it is heading to (or
+  // numberOfKeyframes past its last one) and where it is coming from
+  struct Cursor
+  {
+    uint16_t next;
+    float fromAngle;
+    uint32_t fromMs;
+  };
+  std::array<Cursor, Choreography::NUMBER_OF_TRACKS> cursors{};
+  // Whether the routine has taken the eyes over yet
+  bool eyesCued{false};
+
+  uint32_t stepToMs(uint16_t step) const;
+  uint16_t nextKeyframe(Choreography::Track track, uint16_t from) const;
+  int advanceJoint(Choreography::Track track, uint32_t elapsedMs);
+  void advanceEyes(Eyes& eyes, uint32_t elapsedMs);
+};
 
 } // namespace BodyMotion
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "choreography.hpp"
+
+namespace
+{
+
+// Fraction of a trapezoidal move spent accelerating (and decelerating)
+constexpr float TRAPEZOIDAL_RAMP_FRACTION{0.25F};
+
+} // namespace
+
+namespace Choreography
+{
+
+float normalisedPosition(Profile profile, float t)
+{
+  // Each profile maps normalised time [0, 1] to normalised position [0, 1]
+  switch (profile)
+  {
+    case Profile::linear:
+      return t;
+
+    case Profile::trapezoidal:
+    {
+      // The cruise velocity is chosen so the area under the velocity
+      // trapezoid (the distance travelled) is 1
+      constexpr float ramp = TRAPEZOIDAL_RAMP_FRACTION;
+      constexpr float cruiseVelocity = 1.0F / (1.0F - ramp);
+      constexpr float acceleration = cruiseVelocity / ramp;
+      if (t < ramp)
+      {
+        return 0.5F * acceleration * t * t;
+      }
+      if (t > 1.0F - ramp)
+      {
+        float remaining = 1.0F - t;
+        return 1.0F - 0.5F * acceleration * remaining * remaining;
+      }
+      return 0.5F * cruiseVelocity * ramp + cruiseVelocity * (t - ramp);
+    }
+
+    case Profile::minimum_jerk:
+    {
+      // s(t) = 10t^3 - 15t^4 + 6t^5
+      float t3 = t * t * t;
+      return t3 * (10.0F + t * (-15.0F + 6.0F * t));
+    }
+  }
+  return t;
+}
+
+} // namespace Choreography
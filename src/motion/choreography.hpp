@@ -0,0 +1,206 @@
+#pragma once
+#include "hardware/eyes.hpp"
+#include "hardware/joints.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Compact, declarative description of a dance routine
+ *
+ * A routine is a constant table of keyframes, kept in flash, that the
+ * DanceMotion plays back. Each keyframe belongs to one track - a joint, or the
+ * eyes - and is 4 bytes:
+ *
+ * - step: when it is reached, in 1/STEPS_PER_BEAT of a beat from the start of
+ *   the routine. Routines are written in beats, not milliseconds, so the same
+ *   routine can be played at any tempo
+ * - track and profile: which track it belongs to and, for a joint, the velocity
+ *   profile the joint follows to get there from its previous keyframe
+ * - value: the joint angle in degrees, or the Eyes::Colour
+ *
+ * A joint moves from one of its keyframes to the next. Before its first
+ * keyframe it blends in from wherever it was when the routine started, and
+ * after its last one it holds still. A joint without keyframes is left alone.
+ *
+ * An eye cue fades the eyes from the previous cue's colour, so that they reach
+ * its colour at its step. The first cue of a routine takes the eyes over: it
+ * cancels whatever animation is playing and sets its colour straight away.
+ *
+ * Keyframes are sorted by step. The isValid method checks a routine, and is
+ * meant to be used in a static_assert next to its table (see routines.hpp),
+ * so that a malformed routine doesn't build.
+ *
+ */
+namespace Choreography
+{
+
+enum class Track : uint8_t
+{
+  waist,
+  leftShoulder,
+  rightShoulder,
+  eyes,
+};
+
+static constexpr size_t NUMBER_OF_TRACKS{4};
+
+// How a joint moves from one keyframe to the next:
+// - linear: constant velocity, instantaneous start and stop
+// - trapezoidal: constant acceleration, cruise, constant deceleration
+// - minimum_jerk: smooth 5th order polynomial, zero velocity and acceleration
+//   at both ends
+enum class Profile : uint8_t
+{
+  linear,
+  trapezoidal,
+  minimum_jerk
+};
+
+/**
+ * @brief Map normalised time [0, 1] between two keyframes to the normalised
+ * position [0, 1] between them, for a given velocity profile. The joint
+ * position is evaluated at the current time, so it is always correct no matter
+ * how often (or how late) it is evaluated
+ *
+ */
+float normalisedPosition(Profile profile, float normalisedTime);
+
+// The finest subdivision of a beat a keyframe can be placed on
+static constexpr uint16_t STEPS_PER_BEAT{4};
+
+struct Keyframe
+{
+  uint16_t step;
+  // The track in the low nibble, the profile in the high nibble
+  uint8_t trackAndProfile;
+  int8_t value;
+
+  [[nodiscard]] constexpr Track getTrack() const
+  {
+    return static_cast<Track>(this->trackAndProfile & 0x0FU);
+  }
+
+  [[nodiscard]] constexpr Profile getProfile() const
+  {
+    return static_cast<Profile>(this->trackAndProfile >> 4U);
+  }
+};
+
+static_assert(sizeof(Keyframe) == 4, "Keyframes must stay 4 bytes");
+
+struct Routine
+{
+  char const* name;
+  uint16_t lengthSteps;
+  Keyframe const* keyframes;
+  uint16_t numberOfKeyframes;
+};
+
+/**
+ * @brief Convert a time in beats to steps. Times finer than a step are rounded
+ * to the nearest step
+ *
+ */
+constexpr uint16_t beat(float beats)
+{
+  return static_cast<uint16_t>(beats * STEPS_PER_BEAT + 0.5F);
+}
+
+/**
+ * @brief A joint keyframe: the joint reaches the angle at the step
+ *
+ */
+constexpr Keyframe move(
+    Track joint,
+    uint16_t step,
+    int angle,
+    Profile profile = Profile::trapezoidal)
+{
+  return {.step = step,
+          .trackAndProfile = static_cast<uint8_t>(
+              static_cast<uint8_t>(joint) |
+              static_cast<uint8_t>(static_cast<uint8_t>(profile) << 4U)),
+          .value = static_cast<int8_t>(angle)};
+}
+
+/**
+ * @brief An eye cue: the eyes reach the colour at the step
+ *
+ */
+constexpr Keyframe eyes(uint16_t step, Eyes::Colour colour)
+{
+  return {.step = step,
+          .trackAndProfile = static_cast<uint8_t>(Track::eyes),
+          .value = static_cast<int8_t>(colour)};
+}
+
+template <size_t N>
+constexpr Routine makeRoutine(char const* name,
+                              uint16_t lengthSteps,
+                              std::array<Keyframe, N> const& keyframes)
+{
+  return {.name = name,
+          .lengthSteps = lengthSteps,
+          .keyframes = keyframes.data(),
+          .numberOfKeyframes = static_cast<uint16_t>(N)};
+}
+
+/**
+ * @brief Check the structure of a routine: keyframes sorted by step and within
+ * the routine, known tracks, profiles and colours, and angles the joints can
+ * reach
+ *
+ */
+constexpr bool isValid(Routine const& routine)
+{
+  if (routine.lengthSteps == 0 || routine.keyframes == nullptr)
+  {
+    return false;
+  }
+
+  uint16_t previousStep = 0;
+  for (uint16_t i = 0; i < routine.numberOfKeyframes; i++)
+  {
+    Keyframe const& keyframe = routine.keyframes[i];
+    if (keyframe.step < previousStep || keyframe.step > routine.lengthSteps)
+    {
+      return false;
+    }
+    previousStep = keyframe.step;
+
+    if ((keyframe.trackAndProfile & 0x0FU) >= NUMBER_OF_TRACKS)
+    {
+      return false;
+    }
+
+    if (keyframe.getTrack() == Track::eyes)
+    {
+      if (keyframe.value < static_cast<int>(Eyes::Colour::off) ||
+          keyframe.value > static_cast<int>(Eyes::Colour::light_blue))
+      {
+        return false;
+      }
+      continue;
+    }
+
+    if ((keyframe.trackAndProfile >> 4U) >
+        static_cast<uint8_t>(Profile::minimum_jerk))
+    {
+      return false;
+    }
+
+    Joints::Limits limits = Joints::getLimits(
+        keyframe.getTrack() == Track::waist ? Joints::Name::waist
+        : keyframe.getTrack() == Track::leftShoulder
+            ? Joints::Name::left_shoulder
+            : Joints::Name::right_shoulder);
+    if (keyframe.value < limits.minAngle || keyframe.value > limits.maxAngle)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace Choreography
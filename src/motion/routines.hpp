@@ -0,0 +1,92 @@
+#pragma once
+#include "choreography.hpp"
+#include <array>
+
+/**
+ * @brief The dance routines the robot knows, as constant keyframe tables
+ *
+ * A new routine only costs its table (4 bytes a keyframe): write the keyframes
+ * sorted by step, check the table with a static_assert, and add it to
+ * ROUTINES. Routines are written with the arms offset by -15 degrees, which
+ * keeps them clear of the torso. Routines with eye cues end on red, the
+ * colour of DanceState::WithinRangeState, so the state's next transition
+ * fades from the colour the eyes are actually showing.
+ *
+ * The src/benchmark/choreographyCheckMain.cpp program plays each routine back
+ * at the slowest and the fastest tempo, and reports its timing, its flash
+ * size and the joint speeds it asks for.
+ *
+ */
+namespace Routines
+{
+
+using Choreography::beat;
+using Choreography::eyes;
+using Choreography::move;
+using Choreography::Track;
+using Choreography::Profile;
+
+// The waist sweeps across its full range, out and back, and the arms follow
+// it, mirrored
+inline constexpr std::array<Choreography::Keyframe, 9> SWEEP_KEYFRAMES{
+    move(Track::waist, beat(1), 45),
+    move(Track::leftShoulder, beat(1), 30),
+    move(Track::rightShoulder, beat(1), -60),
+    move(Track::waist, beat(3), -45),
+    move(Track::leftShoulder, beat(3), -60),
+    move(Track::rightShoulder, beat(3), 30),
+    move(Track::waist, beat(4), 0),
+    move(Track::leftShoulder, beat(4), -15),
+    move(Track::rightShoulder, beat(4), -15),
+};
+inline constexpr Choreography::Routine SWEEP =
+    Choreography::makeRoutine("sweep", beat(4), SWEEP_KEYFRAMES);
+static_assert(Choreography::isValid(SWEEP), "Invalid sweep routine");
+
+// Each arm waves in turn while the waist sways towards it, the eyes
+// alternating with the arms
+inline constexpr std::array<Choreography::Keyframe, 13> WAVE_KEYFRAMES{
+    eyes(beat(0), Eyes::Colour::red),
+    move(Track::waist, beat(2), 20, Profile::minimum_jerk),
+    move(Track::leftShoulder, beat(2), 45, Profile::minimum_jerk),
+    eyes(beat(2), Eyes::Colour::blue),
+    move(Track::leftShoulder, beat(4), -15, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(4), -15),
+    eyes(beat(4), Eyes::Colour::red),
+    move(Track::waist, beat(6), -20, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(6), 45, Profile::minimum_jerk),
+    eyes(beat(6), Eyes::Colour::blue),
+    move(Track::waist, beat(8), 0, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(8), -15, Profile::minimum_jerk),
+    eyes(beat(8), Eyes::Colour::red),
+};
+inline constexpr Choreography::Routine WAVE =
+    Choreography::makeRoutine("wave", beat(8), WAVE_KEYFRAMES);
+static_assert(Choreography::isValid(WAVE), "Invalid wave routine");
+
+// The waist twists on the beat and both arms pump on the off-beat
+inline constexpr std::array<Choreography::Keyframe, 14> TWIST_KEYFRAMES{
+    eyes(beat(0), Eyes::Colour::green),
+    move(Track::leftShoulder, beat(0.5F), 15, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(0.5F), 15, Profile::minimum_jerk),
+    move(Track::waist, beat(1), 30),
+    move(Track::leftShoulder, beat(1), -15, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(1), -15, Profile::minimum_jerk),
+    move(Track::leftShoulder, beat(1.5F), 15, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(1.5F), 15, Profile::minimum_jerk),
+    move(Track::waist, beat(2), -30),
+    move(Track::leftShoulder, beat(2), -15, Profile::minimum_jerk),
+    move(Track::rightShoulder, beat(2), -15, Profile::minimum_jerk),
+    eyes(beat(2), Eyes::Colour::blue),
+    move(Track::waist, beat(3), 0),
+    eyes(beat(3), Eyes::Colour::red),
+};
+inline constexpr Choreography::Routine TWIST =
+    Choreography::makeRoutine("twist", beat(3), TWIST_KEYFRAMES);
+static_assert(Choreography::isValid(TWIST), "Invalid twist routine");
+
+// Played in turn by DanceState
+inline constexpr std::array<Choreography::Routine, 3> ROUTINES{
+    SWEEP, WAVE, TWIST};
+
+} // namespace Routines
@@ -0,0 +1,55 @@
+#include "cycleCounter.hpp"
+
+#ifdef ARDUINO_ARCH_NRF52
+
+#include "nrf.h"
+
+namespace CycleCounter
+{
+
+void enable()
+{
+  // The DWT unit is only powered once trace is enabled
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t read()
+{
+  return DWT->CYCCNT;
+}
+
+uint32_t ticksPerSecond()
+{
+  return SystemCoreClock;
+}
+
+} // namespace CycleCounter
+
+#else
+
+#include <chrono>
+
+namespace CycleCounter
+{
+
+void enable()
+{
+}
+
+uint32_t read()
+{
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+uint32_t ticksPerSecond()
+{
+  return 1000000000;
+}
+
+} // namespace CycleCounter
+
+#endif
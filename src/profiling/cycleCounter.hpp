@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Free running, high resolution tick counter used to time the profiling
+ * probes
+ *
+ * On the robot this is the Cortex-M4 DWT cycle counter (CYCCNT), which counts
+ * CPU cycles at 64MHz and is read in a single load. Anywhere else (the
+ * simulation and the benchmark) it falls back to std::chrono::steady_clock,
+ * counting nanoseconds.
+ *
+ * The counter is 32 bits and wraps (every ~67s on the robot), so only
+ * differences between two reads are meaningful.
+ *
+ */
+namespace CycleCounter
+{
+
+/**
+ * @brief Start the counter. Called once, before the first read
+ *
+ */
+void enable();
+
+uint32_t read();
+
+/**
+ * @brief Number of ticks per second
+ *
+ */
+uint32_t ticksPerSecond();
+
+} // namespace CycleCounter
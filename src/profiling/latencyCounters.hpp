@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Running count, min, max and mean of latency samples (e.g. in
+ * nanoseconds), in 20 bytes of RAM
+ *
+ */
+class LatencyCounters
+{
+ public:
+  void record(uint32_t value)
+  {
+    this->count++;
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+    this->sum += value;
+  }
+
+  [[nodiscard]] uint32_t getCount() const
+  {
+    return this->count;
+  }
+
+  [[nodiscard]] uint32_t getMin() const
+  {
+    return this->count == 0 ? 0 : this->min;
+  }
+
+  [[nodiscard]] uint32_t getMax() const
+  {
+    return this->max;
+  }
+
+  [[nodiscard]] uint32_t getMean() const
+  {
+    return this->count == 0 ? 0
+                            : static_cast<uint32_t>(this->sum / this->count);
+  }
+
+ private:
+  uint32_t count{0};
+  uint32_t min{UINT32_MAX};
+  uint32_t max{0};
+  uint64_t sum{0};
+};
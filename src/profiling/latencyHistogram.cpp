@@ -0,0 +1,107 @@
+#include "latencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// log2(SUB_BUCKETS)
+constexpr uint32_t SUB_BUCKET_BITS{3};
+
+} // namespace
+
+void LatencyHistogram::record(uint32_t value)
+{
+  this->buckets.at(LatencyHistogram::bucketIndex(value))++;
+  this->counters.record(value);
+}
+
+uint32_t LatencyHistogram::getCount() const
+{
+  return this->counters.getCount();
+}
+
+uint32_t LatencyHistogram::getMin() const
+{
+  return this->counters.getMin();
+}
+
+uint32_t LatencyHistogram::getMax() const
+{
+  return this->counters.getMax();
+}
+
+uint32_t LatencyHistogram::getMean() const
+{
+  return this->counters.getMean();
+}
+
+uint32_t LatencyHistogram::getPercentile(float fraction) const
+{
+  uint32_t count = this->counters.getCount();
+  if (count == 0)
+  {
+    return 0;
+  }
+
+  auto rank = static_cast<uint32_t>(std::ceil(
+      std::clamp(fraction, 0.0F, 1.0F) * static_cast<float>(count)));
+  rank = std::max<uint32_t>(rank, 1);
+
+  uint32_t cumulative = 0;
+  for (size_t bucket = 0; bucket < NUMBER_OF_BUCKETS; bucket++)
+  {
+    cumulative += this->buckets.at(bucket);
+    if (cumulative >= rank)
+    {
+      return std::min(LatencyHistogram::bucketUpperBound(bucket),
+                      this->counters.getMax());
+    }
+  }
+  return this->counters.getMax();
+}
+
+uint32_t LatencyHistogram::getBucketCount(size_t bucket) const
+{
+  return this->buckets.at(bucket);
+}
+
+uint32_t LatencyHistogram::bucketLowerBound(size_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+  {
+    return static_cast<uint32_t>(bucket);
+  }
+
+  // Bucket of the power of two range [2^msb, 2^(msb + 1))
+  auto msb = static_cast<uint32_t>(bucket / SUB_BUCKETS) + 2;
+  auto subBucket = static_cast<uint32_t>(bucket % SUB_BUCKETS);
+  return (SUB_BUCKETS + subBucket) << (msb - SUB_BUCKET_BITS);
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(size_t bucket)
+{
+  if (bucket < SUB_BUCKETS)
+  {
+    return static_cast<uint32_t>(bucket);
+  }
+
+  auto msb = static_cast<uint32_t>(bucket / SUB_BUCKETS) + 2;
+  return LatencyHistogram::bucketLowerBound(bucket) +
+         ((1U << (msb - SUB_BUCKET_BITS)) - 1);
+}
+
+size_t LatencyHistogram::bucketIndex(uint32_t value)
+{
+  if (value < SUB_BUCKETS)
+  {
+    return value;
+  }
+
+  // The leading one selects the power of two range, the next SUB_BUCKET_BITS
+  // bits select the bucket within it
+  auto msb = static_cast<uint32_t>(31 - __builtin_clz(value));
+  uint32_t subBucket =
+      (value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return (msb - 2) * SUB_BUCKETS + subBucket;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "latencyCounters.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-bucket histogram of latency samples (e.g. in nanoseconds)
+ *
+ * The buckets are log-linear: every power of two range is split into
+ * SUB_BUCKETS equal buckets, so a bucket is never wider than 1/8 of its lower
+ * bound and percentiles are accurate to within 12.5%. Values below SUB_BUCKETS
+ * each get their own bucket. Recording a sample is a few integer operations
+ * and never allocates.
+ *
+ * Min, max and mean are exact. The histogram takes ~1KB of RAM, use
+ * LatencyCounters where only those are needed.
+ *
+ */
+class LatencyHistogram
+{
+ public:
+  static constexpr size_t SUB_BUCKETS{8};
+  static constexpr size_t NUMBER_OF_BUCKETS{(32 - 2) * SUB_BUCKETS};
+
+  void record(uint32_t value);
+
+  [[nodiscard]] uint32_t getCount() const;
+  [[nodiscard]] uint32_t getMin() const;
+  [[nodiscard]] uint32_t getMax() const;
+  [[nodiscard]] uint32_t getMean() const;
+
+  /**
+   * @brief Get the value below which the given fraction of the samples fall,
+   * rounded up to the upper bound of its bucket (and capped at the max)
+   *
+   * @param fraction - e.g. 0.99 for the 99th percentile
+   */
+  [[nodiscard]] uint32_t getPercentile(float fraction) const;
+
+  [[nodiscard]] uint32_t getBucketCount(size_t bucket) const;
+  static uint32_t bucketLowerBound(size_t bucket);
+  static uint32_t bucketUpperBound(size_t bucket);
+  static size_t bucketIndex(uint32_t value);
+
+ private:
+  std::array<uint32_t, NUMBER_OF_BUCKETS> buckets{};
+  LatencyCounters counters;
+};
@@ -0,0 +1,110 @@
+#include "profiler.hpp"
+#include "cycleCounter.hpp"
+#include "logging/log.hpp"
+#include <cstring>
+
+Profiler& Profiler::getInstance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+{
+  CycleCounter::enable();
+  this->setClock(CycleCounter::read, CycleCounter::ticksPerSecond());
+}
+
+void Profiler::setClock(Clock clock, uint32_t ticksPerSecond)
+{
+  this->clock = clock;
+  this->nsPerTickQ16 = (1000000000ULL << 16) / ticksPerSecond;
+}
+
+uint32_t Profiler::nowTicks() const
+{
+  return this->clock();
+}
+
+uint32_t Profiler::ticksToNs(uint32_t ticks) const
+{
+  return static_cast<uint32_t>((ticks * this->nsPerTickQ16) >> 16);
+}
+
+size_t Profiler::registerStage(char const* name)
+{
+  // Call sites that share a name share a stage
+  for (size_t stage = 0; stage < this->numberOfStages; stage++)
+  {
+    if (std::strcmp(this->stages.at(stage).name, name) == 0)
+    {
+      return stage;
+    }
+  }
+
+  if (this->numberOfStages >= MAX_STAGES)
+  {
+    return MAX_STAGES;
+  }
+
+  this->stages.at(this->numberOfStages).name = name;
+  return this->numberOfStages++;
+}
+
+void Profiler::record(size_t stage, uint32_t valueNs)
+{
+  if (stage < this->numberOfStages)
+  {
+    this->stages.at(stage).samples.record(valueNs);
+  }
+}
+
+size_t Profiler::getNumberOfStages() const
+{
+  return this->numberOfStages;
+}
+
+Profiler::Stage const& Profiler::getStage(size_t stage) const
+{
+  return this->stages.at(stage);
+}
+
+void Profiler::requestDump()
+{
+  this->nextDumpStage = 0;
+  LOG_RAW("PROFILE %u stages (count, min, mean, max)",
+          static_cast<unsigned>(this->numberOfStages));
+}
+
+void Profiler::service()
+{
+  // One stage per call keeps the serial link from overflowing
+  if (this->nextDumpStage >= this->numberOfStages)
+  {
+    return;
+  }
+
+  Stage const& stage = this->stages.at(this->nextDumpStage++);
+  LOG_RAW("PROFILE %s: %u, %uns, %uns, %uns",
+          stage.name,
+          stage.samples.getCount(),
+          stage.samples.getMin(),
+          stage.samples.getMean(),
+          stage.samples.getMax());
+}
+
+//////////////////////////////////////////////////////////////////////
+// ScopedStage
+//////////////////////////////////////////////////////////////////////
+
+Profiler::ScopedStage::ScopedStage(size_t stage)
+    : stage(stage), startTicks(Profiler::getInstance().nowTicks())
+{
+}
+
+Profiler::ScopedStage::~ScopedStage()
+{
+  Profiler& profiler = Profiler::getInstance();
+  uint32_t elapsedTicks = profiler.nowTicks() - this->startTicks;
+  profiler.record(this->stage, profiler.ticksToNs(elapsedTicks));
+}
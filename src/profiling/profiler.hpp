@@ -0,0 +1,194 @@
+#pragma once
+#include "latencyCounters.hpp"
+#include "latencyHistogram.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Singleton collection of named latency statistics ("stages"), filled
+ * by the PROFILE_* macros below
+ *
+ * A stage is registered the first time its call site runs, and the call site
+ * keeps the stage index in a static, so recording a sample is two clock reads
+ * and a counter update. The clock is the CycleCounter by default (the DWT
+ * cycle counter on the robot, std::chrono elsewhere). It can be replaced by
+ * any free running tick counter, and the ticks are converted to nanoseconds.
+ *
+ * Each stage keeps LatencyCounters (count, min, mean, max). With
+ * PROFILING_HISTOGRAMS defined it keeps a full LatencyHistogram instead, which
+ * is too large to keep for every stage on the robot.
+ *
+ * On the robot, sending DUMP_COMMAND over the serial link logs every stage
+ * (the Application reads the command), one per call to service (from the
+ * logging task).
+ *
+ * The macros compile to nothing unless PROFILING is defined, so the
+ * instrumentation costs nothing in a normal build.
+ *
+ */
+class Profiler
+{
+ public:
+  using Clock = uint32_t (*)();
+
+#ifdef PROFILING_HISTOGRAMS
+  using Samples = LatencyHistogram;
+#else
+  using Samples = LatencyCounters;
+#endif
+
+  static constexpr size_t MAX_STAGES{24};
+  static constexpr char DUMP_COMMAND{'p'};
+
+  struct Stage
+  {
+    char const* name{nullptr};
+    Samples samples;
+  };
+
+  static Profiler& getInstance();
+
+  /**
+   * @brief Replace the clock
+   *
+   * @param clock - free running tick counter
+   * @param ticksPerSecond - the rate of the tick counter
+   */
+  void setClock(Clock clock, uint32_t ticksPerSecond);
+
+  [[nodiscard]] uint32_t nowTicks() const;
+
+  /**
+   * @brief Convert a number of ticks to nanoseconds
+   *
+   */
+  [[nodiscard]] uint32_t ticksToNs(uint32_t ticks) const;
+
+  /**
+   * @brief Register a stage
+   *
+   * @param name - must be a string literal
+   * @return size_t - the index of the stage, or MAX_STAGES if the table is full
+   * (the samples of such a stage are discarded)
+   */
+  size_t registerStage(char const* name);
+
+  void record(size_t stage, uint32_t valueNs);
+
+  [[nodiscard]] size_t getNumberOfStages() const;
+  [[nodiscard]] Stage const& getStage(size_t stage) const;
+
+  /**
+   * @brief Start a dump of every stage to the log
+   *
+   */
+  void requestDump();
+
+  /**
+   * @brief Log the next stage of a dump in progress. Must be called
+   * periodically
+   *
+   */
+  void service();
+
+  /**
+   * @brief Records the time between its construction and destruction
+   *
+   */
+  class ScopedStage
+  {
+   public:
+    ScopedStage(size_t stage);
+    ~ScopedStage();
+
+    ScopedStage(ScopedStage&&) = delete;
+    ScopedStage(ScopedStage const&) = delete;
+    void operator=(ScopedStage&&) = delete;
+    void operator=(ScopedStage const&) = delete;
+
+   private:
+    size_t stage;
+    uint32_t startTicks;
+  };
+
+  // Delete move and copy constructors
+  Profiler(Profiler&&) = delete;
+  Profiler(Profiler const&) = delete;
+
+  // Delete move and copy assignment operators
+  void operator=(Profiler&&) = delete;
+  void operator=(Profiler const&) = delete;
+
+ private:
+  Profiler();
+
+  Clock clock;
+
+  // Nanoseconds per tick, in 16.16 fixed point, so the conversion is a
+  // multiply and a shift
+  uint64_t nsPerTickQ16;
+
+  std::array<Stage, MAX_STAGES> stages{};
+  size_t numberOfStages{0};
+
+  // Index of the next stage to dump, past the last stage when not dumping
+  size_t nextDumpStage{MAX_STAGES};
+};
+
+//////////////////////////////////////////////////////////////////////
+// Profiling macros
+//////////////////////////////////////////////////////////////////////
+
+#ifdef PROFILING
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+
+// Time the rest of the enclosing scope
+#define PROFILE_STAGE(name)                                                    \
+  static size_t const PROFILE_JOIN(profileStage, __LINE__) =                  \
+      Profiler::getInstance().registerStage(name);                             \
+  Profiler::ScopedStage PROFILE_JOIN(profileScope, __LINE__)(                  \
+      PROFILE_JOIN(profileStage, __LINE__))
+
+// Log the profile on request, see Profiler::service
+#define PROFILE_SERVICE() Profiler::getInstance().service()
+
+// Request a dump of the profile
+#define PROFILE_DUMP() Profiler::getInstance().requestDump()
+
+// Record a value (in nanoseconds) measured by the caller
+#define PROFILE_VALUE(name, valueNs)                                           \
+  do                                                                           \
+  {                                                                            \
+    static size_t const stage = Profiler::getInstance().registerStage(name);   \
+    Profiler::getInstance().record(stage, valueNs);                            \
+  } while (false)
+
+// Record the time since the previous call from the same call site. nowNs is
+// a free running time in nanoseconds, it may come from a different clock to
+// the profiler's (e.g. the time a task was released)
+#define PROFILE_PERIOD(name, nowNs)                                            \
+  do                                                                           \
+  {                                                                            \
+    static bool started = false;                                               \
+    static uint32_t previousNs = 0;                                            \
+    uint32_t currentNs = (nowNs);                                              \
+    if (started)                                                               \
+    {                                                                          \
+      PROFILE_VALUE(name, currentNs - previousNs);                             \
+    }                                                                          \
+    started = true;                                                            \
+    previousNs = currentNs;                                                    \
+  } while (false)
+
+#else
+
+#define PROFILE_STAGE(name)
+#define PROFILE_VALUE(name, valueNs)
+#define PROFILE_PERIOD(name, nowNs)
+#define PROFILE_SERVICE()
+#define PROFILE_DUMP()
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Representation of a periodic Task run by the Scheduler
+ *
+ * A task is released by the Scheduler once every period and is expected to do
+ * a small, bounded amount of work (runOnce method) before handing control back.
+ * A task must never block (no delay or busy waiting) as that would stall every
+ * other task. A Task must have a name (name method)
+ *
+ * The "I" preface is used to indicate that the task is an Interface class and
+ * is fully abstract.
+ *
+ */
+class ITask
+{
+ public:
+  virtual ~ITask() = default;
+  virtual void runOnce(uint32_t nowMs) = 0;
+  virtual char const* name() = 0;
+};
@@ -0,0 +1,116 @@
+#include "scheduler.hpp"
+#include "logging/log.hpp"
+#include <algorithm>
+
+namespace
+{
+
+// True when time "a" is at or after time "b". Unsigned subtraction keeps this
+// correct across the 49 day millis() wrap around
+bool isAtOrAfter(uint32_t a, uint32_t b)
+{
+  return static_cast<int32_t>(a - b) >= 0;
+}
+
+} // namespace
+
+Scheduler::Scheduler(Clock clock) : clock(clock)
+{
+}
+
+bool Scheduler::addTask(ITask& task, Timing timing)
+{
+  if (this->numberOfTasks >= MAX_TASKS)
+  {
+    LOG_WARN("Unable to add task %s - scheduler is full", task.name());
+    return false;
+  }
+
+  if (timing.periodMs == 0)
+  {
+    LOG_WARN("Unable to add task %s - the period must be non-zero",
+             task.name());
+    return false;
+  }
+
+  Entry& entry = this->entries.at(this->numberOfTasks++);
+  entry.task = &task;
+  entry.timing = timing;
+  return true;
+}
+
+void Scheduler::runOnce()
+{
+  for (size_t i = 0; i < this->numberOfTasks; i++)
+  {
+    Entry& entry = this->entries.at(i);
+    uint32_t nowMs = this->clock();
+
+    // The first release of a task is aligned with the first time it is seen
+    if (!entry.released)
+    {
+      entry.nextReleaseMs = nowMs;
+      entry.released = true;
+    }
+
+    if (isAtOrAfter(nowMs, entry.nextReleaseMs))
+    {
+      this->release(entry, nowMs);
+    }
+  }
+}
+
+Scheduler::Statistics Scheduler::getStatistics(ITask const& task) const
+{
+  for (size_t i = 0; i < this->numberOfTasks; i++)
+  {
+    if (this->entries.at(i).task == &task)
+    {
+      return this->entries.at(i).statistics;
+    }
+  }
+  return {};
+}
+
+void Scheduler::release(Entry& entry, uint32_t nowMs)
+{
+  Statistics& statistics = entry.statistics;
+  uint32_t releaseLatencyMs = nowMs - entry.nextReleaseMs;
+
+  entry.task->runOnce(nowMs);
+
+  uint32_t finishedMs = this->clock();
+  uint32_t executionTimeMs = finishedMs - nowMs;
+
+  statistics.releases++;
+  statistics.worstReleaseLatencyMs =
+      std::max(statistics.worstReleaseLatencyMs, releaseLatencyMs);
+  statistics.worstExecutionTimeMs =
+      std::max(statistics.worstExecutionTimeMs, executionTimeMs);
+
+  if (!isAtOrAfter(entry.nextReleaseMs + entry.timing.deadlineMs, finishedMs))
+  {
+    statistics.deadlineMisses++;
+  }
+
+  // Keep the task phase locked to its original release times. If we have
+  // fallen more than a whole period behind, drop the missed releases rather
+  // than running the task back-to-back to catch up
+  entry.nextReleaseMs += entry.timing.periodMs;
+  while (isAtOrAfter(finishedMs, entry.nextReleaseMs))
+  {
+    entry.nextReleaseMs += entry.timing.periodMs;
+    statistics.skippedReleases++;
+  }
+}
+
+FormattedMessage<> Scheduler::Statistics::toString() const
+{
+  return format("Releases: %u, Deadline misses: %u, Skipped: %u, Worst "
+                "latency: %ums, Worst execution: %ums",
+                this->releases,
+                this->deadlineMisses,
+                this->skippedReleases,
+                this->worstReleaseLatencyMs,
+                this->worstExecutionTimeMs);
+}
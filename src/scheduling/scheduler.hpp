@@ -0,0 +1,87 @@
+#pragma once
+#include "iTask.hpp"
+#include "logging/format.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Cooperative, fixed-rate scheduler
+ *
+ * Each task is registered with a period and a deadline. Every call to runOnce
+ * runs each task whose release time has been reached, in the order the tasks
+ * were registered (earlier registration = higher priority). The clock is read
+ * again before each task, so a task's release latency includes the time the
+ * tasks ahead of it took in the same call. Since tasks never block, the time
+ * between two releases of a task is bounded by its period plus the execution
+ * time of the other tasks.
+ *
+ * The clock is injected as a function pointer so the scheduler can be driven
+ * by Arduino's millis on the robot or by a simulated clock elsewhere.
+ *
+ */
+class Scheduler
+{
+ public:
+  using Clock = uint32_t (*)();
+
+  struct Timing
+  {
+    uint32_t periodMs{0};
+    uint32_t deadlineMs{0};
+  };
+
+  struct Statistics
+  {
+    uint32_t releases{0};
+    uint32_t deadlineMisses{0};
+    uint32_t skippedReleases{0};
+    uint32_t worstReleaseLatencyMs{0};
+    uint32_t worstExecutionTimeMs{0};
+    [[nodiscard]] FormattedMessage<> toString() const;
+  };
+
+  static constexpr size_t MAX_TASKS{8};
+
+  Scheduler(Clock clock);
+
+  /**
+   * @brief Register a periodic task. The task is first released on the next
+   * call to runOnce
+   *
+   * @param task - the task to run, must outlive the scheduler
+   * @param timing - the period and deadline of the task
+   * @return true if the task was registered, false if the table is full
+   */
+  bool addTask(ITask& task, Timing timing);
+
+  /**
+   * @brief Run every task that is due, once
+   *
+   */
+  void runOnce();
+
+  /**
+   * @brief Get the timing statistics recorded for a registered task
+   *
+   * @param task - the task of interest
+   * @return Statistics - zeroed if the task is not registered
+   */
+  [[nodiscard]] Statistics getStatistics(ITask const& task) const;
+
+ private:
+  struct Entry
+  {
+    ITask* task{nullptr};
+    Timing timing;
+    uint32_t nextReleaseMs{0};
+    bool released{false};
+    Statistics statistics;
+  };
+
+  Clock clock;
+  std::array<Entry, MAX_TASKS> entries{};
+  size_t numberOfTasks{0};
+
+  void release(Entry& entry, uint32_t nowMs);
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Host-native stand-in for the parts of the Adafruit LittleFS library
+ * used by src/, backed by the Simulator's flash file system. It starts empty
+ * on every run
+ *
+ */
+class Adafruit_LittleFS
+{
+ public:
+  bool begin();
+  bool exists(char const* path);
+  bool remove(char const* path);
+};
+
+namespace Adafruit_LittleFS_Namespace
+{
+
+enum
+{
+  FILE_O_READ = 0,
+  FILE_O_WRITE = 1,
+};
+
+class File
+{
+ public:
+  explicit File(Adafruit_LittleFS& fileSystem);
+
+  // Writing appends to the file, as on the robot
+  bool open(char const* path, uint8_t mode);
+  int read(void* buffer, uint16_t size);
+  size_t write(uint8_t const* data, size_t size);
+  void close();
+
+ private:
+  std::string path;
+  uint8_t mode{FILE_O_READ};
+  bool isOpen{false};
+  std::vector<uint8_t> contents;
+  size_t position{0};
+};
+
+} // namespace Adafruit_LittleFS_Namespace
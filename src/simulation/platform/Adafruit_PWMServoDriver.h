@@ -0,0 +1,25 @@
+#pragma once
+#include "Wire.h"
+#include <cstdint>
+
+/**
+ * @brief Host-native stand-in for the Adafruit PCA9685 library. Writes the
+ * same registers as the real library, over the simulated I2C bus
+ *
+ */
+class Adafruit_PWMServoDriver
+{
+ public:
+  Adafruit_PWMServoDriver(uint8_t address, TwoWire& i2c);
+
+  bool begin();
+  void setPWMFreq(float frequency);
+  void setOscillatorFrequency(uint32_t frequency);
+  uint8_t setPWM(uint8_t channel, uint16_t on, uint16_t off);
+
+ private:
+  static constexpr uint8_t LED0_ON_L_REGISTER{0x06};
+
+  uint8_t address;
+  TwoWire& i2c;
+};
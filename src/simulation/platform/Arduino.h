@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Host-native stand-in for the parts of the Arduino core used by src/, backed
+// by the Simulator. Pin numbers follow the Adafruit Feather nRF52832
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define A0 2
+#define A1 3
+#define A2 4
+#define A3 5
+
+#define digitalPinToInterrupt(pin) (pin)
+
+// Arduino pin to nRF52 GPIO number
+extern uint32_t const g_ADigitalPinMap[];
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t milliSeconds);
+void delayMicroseconds(uint32_t microSeconds);
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t mode);
+
+/**
+ * @brief Serial port, transmitting over the simulated UART and receiving the
+ * serial input the scenario scripts
+ *
+ */
+class Uart
+{
+ public:
+  void begin(unsigned long baudRate);
+  size_t write(uint8_t const* data, size_t size);
+
+  int available();
+  int read();
+
+  // There is always a host attached to the simulation
+  explicit operator bool() const
+  {
+    return true;
+  }
+};
+
+extern Uart Serial;
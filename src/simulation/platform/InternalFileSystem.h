@@ -0,0 +1,12 @@
+#pragma once
+#include "Adafruit_LittleFS.h"
+
+/**
+ * @brief Host-native stand-in for the nRF52 internal flash file system
+ *
+ */
+class InternalFileSystem : public Adafruit_LittleFS
+{
+};
+
+extern InternalFileSystem InternalFS;
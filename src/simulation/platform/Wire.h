@@ -0,0 +1,29 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Host-native stand-in for the Arduino I2C (Wire) library. A
+ * transmission is buffered and handed to the Simulator as a register write
+ * when it ends
+ *
+ */
+class TwoWire
+{
+ public:
+  void begin();
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool sendStop = true);
+
+ private:
+  // Same size as the Arduino core's TX buffer
+  static constexpr size_t BUFFER_SIZE{32};
+
+  uint8_t address{0};
+  std::array<uint8_t, BUFFER_SIZE> buffer{};
+  size_t size{0};
+};
+
+extern TwoWire Wire;
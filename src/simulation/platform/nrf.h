@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+// Host-native stand-in for the nRF52 device header. Only the PWM peripheral
+// used by the eyes (PWM2) is modelled: its registers are plain memory the
+// Simulator polls, so a task write takes effect at the next advance
+
+struct NRF_PWM_Type
+{
+  uint32_t TASKS_STOP;
+  uint32_t TASKS_SEQSTART[2];
+  uint32_t EVENTS_SEQEND[2];
+  uint32_t SHORTS;
+  uint32_t ENABLE;
+  uint32_t MODE;
+  uint32_t COUNTERTOP;
+  uint32_t PRESCALER;
+  uint32_t DECODER;
+  uint32_t LOOP;
+
+  // PTR is 32 bits on the robot. It holds a host pointer here
+  struct
+  {
+    uintptr_t PTR;
+    uint32_t CNT;
+    uint32_t REFRESH;
+    uint32_t ENDDELAY;
+  } SEQ[2];
+
+  struct
+  {
+    uint32_t OUT[4];
+  } PSEL;
+};
+
+NRF_PWM_Type* simulatedPwm2();
+#define NRF_PWM2 (simulatedPwm2())
+
+#define PWM_PSEL_OUT_CONNECT_Pos 31
+#define PWM_PSEL_OUT_CONNECT_Disconnected 1
+#define PWM_ENABLE_ENABLE_Pos 0
+#define PWM_ENABLE_ENABLE_Enabled 1
+#define PWM_MODE_UPDOWN_Pos 0
+#define PWM_MODE_UPDOWN_Up 0
+#define PWM_PRESCALER_PRESCALER_Pos 0
+#define PWM_PRESCALER_PRESCALER_DIV_16 4
+#define PWM_DECODER_LOAD_Pos 0
+#define PWM_DECODER_LOAD_Individual 2
+#define PWM_DECODER_MODE_Pos 8
+#define PWM_DECODER_MODE_RefreshCount 0
@@ -0,0 +1,240 @@
+#include "Adafruit_LittleFS.h"
+#include "Adafruit_PWMServoDriver.h"
+#include "Arduino.h"
+#include "InternalFileSystem.h"
+#include "Wire.h"
+#include "nrf.h"
+#include "simulation/simulator.hpp"
+#include <algorithm>
+#include <cstring>
+
+//////////////////////////////////////////////////////////////////////
+// Arduino core
+//////////////////////////////////////////////////////////////////////
+
+// On the Feather nRF52832 the Arduino pin numbers are the GPIO numbers
+uint32_t const g_ADigitalPinMap[] = {0,  1,  2,  3,  4,  5,  6,  7,
+                                     8,  9,  10, 11, 12, 13, 14, 15,
+                                     16, 17, 18, 19, 20, 21, 22, 23,
+                                     24, 25, 26, 27, 28, 29, 30, 31};
+
+Uart Serial;
+TwoWire Wire;
+
+uint32_t millis()
+{
+  return static_cast<uint32_t>(Simulator::getInstance().nowUs() / 1000);
+}
+
+uint32_t micros()
+{
+  return static_cast<uint32_t>(Simulator::getInstance().nowUs());
+}
+
+void delay(uint32_t milliSeconds)
+{
+  Simulator::getInstance().advance(static_cast<uint64_t>(milliSeconds) * 1000);
+}
+
+void delayMicroseconds(uint32_t microSeconds)
+{
+  Simulator::getInstance().advance(microSeconds);
+}
+
+void pinMode(uint32_t /*pin*/, uint32_t /*mode*/)
+{
+}
+
+void digitalWrite(uint32_t pin, uint32_t value)
+{
+  Simulator::getInstance().digitalWrite(static_cast<uint8_t>(pin),
+                                        value != LOW);
+}
+
+int digitalRead(uint32_t pin)
+{
+  return Simulator::getInstance().digitalRead(static_cast<uint8_t>(pin)) ? HIGH
+                                                                         : LOW;
+}
+
+void attachInterrupt(uint32_t pin, void (*handler)(), uint32_t mode)
+{
+  Simulator::getInstance().attachInterrupt(
+      static_cast<uint8_t>(pin), handler, static_cast<int>(mode));
+}
+
+void Uart::begin(unsigned long /*baudRate*/)
+{
+}
+
+size_t Uart::write(uint8_t const* data, size_t size)
+{
+  Simulator::getInstance().uartWrite(data, size);
+  return size;
+}
+
+int Uart::available()
+{
+  return Simulator::getInstance().uartAvailable();
+}
+
+int Uart::read()
+{
+  return Simulator::getInstance().uartRead();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Wire
+//////////////////////////////////////////////////////////////////////
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  this->address = address;
+  this->size = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (this->size >= this->buffer.size())
+  {
+    return 0;
+  }
+  this->buffer.at(this->size++) = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool /*sendStop*/)
+{
+  // The first byte of a write is the register address
+  if (this->size > 0)
+  {
+    Simulator::getInstance().i2cWrite(this->address,
+                                      this->buffer.at(0),
+                                      this->buffer.data() + 1,
+                                      this->size - 1);
+  }
+  this->size = 0;
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Adafruit_PWMServoDriver
+//////////////////////////////////////////////////////////////////////
+
+Adafruit_PWMServoDriver::Adafruit_PWMServoDriver(uint8_t address,
+                                                 TwoWire& i2c)
+    : address(address), i2c(i2c)
+{
+}
+
+bool Adafruit_PWMServoDriver::begin()
+{
+  this->i2c.begin();
+  return true;
+}
+
+void Adafruit_PWMServoDriver::setPWMFreq(float /*frequency*/)
+{
+}
+
+void Adafruit_PWMServoDriver::setOscillatorFrequency(uint32_t /*frequency*/)
+{
+}
+
+uint8_t Adafruit_PWMServoDriver::setPWM(uint8_t channel,
+                                        uint16_t on,
+                                        uint16_t off)
+{
+  this->i2c.beginTransmission(this->address);
+  this->i2c.write(static_cast<uint8_t>(LED0_ON_L_REGISTER + 4 * channel));
+  this->i2c.write(static_cast<uint8_t>(on & 0xFF));
+  this->i2c.write(static_cast<uint8_t>(on >> 8));
+  this->i2c.write(static_cast<uint8_t>(off & 0xFF));
+  this->i2c.write(static_cast<uint8_t>(off >> 8));
+  return this->i2c.endTransmission();
+}
+
+//////////////////////////////////////////////////////////////////////
+// nRF52 peripherals
+//////////////////////////////////////////////////////////////////////
+
+NRF_PWM_Type* simulatedPwm2()
+{
+  return &Simulator::getInstance().getPwmRegisters();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Adafruit_LittleFS
+//////////////////////////////////////////////////////////////////////
+
+InternalFileSystem InternalFS;
+
+bool Adafruit_LittleFS::begin()
+{
+  return true;
+}
+
+bool Adafruit_LittleFS::exists(char const* path)
+{
+  std::vector<uint8_t> contents;
+  return Simulator::getInstance().readFile(path, contents);
+}
+
+bool Adafruit_LittleFS::remove(char const* path)
+{
+  return Simulator::getInstance().removeFile(path);
+}
+
+namespace Adafruit_LittleFS_Namespace
+{
+
+File::File(Adafruit_LittleFS& /*fileSystem*/)
+{
+}
+
+bool File::open(char const* path, uint8_t mode)
+{
+  this->path = path;
+  this->mode = mode;
+  this->position = 0;
+  this->contents.clear();
+
+  // A file opened for writing is created if it doesn't exist
+  this->isOpen =
+      Simulator::getInstance().readFile(path, this->contents) ||
+      mode == FILE_O_WRITE;
+  return this->isOpen;
+}
+
+int File::read(void* buffer, uint16_t size)
+{
+  if (!this->isOpen || this->mode != FILE_O_READ)
+  {
+    return -1;
+  }
+  size_t count = std::min<size_t>(size, this->contents.size() - this->position);
+  std::memcpy(buffer, this->contents.data() + this->position, count);
+  this->position += count;
+  return static_cast<int>(count);
+}
+
+size_t File::write(uint8_t const* data, size_t size)
+{
+  if (!this->isOpen || this->mode != FILE_O_WRITE)
+  {
+    return 0;
+  }
+  Simulator::getInstance().appendFile(this->path, data, size);
+  return size;
+}
+
+void File::close()
+{
+  this->isOpen = false;
+}
+
+} // namespace Adafruit_LittleFS_Namespace
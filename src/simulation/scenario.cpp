@@ -0,0 +1,188 @@
+#include "scenario.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+bool Scenario::load(std::string const& path, std::string& error)
+{
+  std::ifstream file(path);
+  if (!file)
+  {
+    error = "Unable to open " + path;
+    return false;
+  }
+
+  std::vector<Keyframe> keyframes;
+  std::vector<SerialInput> serialInputs;
+  float sonarNoiseCm = 0;
+  SwitchBounce switchBounce;
+  std::vector<SwitchGlitch> switchGlitches;
+  std::string line;
+  for (int lineNumber = 1; std::getline(file, line); lineNumber++)
+  {
+    std::istringstream fields(line);
+    std::string first;
+    if (!(fields >> first) || first.front() == '#')
+    {
+      continue;
+    }
+
+    if (first == "noise")
+    {
+      if (!(fields >> sonarNoiseCm) || sonarNoiseCm < 0)
+      {
+        error = path + ":" + std::to_string(lineNumber) +
+                ": expected noise <cm>";
+        return false;
+      }
+      continue;
+    }
+
+    if (first == "bounce")
+    {
+      if (!(fields >> switchBounce.bounces >> switchBounce.durationMs))
+      {
+        error = path + ":" + std::to_string(lineNumber) +
+                ": expected bounce <bounces> <ms>";
+        return false;
+      }
+      continue;
+    }
+
+    Keyframe keyframe;
+    std::string second;
+    std::string switchState;
+    fields.str(line);
+    fields.clear();
+    bool parsed = static_cast<bool>(fields >> keyframe.timeMs >> second);
+    if (parsed && second == "serial")
+    {
+      SerialInput input{.timeMs = keyframe.timeMs, .text = {}};
+      std::getline(fields >> std::ws, input.text);
+      if (!serialInputs.empty() && input.timeMs < serialInputs.back().timeMs)
+      {
+        error = path + ":" + std::to_string(lineNumber) +
+                ": serial input must be in time order";
+        return false;
+      }
+      serialInputs.push_back(std::move(input));
+      continue;
+    }
+    if (parsed && second == "glitch")
+    {
+      SwitchGlitch glitch{.timeMs = keyframe.timeMs, .durationMs = 0};
+      if (!(fields >> glitch.durationMs) || glitch.durationMs == 0)
+      {
+        error = path + ":" + std::to_string(lineNumber) +
+                ": expected <time ms> glitch <ms>";
+        return false;
+      }
+      if (!switchGlitches.empty() &&
+          glitch.timeMs < switchGlitches.back().timeMs)
+      {
+        error = path + ":" + std::to_string(lineNumber) +
+                ": glitches must be in time order";
+        return false;
+      }
+      switchGlitches.push_back(glitch);
+      continue;
+    }
+    if (parsed && (second == "target" || second == "move"))
+    {
+      keyframe.hasTarget = true;
+      keyframe.moving = second == "move";
+      parsed = static_cast<bool>(fields >> keyframe.targetBearingDeg >>
+                                 keyframe.targetDistanceCm);
+    }
+    else if (parsed)
+    {
+      std::istringstream rightDistance(second);
+      parsed = static_cast<bool>(rightDistance >> keyframe.rightDistanceCm) &&
+               static_cast<bool>(fields >> keyframe.leftDistanceCm);
+    }
+    if (!parsed || !(fields >> switchState) ||
+        (switchState != "on" && switchState != "off"))
+    {
+      error = path + ":" + std::to_string(lineNumber) +
+              ": expected <time ms> <right cm> <left cm> <on|off> or <time "
+              "ms> target|move <bearing deg> <distance cm> <on|off>";
+      return false;
+    }
+    keyframe.switchOn = switchState == "on";
+
+    if (!keyframes.empty() && keyframe.timeMs < keyframes.back().timeMs)
+    {
+      error = path + ":" + std::to_string(lineNumber) +
+              ": keyframes must be in time order";
+      return false;
+    }
+    keyframes.push_back(keyframe);
+  }
+
+  this->keyframes = std::move(keyframes);
+  this->serialInputs = std::move(serialInputs);
+  this->sonarNoiseCm = sonarNoiseCm;
+  this->switchBounce = switchBounce;
+  this->switchGlitches = std::move(switchGlitches);
+  return true;
+}
+
+Scenario::Keyframe Scenario::at(uint32_t timeMs) const
+{
+  // Last keyframe at or before the time
+  auto next = std::upper_bound(
+      this->keyframes.begin(),
+      this->keyframes.end(),
+      timeMs,
+      [](uint32_t time, Keyframe const& keyframe)
+      { return time < keyframe.timeMs; });
+  if (next == this->keyframes.begin())
+  {
+    return {};
+  }
+
+  Keyframe keyframe = *std::prev(next);
+  if (next == this->keyframes.end() || !next->moving || !keyframe.hasTarget)
+  {
+    return keyframe;
+  }
+
+  // On the way to the next keyframe's target
+  float progress = static_cast<float>(timeMs - keyframe.timeMs) /
+                   static_cast<float>(next->timeMs - keyframe.timeMs);
+  keyframe.targetBearingDeg +=
+      progress * (next->targetBearingDeg - keyframe.targetBearingDeg);
+  keyframe.targetDistanceCm +=
+      progress * (next->targetDistanceCm - keyframe.targetDistanceCm);
+  return keyframe;
+}
+
+uint32_t Scenario::endMs() const
+{
+  return this->keyframes.empty() ? 0 : this->keyframes.back().timeMs;
+}
+
+std::vector<Scenario::Keyframe> const& Scenario::getKeyframes() const
+{
+  return this->keyframes;
+}
+
+float Scenario::getSonarNoiseCm() const
+{
+  return this->sonarNoiseCm;
+}
+
+std::vector<Scenario::SerialInput> const& Scenario::getSerialInputs() const
+{
+  return this->serialInputs;
+}
+
+Scenario::SwitchBounce Scenario::getSwitchBounce() const
+{
+  return this->switchBounce;
+}
+
+std::vector<Scenario::SwitchGlitch> const& Scenario::getSwitchGlitches() const
+{
+  return this->switchGlitches;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Scripted environment of a simulation run: the distance seen by each
+ * sonar sensor and the state of the mode switch, over time
+ *
+ * A scenario is a list of keyframes. Each keyframe holds from its time until
+ * the time of the next keyframe. Scenario files have one keyframe per line,
+ * either giving the distances directly:
+ *
+ *   <time ms> <right distance cm> <left distance cm> <switch on|off>
+ *
+ * or placing a target, whose distance from each sensor then depends on where
+ * the robot's waist is turned (see Simulator):
+ *
+ *   <time ms> target <bearing deg> <distance cm> <switch on|off>
+ *
+ * The bearing is measured from the robot facing forward (waist angle 0) and
+ * increases in the same direction as the waist angle. A target keyframe
+ * written as
+ *
+ *   <time ms> move <bearing deg> <distance cm> <switch on|off>
+ *
+ * moves the target at a constant speed from where the previous keyframe placed
+ * it, arriving at this keyframe's time, instead of holding the previous target
+ * until then. A line
+ *
+ *   noise <cm>
+ *
+ * adds uniformly distributed noise of up to +-cm to every sonar measurement,
+ * and a line
+ *
+ *   <time ms> serial <text>
+ *
+ * sends the text to the robot over the serial link at that time. A line
+ *
+ *   bounce <bounces> <ms>
+ *
+ * makes the switch contact bounce back that many times, at random, within the
+ * given time of every flip, and a line
+ *
+ *   <time ms> glitch <ms>
+ *
+ * makes the switch read the other state for the given time, as a spike
+ * picked up by the wiring would.
+ *
+ * Blank lines and lines starting with '#' are ignored. A distance of zero or
+ * less means nothing is in range of that sensor.
+ *
+ */
+class Scenario
+{
+ public:
+  struct Keyframe
+  {
+    uint32_t timeMs{0};
+    float rightDistanceCm{0};
+    float leftDistanceCm{0};
+    bool switchOn{false};
+    bool hasTarget{false};
+    bool moving{false};
+    float targetBearingDeg{0};
+    float targetDistanceCm{0};
+  };
+
+  struct SerialInput
+  {
+    uint32_t timeMs{0};
+    std::string text;
+  };
+
+  struct SwitchBounce
+  {
+    uint32_t bounces{0};
+    uint32_t durationMs{0};
+  };
+
+  struct SwitchGlitch
+  {
+    uint32_t timeMs{0};
+    uint32_t durationMs{0};
+  };
+
+  /**
+   * @brief Load a scenario file
+   *
+   * @param path - the scenario file
+   * @param error - set to a description of the problem if loading fails
+   * @return true if the scenario was loaded
+   */
+  bool load(std::string const& path, std::string& error);
+
+  /**
+   * @brief Get the keyframe in effect at a time. Before the first keyframe
+   * (or with no keyframes) nothing is in range and the switch is off. A
+   * target on the move is placed where it is at that time
+   *
+   */
+  [[nodiscard]] Keyframe at(uint32_t timeMs) const;
+
+  /**
+   * @brief Time of the last keyframe
+   *
+   */
+  [[nodiscard]] uint32_t endMs() const;
+
+  [[nodiscard]] std::vector<Keyframe> const& getKeyframes() const;
+
+  /**
+   * @brief Amplitude of the noise added to the sonar measurements
+   *
+   */
+  [[nodiscard]] float getSonarNoiseCm() const;
+
+  /**
+   * @brief Get the serial input, in time order
+   *
+   */
+  [[nodiscard]] std::vector<SerialInput> const& getSerialInputs() const;
+
+  /**
+   * @brief How the switch contact bounces when it is flipped
+   *
+   */
+  [[nodiscard]] SwitchBounce getSwitchBounce() const;
+
+  /**
+   * @brief Get the switch glitches, in time order
+   *
+   */
+  [[nodiscard]] std::vector<SwitchGlitch> const& getSwitchGlitches() const;
+
+ private:
+  std::vector<Keyframe> keyframes;
+  std::vector<SerialInput> serialInputs;
+  float sonarNoiseCm{0};
+  SwitchBounce switchBounce;
+  std::vector<SwitchGlitch> switchGlitches;
+};
@@ -0,0 +1,601 @@
+#include "application/application.hpp"
+#include "application/danceState.hpp"
+#include "simulator.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Entry point of the native build. Runs the Application against the
+// Simulator, with the environment scripted by a scenario file:
+//
+//   program <scenario file> [--duration-ms <ms>] [--timeline <csv file>]
+//           [--jitter-ms <max ms>] [--seed <n>] [--fixed-timestep]
+//           [--prediction]
+//           [--tracking-pid <Kp>,<Kd>,<Ki>[,<derivative smoothing>
+//                           [,<P setpoint weight>[,<D setpoint weight>]]]]
+//
+// The log is written to stdout and a summary of the run to stderr. The
+// timeline of servo and eye writes is written as CSV if requested.
+//
+// With --jitter-ms, every scheduler run also takes a random time of up to the
+// given number of milliseconds, as if a task had stalled. That makes the task
+// periods jitter. --seed changes the jitter and the sonar noise, to tell a
+// change in the response apart from the noise (see
+// scripts/jitter_sweep.py). --fixed-timestep steps the TrackingState
+// controller with timestepMs instead of the measured time since the previous
+// step, as it was before the timestep was measured.
+//
+// For every target the scenario places while in tracking mode, the summary
+// reports how the waist responded: how long it took to settle on the target,
+// how far it overshot and how many waist servo commands it took. For a target
+// on the move it reports how far the waist was from the target instead, and
+// the tracking error over the whole run follows. Run the same scenario with
+// different --tracking-pid parameters, or with --prediction, to compare
+// controllers
+//
+// For every flip of the mode switch, the summary reports how long the
+// application took to change mode, measured from the first edge of the
+// contact. A mode change no flip asked for (e.g. one caused by a glitch) is
+// counted as spurious
+//
+// Every time an object comes closer than DanceState::MIN_DISTANCE_CM in dance
+// mode, the summary reports how long it took the arms to get to
+// DanceState::RETRACTED_ARM_ANGLE, the safety response time
+
+namespace
+{
+
+// Virtual time that passes between two runs of the scheduler
+constexpr uint64_t TICK_US{1000};
+
+// The waist has settled once it stays this close to the target
+constexpr float SETTLING_BAND_DEG{10};
+
+// The arms have retracted once both are this close to the retracted angle
+constexpr float RETRACTED_BAND_DEG{1};
+
+struct Options
+{
+  std::string scenarioPath;
+  uint32_t durationMs{0};
+  bool durationGiven{false};
+  std::string timelinePath;
+  uint32_t jitterMs{0};
+  uint32_t seed{0};
+  bool fixedTimestep{false};
+  PidParameters trackingPid{TrackingState::PID_PARAMS};
+  bool predictiveTracking{false};
+};
+
+// <Kp>,<Kd>,<Ki> followed by up to three of the optional parameters, the rest
+// keep their TrackingState values
+bool parsePid(char const* text, PidParameters& params)
+{
+  int fields = std::sscanf(text,
+                           "%f,%f,%f,%f,%f,%f",
+                           &params.Kp,
+                           &params.Kd,
+                           &params.Ki,
+                           &params.derivativeSmoothingFactor,
+                           &params.proportionalSetpointWeight,
+                           &params.derivativeSetpointWeight);
+  return fields >= 3;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--duration-ms") == 0 && hasValue)
+    {
+      options.durationMs =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+      options.durationGiven = true;
+    }
+    else if (std::strcmp(argv[i], "--timeline") == 0 && hasValue)
+    {
+      options.timelinePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--jitter-ms") == 0 && hasValue)
+    {
+      options.jitterMs =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+    {
+      options.seed =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (std::strcmp(argv[i], "--fixed-timestep") == 0)
+    {
+      options.fixedTimestep = true;
+    }
+    else if (std::strcmp(argv[i], "--prediction") == 0)
+    {
+      options.predictiveTracking = true;
+    }
+    else if (std::strcmp(argv[i], "--tracking-pid") == 0 && hasValue)
+    {
+      if (!parsePid(argv[++i], options.trackingPid))
+      {
+        return false;
+      }
+    }
+    else if (options.scenarioPath.empty() && argv[i][0] != '-')
+    {
+      options.scenarioPath = argv[i];
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  // A measured timestep clamped to timestepMs is timestepMs
+  if (options.fixedTimestep)
+  {
+    options.trackingPid.minTimestepFactor = 1;
+    options.trackingPid.maxTimestepFactor = 1;
+  }
+  return !options.scenarioPath.empty();
+}
+
+bool writeTimeline(std::string const& path)
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    return false;
+  }
+
+  file << "time_us,device,channel,value\n";
+  for (auto const& entry : Simulator::getInstance().getTimeline())
+  {
+    file << entry.timeUs << ","
+         << (entry.device == Simulator::Device::servo ? "servo" : "eyes")
+         << "," << static_cast<int>(entry.channel) << "," << entry.value
+         << "\n";
+  }
+  return true;
+}
+
+// Number of waist servo commands between two times
+size_t countWaistCommands(uint32_t startMs, uint32_t stopMs)
+{
+  size_t commands = 0;
+  for (auto const& entry : Simulator::getInstance().getTimeline())
+  {
+    commands += entry.device == Simulator::Device::servo &&
+                        entry.channel == Simulator::WAIST_SERVO_CHANNEL &&
+                        entry.timeUs >= uint64_t{startMs} * 1000 &&
+                        entry.timeUs < uint64_t{stopMs} * 1000
+                    ? 1
+                    : 0;
+  }
+  return commands;
+}
+
+// Distance between the waist and the target, over a time range
+struct TrackingError
+{
+  double sumOfSquares{0};
+  float max{0};
+  uint32_t samples{0};
+
+  void add(float error)
+  {
+    sumOfSquares += static_cast<double>(error) * error;
+    max = std::max(max, std::fabs(error));
+    samples++;
+  }
+
+  [[nodiscard]] double rms() const
+  {
+    return samples == 0 ? 0 : std::sqrt(sumOfSquares / samples);
+  }
+};
+
+TrackingError measureTrackingError(Scenario const& scenario,
+                                   std::vector<float> const& waistAngles,
+                                   uint32_t startMs,
+                                   uint32_t stopMs)
+{
+  TrackingError error;
+  for (uint32_t ms = startMs; ms < stopMs; ms++)
+  {
+    Scenario::Keyframe keyframe = scenario.at(ms);
+    if (keyframe.hasTarget && !keyframe.switchOn)
+    {
+      error.add(waistAngles.at(ms) - keyframe.targetBearingDeg);
+    }
+  }
+  return error;
+}
+
+// Report the response of the waist to every target placed in tracking mode.
+// waistAngles holds the waist angle at the start of every millisecond
+void reportTrackingResponse(Scenario const& scenario,
+                            std::vector<float> const& waistAngles)
+{
+  std::vector<Scenario::Keyframe> const& keyframes = scenario.getKeyframes();
+  auto endMs = static_cast<uint32_t>(waistAngles.size());
+  bool first = true;
+
+  for (size_t i = 0; i < keyframes.size(); i++)
+  {
+    Scenario::Keyframe const& keyframe = keyframes.at(i);
+    uint32_t startMs = keyframe.timeMs;
+    uint32_t stopMs =
+        i + 1 < keyframes.size() ? keyframes.at(i + 1).timeMs : endMs;
+    stopMs = std::min(stopMs, endMs);
+    if (!keyframe.hasTarget || keyframe.switchOn || startMs >= stopMs)
+    {
+      continue;
+    }
+
+    if (first)
+    {
+      std::fprintf(stderr,
+                   "Tracking response (settled within %.0f degrees):\n",
+                   static_cast<double>(SETTLING_BAND_DEG));
+      first = false;
+    }
+
+    float startAngle = waistAngles.at(startMs);
+    size_t commands = countWaistCommands(startMs, stopMs);
+
+    // On the way to the next keyframe's target
+    if (i + 1 < keyframes.size() && keyframes.at(i + 1).moving)
+    {
+      TrackingError error =
+          measureTrackingError(scenario, waistAngles, startMs, stopMs);
+      std::fprintf(stderr,
+                   "  %ums, %.0f moving to %.0f degrees: error rms %.1f, max "
+                   "%.1f degrees, %zu waist servo commands\n",
+                   startMs,
+                   static_cast<double>(keyframe.targetBearingDeg),
+                   static_cast<double>(keyframes.at(i + 1).targetBearingDeg),
+                   error.rms(),
+                   static_cast<double>(error.max),
+                   commands);
+      continue;
+    }
+
+    float target = keyframe.targetBearingDeg;
+    float direction = target >= startAngle ? 1.0F : -1.0F;
+
+    // Settled from the millisecond after the last one outside the band
+    float overshoot = 0;
+    uint32_t settledMs = startMs;
+    for (uint32_t ms = startMs; ms < stopMs; ms++)
+    {
+      float angle = waistAngles.at(ms);
+      overshoot = std::max(overshoot, direction * (angle - target));
+      if (std::fabs(angle - target) > SETTLING_BAND_DEG)
+      {
+        settledMs = ms + 1;
+      }
+    }
+
+    std::fprintf(stderr,
+                 "  %ums, %.0f -> %.0f degrees: ",
+                 startMs,
+                 static_cast<double>(startAngle),
+                 static_cast<double>(target));
+    if (settledMs < stopMs)
+    {
+      std::fprintf(stderr, "settled in %ums", settledMs - startMs);
+    }
+    else
+    {
+      std::fprintf(stderr, "not settled");
+    }
+    std::fprintf(stderr,
+                 ", overshoot %.1f degrees, %zu waist servo commands\n",
+                 static_cast<double>(overshoot),
+                 commands);
+  }
+
+  TrackingError error = measureTrackingError(scenario, waistAngles, 0, endMs);
+  if (error.samples > 0)
+  {
+    std::fprintf(stderr,
+                 "Tracking error over %.1fs: rms %.1f, max %.1f degrees\n",
+                 static_cast<double>(error.samples) / 1000,
+                 error.rms(),
+                 static_cast<double>(error.max));
+  }
+}
+
+// Report how the application reacted to the mode switch. modes holds the mode
+// the application was in at the start of every millisecond, and the
+// application first ran at startMs
+void reportModeSwitch(Scenario const& scenario,
+                      std::vector<Switch::State> const& modes,
+                      uint32_t startMs)
+{
+  if (modes.empty())
+  {
+    return;
+  }
+
+  auto endMs = static_cast<uint32_t>(modes.size());
+  bool on = scenario.at(0).switchOn;
+  uint32_t flips = 0;
+  uint32_t reactions = 0;
+  uint32_t worstReactionMs = 0;
+  uint64_t totalReactionMs = 0;
+  for (auto const& keyframe : scenario.getKeyframes())
+  {
+    if (keyframe.switchOn == on || keyframe.timeMs >= endMs)
+    {
+      continue;
+    }
+    on = keyframe.switchOn;
+    flips++;
+
+    Switch::State expected = on ? Switch::State::on : Switch::State::off;
+    for (uint32_t ms = keyframe.timeMs; ms < endMs; ms++)
+    {
+      if (modes.at(ms) == expected)
+      {
+        uint32_t reactionMs = ms - keyframe.timeMs;
+        worstReactionMs = std::max(worstReactionMs, reactionMs);
+        totalReactionMs += reactionMs;
+        reactions++;
+        break;
+      }
+    }
+  }
+
+  uint32_t modeChanges = 0;
+  for (size_t ms = startMs + 1; ms < modes.size(); ms++)
+  {
+    modeChanges += modes.at(ms) != modes.at(ms - 1) ? 1 : 0;
+  }
+  if (flips == 0 && modeChanges == 0)
+  {
+    return;
+  }
+
+  std::fprintf(stderr,
+               "Mode switch: %u flips, %u reacted to, reaction mean %.1fms, "
+               "max %ums, %u spurious mode changes\n",
+               flips,
+               reactions,
+               reactions == 0 ? 0.0
+                              : static_cast<double>(totalReactionMs) /
+                                    reactions,
+               worstReactionMs,
+               modeChanges > reactions ? modeChanges - reactions : 0);
+}
+
+// Closest distance the scenario gives either sensor, zero if nothing is in
+// range
+float closestDistance(Scenario::Keyframe const& keyframe)
+{
+  if (keyframe.hasTarget)
+  {
+    return std::max(keyframe.targetDistanceCm, 0.0F);
+  }
+  float closest = 0;
+  for (float distance : {keyframe.rightDistanceCm, keyframe.leftDistanceCm})
+  {
+    if (distance > 0 && (closest == 0 || distance < closest))
+    {
+      closest = distance;
+    }
+  }
+  return closest;
+}
+
+bool isTooClose(Scenario::Keyframe const& keyframe)
+{
+  float distance = closestDistance(keyframe);
+  return keyframe.switchOn && distance > 0 &&
+         distance < DanceState::MIN_DISTANCE_CM;
+}
+
+// Report the time from an object coming too close in dance mode to both arms
+// having retracted. armAngles holds the angle of each arm at the start of
+// every millisecond
+void reportSafetyResponse(
+    Scenario const& scenario,
+    std::vector<std::array<float, 2>> const& armAngles)
+{
+  std::vector<Scenario::Keyframe> const& keyframes = scenario.getKeyframes();
+  auto endMs = static_cast<uint32_t>(armAngles.size());
+  auto retractedAngle = static_cast<float>(DanceState::RETRACTED_ARM_ANGLE);
+  uint32_t events = 0;
+  uint32_t retracted = 0;
+  uint32_t worstResponseMs = 0;
+
+  for (size_t i = 0; i < keyframes.size(); i++)
+  {
+    bool wasTooClose = i > 0 && isTooClose(keyframes.at(i - 1));
+    if (!isTooClose(keyframes.at(i)) || wasTooClose)
+    {
+      continue;
+    }
+
+    // Too close until the next keyframe that isn't
+    uint32_t startMs = keyframes.at(i).timeMs;
+    uint32_t stopMs = endMs;
+    for (size_t next = i + 1; next < keyframes.size(); next++)
+    {
+      if (!isTooClose(keyframes.at(next)))
+      {
+        stopMs = std::min(stopMs, keyframes.at(next).timeMs);
+        break;
+      }
+    }
+    if (startMs >= stopMs)
+    {
+      continue;
+    }
+    if (events == 0)
+    {
+      std::fprintf(stderr,
+                   "Safety response (arms within %.0f degrees of %d):\n",
+                   static_cast<double>(RETRACTED_BAND_DEG),
+                   DanceState::RETRACTED_ARM_ANGLE);
+    }
+    events++;
+
+    std::fprintf(stderr, "  %ums: ", startMs);
+    bool done = false;
+    for (uint32_t ms = startMs; ms < stopMs && !done; ms++)
+    {
+      std::array<float, 2> const& arms = armAngles.at(ms);
+      done = std::fabs(arms.at(0) - retractedAngle) <= RETRACTED_BAND_DEG &&
+             std::fabs(arms.at(1) - retractedAngle) <= RETRACTED_BAND_DEG;
+      if (done)
+      {
+        std::fprintf(stderr, "retracted in %ums\n", ms - startMs);
+        worstResponseMs = std::max(worstResponseMs, ms - startMs);
+        retracted++;
+      }
+    }
+    if (!done)
+    {
+      std::fprintf(stderr, "not retracted\n");
+    }
+  }
+
+  if (events > 0)
+  {
+    std::fprintf(stderr,
+                 "Safety response: %u of %u retracted, worst %ums\n",
+                 retracted,
+                 events,
+                 worstResponseMs);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::fprintf(stderr,
+                 "Usage: %s <scenario file> [--duration-ms <ms>] "
+                 "[--timeline <csv file>] [--jitter-ms <max ms>] "
+                 "[--seed <n>] [--fixed-timestep] [--prediction] "
+                 "[--tracking-pid "
+                 "<Kp>,<Kd>,<Ki>[,<derivative smoothing>[,<P setpoint "
+                 "weight>[,<D setpoint weight>]]]]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Scenario scenario;
+  std::string error;
+  if (!scenario.load(options.scenarioPath, error))
+  {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+  uint32_t durationMs =
+      options.durationGiven ? options.durationMs : scenario.endMs();
+
+  Simulator& simulator = Simulator::getInstance();
+  simulator.setSeed(options.seed);
+  simulator.setScenario(scenario);
+
+  auto wallStart = std::chrono::steady_clock::now();
+
+  Application application(options.trackingPid, options.predictiveTracking);
+  uint64_t endUs = static_cast<uint64_t>(durationMs) * 1000;
+  std::vector<float> waistAngles;
+  waistAngles.reserve(durationMs);
+  std::vector<Switch::State> modes;
+  modes.reserve(durationMs);
+  std::vector<std::array<float, 2>> armAngles;
+  armAngles.reserve(durationMs);
+
+  // Setting the hardware up takes time, and so do short delays (e.g. the sonar
+  // trigger pulse), so keep the records in step with the clock rather than
+  // with the ticks
+  auto recordUntil = [&](uint64_t endRecordMs)
+  {
+    while (waistAngles.size() < endRecordMs)
+    {
+      waistAngles.push_back(simulator.getWaistAngle());
+      modes.push_back(application.getMode());
+      armAngles.push_back(
+          {simulator.getJointAngle(Simulator::Joint::rightShoulder),
+           simulator.getJointAngle(Simulator::Joint::leftShoulder)});
+    }
+  };
+  recordUntil(simulator.nowUs() / 1000);
+  auto startMs = static_cast<uint32_t>(waistAngles.size());
+
+  // Seeded, so a run is repeatable
+  std::mt19937 jitterGenerator{options.seed};
+  std::uniform_int_distribution<uint32_t> jitterMs(0, options.jitterMs);
+
+  while (simulator.nowUs() < endUs)
+  {
+    application.runOnce();
+
+    // The run takes one tick, plus the jitter
+    uint32_t runTicks = 1 + jitterMs(jitterGenerator);
+    for (uint32_t tick = 0; tick < runTicks && simulator.nowUs() < endUs;
+         tick++)
+    {
+      recordUntil(simulator.nowUs() / 1000 + 1);
+      simulator.advance(TICK_US);
+    }
+  }
+
+  std::chrono::duration<double> wallTime =
+      std::chrono::steady_clock::now() - wallStart;
+  std::fflush(stdout);
+
+  size_t servoWrites = 0;
+  for (auto const& entry : simulator.getTimeline())
+  {
+    servoWrites += entry.device == Simulator::Device::servo ? 1 : 0;
+  }
+  Simulator::UartStatistics uart = simulator.getUartStatistics();
+  double simulatedS = static_cast<double>(simulator.nowUs()) / 1e6;
+
+  std::fprintf(stderr,
+               "Simulated %.1fs in %.3fs (%.0fx real time)\n"
+               "Servo writes: %zu, eye writes: %zu\n"
+               "UART writes: %u (%llu bytes), blocking writes: %u, worst "
+               "blocking time: %uus\n",
+               simulatedS,
+               wallTime.count(),
+               simulatedS / std::max(wallTime.count(), 1e-9),
+               servoWrites,
+               simulator.getTimeline().size() - servoWrites,
+               uart.writes,
+               static_cast<unsigned long long>(uart.bytes),
+               uart.blockingWrites,
+               uart.worstBlockingUs);
+  reportTrackingResponse(scenario, waistAngles);
+  reportModeSwitch(scenario, modes, startMs);
+  reportSafetyResponse(scenario, armAngles);
+
+  if (!options.timelinePath.empty() && !writeTimeline(options.timelinePath))
+  {
+    std::fprintf(stderr,
+                 "Unable to write the timeline to %s\n",
+                 options.timelinePath.c_str());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,519 @@
+#include "simulator.hpp"
+#include "Arduino.h"
+#include "utilities/heapGuard.hpp"
+#include <algorithm>
+#include <cmath>
+
+Simulator& Simulator::getInstance()
+{
+  static Simulator simulator;
+  return simulator;
+}
+
+void Simulator::setScenario(Scenario scenario)
+{
+  this->scenario = std::move(scenario);
+  this->scheduleSwitchEdges();
+}
+
+void Simulator::setSeed(uint32_t seed)
+{
+  this->noiseGenerator.seed(seed);
+  this->bounceGenerator.seed(seed);
+}
+
+void Simulator::setUartOutput(std::ostream* output)
+{
+  this->uartOutput = output;
+}
+
+void Simulator::setEchoWidth(uint32_t widthUs)
+{
+  this->fixedEchoWidthUs = widthUs;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Clock
+//////////////////////////////////////////////////////////////////////
+
+uint64_t Simulator::nowUs() const
+{
+  return this->timeUs;
+}
+
+void Simulator::advance(uint64_t durationUs)
+{
+  uint64_t targetUs = this->timeUs + durationUs;
+
+  // A sequence started since the last advance, started now
+  this->startPwmSequence();
+
+  // An interrupt handler may schedule further events, so look at the front of
+  // the queue afresh each time
+  while (!this->pinEvents.empty() &&
+         this->pinEvents.front().timeUs <= targetUs)
+  {
+    PinEvent event = this->pinEvents.front();
+    this->pinEvents.erase(this->pinEvents.begin());
+    this->timeUs = std::max(this->timeUs, event.timeUs);
+    this->setPinLevel(event.pin, event.high);
+  }
+
+  this->moveJoints(durationUs);
+  this->timeUs = targetUs;
+  this->playPwmSequence();
+}
+
+//////////////////////////////////////////////////////////////////////
+// GPIO
+//////////////////////////////////////////////////////////////////////
+
+void Simulator::digitalWrite(uint8_t pin, bool high)
+{
+  bool wasHigh = this->pinLevels.at(pin);
+  this->setPinLevel(pin, high);
+
+  // The HC-SR04 starts its measurement on the falling edge of the trigger
+  // pulse
+  if (wasHigh && !high)
+  {
+    Scenario::Keyframe keyframe = this->scenario.at(
+        static_cast<uint32_t>(this->timeUs / 1000));
+    if (pin == RIGHT_SONAR.triggerPin)
+    {
+      this->scheduleEcho(RIGHT_SONAR,
+                         keyframe.hasTarget
+                             ? this->getTargetDistance(keyframe, RIGHT_SONAR)
+                             : keyframe.rightDistanceCm);
+    }
+    else if (pin == LEFT_SONAR.triggerPin)
+    {
+      this->scheduleEcho(LEFT_SONAR,
+                         keyframe.hasTarget
+                             ? this->getTargetDistance(keyframe, LEFT_SONAR)
+                             : keyframe.leftDistanceCm);
+    }
+  }
+}
+
+bool Simulator::digitalRead(uint8_t pin) const
+{
+  return this->pinLevels.at(pin);
+}
+
+void Simulator::attachInterrupt(uint8_t pin, InterruptHandler handler, int mode)
+{
+  this->interruptHandlers.at(pin) = handler;
+  this->interruptModes.at(pin) = mode;
+}
+
+void Simulator::setPinLevel(uint8_t pin, bool high)
+{
+  bool wasHigh = this->pinLevels.at(pin);
+  this->pinLevels.at(pin) = high;
+  if (wasHigh == high || this->interruptHandlers.at(pin) == nullptr)
+  {
+    return;
+  }
+
+  int mode = this->interruptModes.at(pin);
+  if (mode == CHANGE || (mode == RISING && high) || (mode == FALLING && !high))
+  {
+    this->interruptHandlers.at(pin)();
+  }
+}
+
+void Simulator::schedulePinEvent(PinEvent event)
+{
+  // Events at the same time keep the order they were scheduled in
+  auto position = std::upper_bound(
+      this->pinEvents.begin(),
+      this->pinEvents.end(),
+      event.timeUs,
+      [](uint64_t timeUs, PinEvent const& other)
+      { return timeUs < other.timeUs; });
+  HeapGuard::Exemption exemption;
+  this->pinEvents.insert(position, event);
+}
+
+void Simulator::scheduleEcho(SonarPins sonar, float distanceCm)
+{
+  uint32_t echoWidthUs = NO_ECHO_WIDTH_US;
+  distanceCm = this->addNoise(distanceCm);
+  if (this->fixedEchoWidthUs > 0)
+  {
+    echoWidthUs = this->fixedEchoWidthUs;
+  }
+  else if (distanceCm > 0 && distanceCm <= MAX_RANGE_CM)
+  {
+    echoWidthUs =
+        static_cast<uint32_t>(2 * distanceCm / SPEED_OF_SOUND_CM_PER_US);
+  }
+
+  uint64_t riseUs = this->timeUs + ECHO_DELAY_US;
+  this->schedulePinEvent(
+      {.timeUs = riseUs, .pin = sonar.echoPin, .high = true});
+  this->schedulePinEvent(
+      {.timeUs = riseUs + echoWidthUs, .pin = sonar.echoPin, .high = false});
+}
+
+void Simulator::scheduleSwitchEdges()
+{
+  bool on = this->scenario.at(0).switchOn;
+  this->pinLevels.at(SWITCH_PIN) = on;
+
+  for (auto const& keyframe : this->scenario.getKeyframes())
+  {
+    if (keyframe.switchOn != on)
+    {
+      on = keyframe.switchOn;
+      this->scheduleSwitchFlip(uint64_t{keyframe.timeMs} * 1000, on);
+    }
+  }
+
+  // A glitch is too short to bounce
+  for (auto const& glitch : this->scenario.getSwitchGlitches())
+  {
+    bool level = this->scenario.at(glitch.timeMs).switchOn;
+    uint64_t startUs = uint64_t{glitch.timeMs} * 1000;
+    this->schedulePinEvent(
+        {.timeUs = startUs, .pin = SWITCH_PIN, .high = !level});
+    this->schedulePinEvent({.timeUs = startUs + glitch.durationMs * 1000,
+                            .pin = SWITCH_PIN,
+                            .high = level});
+  }
+}
+
+void Simulator::scheduleSwitchFlip(uint64_t timeUs, bool on)
+{
+  // The contact first reaches its new level at the time of the flip, then
+  // bounces back and forth at random times before settling on it
+  Scenario::SwitchBounce bounce = this->scenario.getSwitchBounce();
+  std::uniform_int_distribution<uint64_t> bounceUs(
+      1, std::max<uint64_t>(uint64_t{bounce.durationMs} * 1000, 1));
+  std::vector<uint64_t> edgesUs(2 * static_cast<size_t>(bounce.bounces));
+  for (auto& edgeUs : edgesUs)
+  {
+    edgeUs = timeUs + bounceUs(this->bounceGenerator);
+  }
+  std::sort(edgesUs.begin(), edgesUs.end());
+
+  this->schedulePinEvent({.timeUs = timeUs, .pin = SWITCH_PIN, .high = on});
+  bool high = on;
+  for (uint64_t edgeUs : edgesUs)
+  {
+    high = !high;
+    this->schedulePinEvent({.timeUs = edgeUs, .pin = SWITCH_PIN, .high = high});
+  }
+}
+
+float Simulator::getTargetDistance(Scenario::Keyframe const& keyframe,
+                                   SonarPins sonar) const
+{
+  if (keyframe.targetDistanceCm <= 0)
+  {
+    return 0;
+  }
+
+  // Angle between the sensor's axis and the line to the target
+  constexpr float DEGREES_TO_RADIANS{3.14159265F / 180};
+  float axis = sonar.triggerPin == RIGHT_SONAR.triggerPin
+                   ? SONAR_ANGLE_DEG / 2
+                   : -SONAR_ANGLE_DEG / 2;
+  float incidence =
+      (keyframe.targetBearingDeg - this->getWaistAngle() - axis) *
+      DEGREES_TO_RADIANS;
+
+  // An axis pointing away from the surface never meets it
+  float cosine = std::cos(incidence);
+  if (cosine <= 0)
+  {
+    return 0;
+  }
+  return keyframe.targetDistanceCm / cosine;
+}
+
+float Simulator::addNoise(float distanceCm)
+{
+  float noiseCm = this->scenario.getSonarNoiseCm();
+  if (distanceCm <= 0 || noiseCm <= 0)
+  {
+    return distanceCm;
+  }
+  std::uniform_real_distribution<float> noise(-noiseCm, noiseCm);
+  return std::max(distanceCm + noise(this->noiseGenerator), 1.0F);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Robot
+//////////////////////////////////////////////////////////////////////
+
+float Simulator::getWaistAngle() const
+{
+  return this->getJointAngle(Joint::waist);
+}
+
+float Simulator::getJointAngle(Joint joint) const
+{
+  return this->jointAngles.at(static_cast<size_t>(joint));
+}
+
+void Simulator::moveJoints(uint64_t durationUs)
+{
+  float maxStep = SERVO_SPEED_DEG_PER_S * static_cast<float>(durationUs) / 1e6F;
+  for (size_t joint = 0; joint < this->jointAngles.size(); joint++)
+  {
+    float& angle = this->jointAngles.at(joint);
+    angle += std::clamp(
+        this->commandedJointAngles.at(joint) - angle, -maxStep, maxStep);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Buses
+//////////////////////////////////////////////////////////////////////
+
+void Simulator::i2cWrite(uint8_t address,
+                         uint8_t firstRegister,
+                         uint8_t const* data,
+                         size_t size)
+{
+  this->i2cStatistics.transactions++;
+  this->i2cStatistics.bytes += 1 + size;
+
+  if (address != PWM_DRIVER_I2C_ADDRESS)
+  {
+    return;
+  }
+
+  // The PCA9685 auto-increments the register address after each byte. A
+  // channel's new duty cycle takes effect once its last register is written
+  for (size_t i = 0; i < size; i++)
+  {
+    int registerAddress = firstRegister + static_cast<int>(i);
+    int offset = registerAddress - LED0_ON_L_REGISTER;
+    if (offset < 0 || offset >= static_cast<int>(this->pwmRegisters.size()))
+    {
+      continue;
+    }
+    this->pwmRegisters.at(offset) = data[i];
+
+    if (offset % REGISTERS_PER_CHANNEL == REGISTERS_PER_CHANNEL - 1)
+    {
+      auto channel = static_cast<uint8_t>(offset / REGISTERS_PER_CHANNEL);
+      auto dutyCycle = static_cast<uint16_t>(
+          this->pwmRegisters.at(offset - 1) |
+          (this->pwmRegisters.at(offset) << 8));
+      HeapGuard::Exemption exemption;
+      this->timeline.push_back({.timeUs = this->timeUs,
+                                .device = Device::servo,
+                                .channel = channel,
+                                .value = dutyCycle});
+
+      for (size_t joint = 0; joint < SERVO_JOINTS.size(); joint++)
+      {
+        ServoJoint const& servo = SERVO_JOINTS.at(joint);
+        if (channel != servo.channel)
+        {
+          continue;
+        }
+        float servoAngle = (static_cast<float>(dutyCycle) -
+                            SERVO_MIN_DUTY_CYCLE) *
+                           180 / (SERVO_MAX_DUTY_CYCLE - SERVO_MIN_DUTY_CYCLE);
+        // Joints truncates the duty cycle, and only sets whole degrees
+        this->commandedJointAngles.at(joint) =
+            std::round((servoAngle - servo.zeroOffset) * servo.direction);
+      }
+    }
+  }
+}
+
+void Simulator::uartWrite(uint8_t const* data, size_t size)
+{
+  if (this->uartOutput != nullptr)
+  {
+    this->uartOutput->write(reinterpret_cast<char const*>(data),
+                            static_cast<std::streamsize>(size));
+  }
+
+  // Each chunk of up to a DMA buffer's worth of bytes has to wait for the
+  // previous chunk to finish transmitting
+  auto nowUs = static_cast<double>(this->timeUs);
+  double readyUs = nowUs;
+  for (size_t sent = 0; sent < size; sent += UART_DMA_BUFFER_SIZE)
+  {
+    size_t chunk = std::min<size_t>(UART_DMA_BUFFER_SIZE, size - sent);
+    readyUs = std::max(readyUs, this->uartBusyUntilUs);
+    this->uartBusyUntilUs = readyUs + chunk * UART_US_PER_BYTE;
+  }
+
+  auto blockingUs = static_cast<uint32_t>(readyUs - nowUs);
+  this->uartStatistics.writes++;
+  this->uartStatistics.bytes += size;
+  if (blockingUs > 0)
+  {
+    this->uartStatistics.blockingWrites++;
+  }
+  this->uartStatistics.worstBlockingUs =
+      std::max(this->uartStatistics.worstBlockingUs, blockingUs);
+}
+
+int Simulator::uartAvailable() const
+{
+  // Every input that is due has arrived
+  auto const& inputs = this->scenario.getSerialInputs();
+  int available = 0;
+  size_t byte = this->nextSerialInputByte;
+  for (size_t input = this->nextSerialInput;
+       input < inputs.size() &&
+       uint64_t{inputs.at(input).timeMs} * 1000 <= this->timeUs;
+       input++)
+  {
+    available += static_cast<int>(inputs.at(input).text.size() - byte);
+    byte = 0;
+  }
+  return available;
+}
+
+int Simulator::uartRead()
+{
+  auto const& inputs = this->scenario.getSerialInputs();
+  while (this->nextSerialInput < inputs.size())
+  {
+    Scenario::SerialInput const& input = inputs.at(this->nextSerialInput);
+    if (uint64_t{input.timeMs} * 1000 > this->timeUs)
+    {
+      return -1;
+    }
+    if (this->nextSerialInputByte < input.text.size())
+    {
+      return static_cast<uint8_t>(input.text.at(this->nextSerialInputByte++));
+    }
+    this->nextSerialInput++;
+    this->nextSerialInputByte = 0;
+  }
+  return -1;
+}
+
+NRF_PWM_Type& Simulator::getPwmRegisters()
+{
+  return this->pwm;
+}
+
+void Simulator::startPwmSequence()
+{
+  if (this->pwm.TASKS_SEQSTART[0] == 0)
+  {
+    return;
+  }
+  this->pwm.TASKS_SEQSTART[0] = 0;
+  if (this->pwm.ENABLE == 0 || this->pwm.SEQ[0].CNT == 0)
+  {
+    return;
+  }
+
+  // Only the individual decoder layout (four values per step) and the up
+  // counter are modelled. One PWM clock tick is 2^PRESCALER / 16us
+  constexpr uint32_t VALUES_PER_STEP{4};
+  uint64_t periodNs =
+      uint64_t{this->pwm.COUNTERTOP} * (uint64_t{1} << this->pwm.PRESCALER) *
+      1000 / 16;
+  this->pwmPlaying = true;
+  this->pwmStartUs = this->timeUs;
+  this->pwmSequence = reinterpret_cast<uint16_t const*>(this->pwm.SEQ[0].PTR);
+  this->pwmSequenceSteps = this->pwm.SEQ[0].CNT / VALUES_PER_STEP;
+  this->pwmStepUs = static_cast<uint32_t>(
+      std::max<uint64_t>((this->pwm.SEQ[0].REFRESH + 1) * periodNs / 1000, 1));
+  this->playPwmSequence();
+}
+
+void Simulator::playPwmSequence()
+{
+  if (!this->pwmPlaying)
+  {
+    return;
+  }
+
+  // The peripheral holds the last step once the sequence has ended
+  uint64_t step = (this->timeUs - this->pwmStartUs) / this->pwmStepUs;
+  if (step + 1 >= this->pwmSequenceSteps)
+  {
+    step = this->pwmSequenceSteps - 1;
+    this->pwmPlaying = false;
+    this->pwm.EVENTS_SEQEND[0] = 1;
+  }
+
+  // The duty cycle is the compare value without the polarity bit, whichever
+  // way the LED is wired
+  constexpr uint16_t DUTY_CYCLE_MASK{0x7FFF};
+  uint16_t const* values = this->pwmSequence + step * 4;
+  this->setEyes(values[0] & DUTY_CYCLE_MASK,
+                values[1] & DUTY_CYCLE_MASK,
+                values[2] & DUTY_CYCLE_MASK);
+}
+
+void Simulator::setEyes(int red, int green, int blue)
+{
+  std::array<int, 3> eyes{red, green, blue};
+  for (size_t colour = 0; colour < eyes.size(); colour++)
+  {
+    if (eyes.at(colour) != this->eyes.at(colour))
+    {
+      HeapGuard::Exemption exemption;
+      this->timeline.push_back(
+          {.timeUs = this->timeUs,
+           .device = Device::eyes,
+           .channel = static_cast<uint8_t>(colour),
+           .value = static_cast<uint16_t>(eyes.at(colour))});
+    }
+  }
+  this->eyes = eyes;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Flash
+//////////////////////////////////////////////////////////////////////
+
+bool Simulator::readFile(std::string const& path,
+                         std::vector<uint8_t>& contents) const
+{
+  auto file = this->files.find(path);
+  if (file == this->files.end())
+  {
+    return false;
+  }
+  contents = file->second;
+  return true;
+}
+
+void Simulator::appendFile(std::string const& path,
+                           uint8_t const* data,
+                           size_t size)
+{
+  std::vector<uint8_t>& contents = this->files[path];
+  contents.insert(contents.end(), data, data + size);
+}
+
+bool Simulator::removeFile(std::string const& path)
+{
+  return this->files.erase(path) > 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Results
+//////////////////////////////////////////////////////////////////////
+
+std::vector<Simulator::TimelineEntry> const& Simulator::getTimeline() const
+{
+  return this->timeline;
+}
+
+Simulator::I2cStatistics Simulator::getI2cStatistics() const
+{
+  return this->i2cStatistics;
+}
+
+Simulator::UartStatistics Simulator::getUartStatistics() const
+{
+  return this->uartStatistics;
+}
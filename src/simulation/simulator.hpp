@@ -0,0 +1,365 @@
+#pragma once
+#include "nrf.h"
+#include "scenario.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Singleton, host-native model of the robot's hardware, used in place of
+ * the nRF52 and its peripherals by the native build
+ *
+ * The Arduino core and libraries used by src/hardware are replaced by thin
+ * stand-ins (src/simulation/platform) that forward to this class, so the
+ * hardware components and everything above them run unmodified:
+ *
+ * - Time is virtual. It only moves when advance is called (or when the code
+ *   under test calls delay), so a run is deterministic and runs as fast as the
+ *   host can execute the code
+ * - The GPIO pins hold levels, and interrupt handlers attached to a pin are
+ *   called when a scheduled level change is reached
+ * - Pulsing an HC-SR04 trigger pin schedules the echo pulse of the distance
+ *   the scenario gives for that sensor at that time. When the scenario places
+ *   a target instead, the distance is worked out from the target's position
+ *   and the angle the waist servo has turned to, which closes the tracking
+ *   loop
+ * - The mode switch pin changes level when the scenario flips the switch, with
+ *   the contact bounce and the glitches the scenario gives
+ * - Writes to the PCA9685 servo driver board are recorded on a timeline. So are
+ *   the eye colours the PWM peripheral (PWM2) plays: its registers are
+ *   polled on every advance, and a started sequence steps through its duty
+ *   cycles in virtual time
+ * - The UART models the 115200 baud line and its 64 byte EasyDMA buffer, and
+ *   measures how long each write would have blocked on the robot. It
+ *   receives the serial input the scenario scripts
+ * - The internal flash file system is held in memory, and starts empty
+ *
+ * The timeline and the pending pin events grow on the heap. The robot has
+ * neither, so growing them is exempt from the HeapGuard.
+ *
+ */
+class Simulator
+{
+ public:
+  enum class Device : uint8_t
+  {
+    servo,
+    eyes,
+  };
+
+  // A write to an actuator. For servos the channel is the servo driver board
+  // channel and the value is the duty cycle (PWM off time, in ticks). For the
+  // eyes the channel is the colour (0 red, 1 green, 2 blue) and the value is
+  // its brightness
+  struct TimelineEntry
+  {
+    uint64_t timeUs;
+    Device device;
+    uint8_t channel;
+    uint16_t value;
+  };
+
+  // Every transmission on the I2C bus, whatever the device. The bytes are
+  // those after the device address: the register address and the data
+  struct I2cStatistics
+  {
+    uint32_t transactions{0};
+    uint64_t bytes{0};
+  };
+
+  struct UartStatistics
+  {
+    uint32_t writes{0};
+    uint64_t bytes{0};
+    uint32_t blockingWrites{0};
+    uint32_t worstBlockingUs{0};
+  };
+
+  // The joints whose servos are modelled, see getJointAngle
+  enum class Joint : uint8_t
+  {
+    waist,
+    rightShoulder,
+    leftShoulder,
+  };
+
+  using InterruptHandler = void (*)();
+
+  // Servo driver board channel of the waist, must match Joints
+  static constexpr uint8_t WAIST_SERVO_CHANNEL{2};
+
+  static Simulator& getInstance();
+
+  void setScenario(Scenario scenario);
+
+  /**
+   * @brief Seed the sonar noise and the switch bounce. A run with the same
+   * seed is repeatable, the default is 0. Call before setScenario, which
+   * draws the switch bounce
+   *
+   */
+  void setSeed(uint32_t seed);
+
+  /**
+   * @brief Set where the bytes written to the UART go (stdout by default)
+   *
+   * @param output - nullptr to discard them
+   */
+  void setUartOutput(std::ostream* output);
+
+  /**
+   * @brief Answer every sonar trigger with an echo pulse of exactly this
+   * width, whatever the scenario places in front of the sensors. Used to
+   * check the echo timing math against known edge times
+   *
+   * @param widthUs - 0 to go back to the scenario
+   */
+  void setEchoWidth(uint32_t widthUs);
+
+  //////////////////////////////////////////////////////////////////////
+  // Clock
+  //////////////////////////////////////////////////////////////////////
+
+  [[nodiscard]] uint64_t nowUs() const;
+
+  /**
+   * @brief Move virtual time forward, applying every pin level change that is
+   * due on the way and calling the attached interrupt handlers
+   *
+   */
+  void advance(uint64_t durationUs);
+
+  //////////////////////////////////////////////////////////////////////
+  // GPIO
+  //////////////////////////////////////////////////////////////////////
+
+  void digitalWrite(uint8_t pin, bool high);
+  [[nodiscard]] bool digitalRead(uint8_t pin) const;
+  void attachInterrupt(uint8_t pin, InterruptHandler handler, int mode);
+
+  //////////////////////////////////////////////////////////////////////
+  // Buses
+  //////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief Write consecutive registers of an I2C device. Only the PCA9685
+   * servo driver board is modelled, writes to other devices are ignored
+   *
+   */
+  void i2cWrite(uint8_t address,
+                uint8_t firstRegister,
+                uint8_t const* data,
+                size_t size);
+
+  void uartWrite(uint8_t const* data, size_t size);
+
+  /**
+   * @brief Number of received bytes waiting to be read
+   *
+   */
+  [[nodiscard]] int uartAvailable() const;
+
+  /**
+   * @brief Read one received byte
+   *
+   * @return int - the byte, or -1 if none is waiting
+   */
+  int uartRead();
+
+  /**
+   * @brief The registers of the PWM peripheral driving the eyes
+   *
+   */
+  NRF_PWM_Type& getPwmRegisters();
+
+  //////////////////////////////////////////////////////////////////////
+  // Robot
+  //////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief Get the angle the waist has turned to, in degrees. It lags the
+   * commanded angle by the time the servo takes to get there
+   *
+   */
+  [[nodiscard]] float getWaistAngle() const;
+
+  /**
+   * @brief Get the angle a joint has turned to, in degrees (Joints angles).
+   * Like the waist, it lags the commanded angle
+   *
+   */
+  [[nodiscard]] float getJointAngle(Joint joint) const;
+
+  //////////////////////////////////////////////////////////////////////
+  // Flash
+  //////////////////////////////////////////////////////////////////////
+
+  /**
+   * @brief Read a whole file
+   *
+   * @return true if the file exists
+   */
+  bool readFile(std::string const& path, std::vector<uint8_t>& contents) const;
+
+  /**
+   * @brief Append to a file, creating it if it doesn't exist
+   *
+   */
+  void appendFile(std::string const& path, uint8_t const* data, size_t size);
+
+  /**
+   * @brief Remove a file
+   *
+   * @return true if the file existed
+   */
+  bool removeFile(std::string const& path);
+
+  //////////////////////////////////////////////////////////////////////
+  // Results
+  //////////////////////////////////////////////////////////////////////
+
+  [[nodiscard]] std::vector<TimelineEntry> const& getTimeline() const;
+  [[nodiscard]] I2cStatistics getI2cStatistics() const;
+  [[nodiscard]] UartStatistics getUartStatistics() const;
+
+  // Delete move and copy constructors
+  Simulator(Simulator&&) = delete;
+  Simulator(Simulator const&) = delete;
+
+  // Delete move and copy assignment operators
+  void operator=(Simulator&&) = delete;
+  void operator=(Simulator const&) = delete;
+
+ private:
+  Simulator() = default;
+
+  static constexpr size_t NUMBER_OF_PINS{32};
+
+  // Must match the pins used by SonarArray and Switch (nRF52832 Feather pin
+  // numbers, A3 is pin 5)
+  struct SonarPins
+  {
+    uint8_t triggerPin;
+    uint8_t echoPin;
+  };
+  static constexpr SonarPins RIGHT_SONAR{.triggerPin = 7, .echoPin = 11};
+  static constexpr SonarPins LEFT_SONAR{.triggerPin = 16, .echoPin = 15};
+  static constexpr uint8_t SWITCH_PIN{5};
+
+  // HC-SR04 timing: the echo pin rises once the ultrasonic burst has been
+  // sent, and is held high for the round trip time of the sound. With nothing
+  // in range it is held high for ~38ms
+  static constexpr uint32_t ECHO_DELAY_US{450};
+  static constexpr uint32_t NO_ECHO_WIDTH_US{38000};
+  static constexpr float MAX_RANGE_CM{400};
+  static constexpr float SPEED_OF_SOUND_CM_PER_US{0.0343F};
+
+  // Target geometry, must match the sensor mounting SonarArray describes: the
+  // sensors' axes are SONAR_ANGLE_DEG apart, either side of the way the torso
+  // faces, the right one towards positive waist angles (which is what the
+  // TrackingState control law assumes). The target is a flat surface square
+  // to the line from the robot to it, like a person facing the robot, and
+  // each sensor hears the echo from where its axis meets the surface
+  static constexpr float SONAR_ANGLE_DEG{15};
+
+  // PCA9685 register map, see Joints
+  static constexpr uint8_t PWM_DRIVER_I2C_ADDRESS{0x40};
+  static constexpr uint8_t LED0_ON_L_REGISTER{0x06};
+  static constexpr uint8_t REGISTERS_PER_CHANNEL{4};
+  static constexpr uint8_t NUMBER_OF_PWM_CHANNELS{16};
+
+  // Servo model, must match Joints: the duty cycle maps linearly from
+  // SERVO_MIN_DUTY_CYCLE at 0 degrees to SERVO_MAX_DUTY_CYCLE at 180 degrees,
+  // and each joint is at 0 at its zero offset, turning its servo in its
+  // direction. The servos turn at up to SERVO_SPEED_DEG_PER_S (DF-ROBOT
+  // DC5535: ~0.16s per 60 degrees)
+  static constexpr float SERVO_MIN_DUTY_CYCLE{60};
+  static constexpr float SERVO_MAX_DUTY_CYCLE{450};
+  static constexpr float SERVO_SPEED_DEG_PER_S{375};
+
+  struct ServoJoint
+  {
+    uint8_t channel;
+    float zeroOffset;
+    float direction;
+  };
+
+  // Indexed by Joint
+  static constexpr std::array<ServoJoint, 3> SERVO_JOINTS{{
+      {.channel = WAIST_SERVO_CHANNEL, .zeroOffset = 85, .direction = 1},
+      {.channel = 1, .zeroOffset = 120, .direction = -1},
+      {.channel = 0, .zeroOffset = 60, .direction = 1},
+  }};
+
+  // UART line model: 10 bits per byte at 115200 baud
+  static constexpr uint32_t UART_DMA_BUFFER_SIZE{64};
+  static constexpr double UART_US_PER_BYTE{10 * 1000000.0 / 115200};
+
+  struct PinEvent
+  {
+    uint64_t timeUs;
+    uint8_t pin;
+    bool high;
+  };
+
+  Scenario scenario;
+  uint32_t fixedEchoWidthUs{0};
+  uint64_t timeUs{0};
+
+  std::array<bool, NUMBER_OF_PINS> pinLevels{};
+  std::array<InterruptHandler, NUMBER_OF_PINS> interruptHandlers{};
+  std::array<int, NUMBER_OF_PINS> interruptModes{};
+
+  // Pending pin level changes, ordered by time
+  std::vector<PinEvent> pinEvents;
+
+  std::array<uint8_t, NUMBER_OF_PWM_CHANNELS * REGISTERS_PER_CHANNEL>
+      pwmRegisters{};
+  std::array<int, 3> eyes{};
+  std::vector<TimelineEntry> timeline;
+
+  // PWM2 and the sequence it is playing, latched when it was started
+  NRF_PWM_Type pwm{};
+  bool pwmPlaying{false};
+  uint64_t pwmStartUs{0};
+  uint16_t const* pwmSequence{nullptr};
+  uint32_t pwmSequenceSteps{0};
+  uint32_t pwmStepUs{0};
+
+  // Indexed by Joint
+  std::array<float, SERVO_JOINTS.size()> jointAngles{};
+  std::array<float, SERVO_JOINTS.size()> commandedJointAngles{};
+
+  // Fixed seed (see setSeed), so a run is repeatable
+  std::mt19937 noiseGenerator{0};
+  std::mt19937 bounceGenerator{0};
+
+  std::ostream* uartOutput{&std::cout};
+  I2cStatistics i2cStatistics;
+  UartStatistics uartStatistics;
+  double uartBusyUntilUs{0};
+
+  // Position in the scenario's serial input of the next byte to receive
+  size_t nextSerialInput{0};
+  size_t nextSerialInputByte{0};
+
+  std::map<std::string, std::vector<uint8_t>> files;
+
+  void schedulePinEvent(PinEvent event);
+  void setPinLevel(uint8_t pin, bool high);
+  void scheduleEcho(SonarPins sonar, float distanceCm);
+  void scheduleSwitchEdges();
+  void scheduleSwitchFlip(uint64_t timeUs, bool on);
+  float getTargetDistance(Scenario::Keyframe const& keyframe,
+                          SonarPins sonar) const;
+  float addNoise(float distanceCm);
+  void moveJoints(uint64_t durationUs);
+  void startPwmSequence();
+  void playPwmSequence();
+  void setEyes(int red, int green, int blue);
+};
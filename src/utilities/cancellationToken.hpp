@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+
+/**
+ * @brief Flag that lets one part of the application ask a long-running
+ * operation (e.g. a motion) to give up, without holding a reference to it
+ *
+ * The operation is handed the token when it starts and checks it every time
+ * it is stepped. Whoever holds the token can cancel it at any time, from any
+ * context, including an interrupt handler. The owner resets it before
+ * handing it to the next operation.
+ *
+ */
+class CancellationToken
+{
+ public:
+  void cancel()
+  {
+    this->cancelled.store(true, std::memory_order_release);
+  }
+
+  void reset()
+  {
+    this->cancelled.store(false, std::memory_order_release);
+  }
+
+  [[nodiscard]] bool isCancelled() const
+  {
+    return this->cancelled.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<bool> cancelled{false};
+};
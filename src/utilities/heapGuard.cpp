@@ -0,0 +1,168 @@
+#include "heapGuard.hpp"
+#include <cstdlib>
+#include <new>
+
+std::atomic<bool> HeapGuard::locked{false};
+std::atomic<HeapGuard::Action> HeapGuard::action{HeapGuard::Action::count};
+std::atomic<uint32_t> HeapGuard::exemptions{0};
+std::atomic<uint32_t> HeapGuard::allocationsBeforeLock{0};
+std::atomic<uint32_t> HeapGuard::allocationsAfterLock{0};
+std::atomic<uint32_t> HeapGuard::exemptedAllocations{0};
+std::atomic<size_t> HeapGuard::firstSizeAfterLock{0};
+
+void HeapGuard::lock(Action action)
+{
+  HeapGuard::action.store(action);
+  HeapGuard::locked.store(true);
+}
+
+HeapGuard::Counts HeapGuard::getCounts()
+{
+  return {.beforeLock = HeapGuard::allocationsBeforeLock.load(),
+          .afterLock = HeapGuard::allocationsAfterLock.load(),
+          .exempted = HeapGuard::exemptedAllocations.load(),
+          .firstSizeAfterLock = HeapGuard::firstSizeAfterLock.load()};
+}
+
+HeapGuard::Exemption::Exemption()
+{
+  HeapGuard::exemptions++;
+}
+
+HeapGuard::Exemption::~Exemption()
+{
+  HeapGuard::exemptions--;
+}
+
+void HeapGuard::recordAllocation(size_t size)
+{
+  if (!HeapGuard::locked.load())
+  {
+    HeapGuard::allocationsBeforeLock++;
+    return;
+  }
+  if (HeapGuard::exemptions.load() > 0)
+  {
+    HeapGuard::exemptedAllocations++;
+    return;
+  }
+
+  if (HeapGuard::allocationsAfterLock++ == 0)
+  {
+    HeapGuard::firstSizeAfterLock.store(size);
+  }
+  if (HeapGuard::action.load() == Action::trap)
+  {
+    // Nothing can be logged from within malloc, the debugger shows the caller
+    std::abort();
+  }
+}
+
+#ifdef NO_HEAP
+
+//////////////////////////////////////////////////////////////////////
+// Link time wrappers, see the NO_HEAP environments in platformio.ini
+//////////////////////////////////////////////////////////////////////
+
+extern "C"
+{
+  void* __real_malloc(size_t size);
+  void* __real_calloc(size_t count, size_t size);
+  void* __real_realloc(void* pointer, size_t size);
+
+  void* __wrap_malloc(size_t size)
+  {
+    HeapGuard::recordAllocation(size);
+    return __real_malloc(size);
+  }
+
+  void* __wrap_calloc(size_t count, size_t size)
+  {
+    HeapGuard::recordAllocation(count * size);
+    return __real_calloc(count, size);
+  }
+
+  void* __wrap_realloc(void* pointer, size_t size)
+  {
+    // Shrinking to nothing frees
+    if (size > 0)
+    {
+      HeapGuard::recordAllocation(size);
+    }
+    return __real_realloc(pointer, size);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Replacement operator new and delete. The standard library's own call the
+// C library's malloc from within a prebuilt library, which the wrappers above
+// don't always reach. These call the wrapped malloc. An allocation that fails
+// aborts, as the firmware is built without exceptions
+//////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+void* allocate(size_t size)
+{
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr)
+  {
+    std::abort();
+  }
+  return pointer;
+}
+
+} // namespace
+
+void* operator new(size_t size)
+{
+  return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+  return allocate(size);
+}
+
+void* operator new(size_t size, std::nothrow_t const& /*tag*/) noexcept
+{
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, std::nothrow_t const& /*tag*/) noexcept
+{
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t /*size*/) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t /*size*/) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::nothrow_t const& /*tag*/) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::nothrow_t const& /*tag*/) noexcept
+{
+  std::free(pointer);
+}
+
+#endif
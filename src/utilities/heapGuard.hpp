@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Checks that the application doesn't use the heap once it has started
+ *
+ * In a NO_HEAP build, malloc, calloc and realloc are wrapped at link time
+ * (-Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc) and operator new
+ * and delete are replaced to go through the wrapped malloc, so every
+ * allocation is seen here. Once the application has been constructed, lock
+ * marks the end of start up. From then on an allocation either traps (on the
+ * robot, where it stops in the debugger) or is counted (for the host check in
+ * src/benchmark/heapCheckMain.cpp).
+ *
+ * A few library calls allocate and free again before they return, e.g.
+ * LittleFS opening a file. They can't leak or fragment the heap, so they are
+ * allowed within an Exemption. They are still counted, separately.
+ *
+ * Without NO_HEAP nothing is wrapped, and the counts stay at zero.
+ *
+ */
+class HeapGuard
+{
+ public:
+  enum class Action : uint8_t
+  {
+    count,
+    trap,
+  };
+
+  struct Counts
+  {
+    uint32_t beforeLock;
+    uint32_t afterLock;
+    uint32_t exempted;
+    // The size of the first allocation after lock, 0 if there was none
+    size_t firstSizeAfterLock;
+  };
+
+  /**
+   * @brief End of start up: any further allocation outside of an Exemption
+   * is an error
+   *
+   */
+  static void lock(Action action);
+
+  [[nodiscard]] static Counts getCounts();
+
+  /**
+   * @brief Allows allocations while it is in scope. Exemptions nest
+   *
+   */
+  class Exemption
+  {
+   public:
+    Exemption();
+    ~Exemption();
+    Exemption(Exemption const&) = delete;
+    Exemption& operator=(Exemption const&) = delete;
+  };
+
+  /**
+   * @brief Called by the wrapped allocation functions
+   *
+   */
+  static void recordAllocation(size_t size);
+
+ private:
+  static std::atomic<bool> locked;
+  static std::atomic<Action> action;
+  static std::atomic<uint32_t> exemptions;
+  static std::atomic<uint32_t> allocationsBeforeLock;
+  static std::atomic<uint32_t> allocationsAfterLock;
+  static std::atomic<uint32_t> exemptedAllocations;
+  static std::atomic<size_t> firstSizeAfterLock;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * @brief Fixed-size, lock-free, single-producer single-consumer ring buffer
+ *
+ * Safe to push from exactly one context (e.g. an interrupt handler) while
+ * popping from exactly one other context (e.g. a task), without disabling
+ * interrupts. Each index is only ever written by one side, and the element is
+ * published with release/acquire ordering before the index that exposes it.
+ *
+ * Capacity must be a power of two. One slot is kept free to tell a full buffer
+ * from an empty one, so at most Capacity - 1 elements can be held.
+ *
+ */
+template <typename T, size_t Capacity> class SpscRingBuffer
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRingBuffer capacity must be a power of two");
+
+ public:
+  /**
+   * @brief Push an element (producer only)
+   *
+   * @return true if the element was pushed, false if the buffer is full
+   */
+  bool push(T const& element)
+  {
+    size_t head = this->head.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & MASK;
+    if (next == this->tail.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    this->buffer[head] = element;
+    this->head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop the oldest element (consumer only)
+   *
+   * @return true if an element was popped, false if the buffer is empty
+   */
+  bool pop(T& element)
+  {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail == this->head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    element = this->buffer[tail];
+    this->tail.store((tail + 1) & MASK, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] bool empty() const
+  {
+    return this->tail.load(std::memory_order_acquire) ==
+           this->head.load(std::memory_order_acquire);
+  }
+
+ private:
+  static constexpr size_t MASK{Capacity - 1};
+
+  std::array<T, Capacity> buffer{};
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};